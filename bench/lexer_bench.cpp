@@ -0,0 +1,138 @@
+// Tokens per second of the Mascal lexer and the x86 assembly lexer, on large
+// generated inputs. Build it next to the compiler, from the repository root:
+//
+//   clang++ -O3 bench/lexer_bench.cpp language/*.cpp runtime/*.cpp translators/Assembly/X86/X86AssemblyLexer.cpp `llvm-config --cxxflags --ldflags --system-libs --libs all` -frtti -fexceptions -std=c++20 -o lexer_bench
+//   ./lexer_bench [megabytes per input, 32 by default]
+
+#include "../language/Lexer.hpp"
+#include "../translators/Assembly/X86/X86AssemblyLexer.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Keywords, identifiers, numbers and punctuation in about the mix of a real program.
+static const char* MascalChunk =
+	"proc Accumulate(com total: i32, com step: i32): i32 begin\n"
+	"\tcom result: i32 = total;\n"
+	"\tmem values: Array<i32, 8>;\n"
+	"\tblock Loop begin\n"
+	"\t\tmem item: Ref<i32> = GEL(values, result) as i32;\n"
+	"\t\tmemstore item, step;\n"
+	"\t\tadd result, step;\n"
+	"\t\tmul result, 3;\n"
+	"\t\tif COMPARE.IsLessThan(result, 1000) then goto Loop;\n"
+	"\t\tend;\n"
+	"\tend;\n"
+	"\treturn result;\n"
+	"end;\n"
+	"# A comment between procedures.\n";
+
+// What clang emits for a small function, SEH directives included.
+static const char* X86Chunk =
+	"\t.text\n"
+	"\t.def\tmain;\n"
+	"\t.globl\tmain\n"
+	"\t.p2align\t4, 0x90\n"
+	"main:\n"
+	"\t.seh_proc main\n"
+	"\tpushq\t%rbp\n"
+	"\t.seh_pushreg %rbp\n"
+	"\tsubq\t$48, %rsp\n"
+	"\t.seh_stackalloc 48\n"
+	"\tleaq\t48(%rsp), %rbp\n"
+	"\t.seh_setframe %rbp, 48\n"
+	"\t.seh_endprologue\n"
+	"\tmovl\t$0, -4(%rbp)\n"
+	"\tmovl\t-4(%rbp), %eax\n"
+	"\taddl\t$1, %eax\n"
+	"\tcmpl\t$5, %eax\n"
+	"\tjmp\t.LBB0_1\n"
+	"\txorl\t%eax, %eax\n"
+	"\taddq\t$48, %rsp\n"
+	"\tpopq\t%rbp\n"
+	"\tretq\n"
+	"\t.seh_endproc\n";
+
+static const int Runs = 5;
+
+static std::string Repeat(const char* chunk, size_t bytes) {
+
+	std::string s;
+	s.reserve(bytes + 1024);
+
+	while(s.size() < bytes) {
+		s += chunk;
+	}
+
+	return s;
+}
+
+static size_t LexMascal(const std::string& input) {
+
+	Lexer lexer(input);
+	lexer.Start();
+
+	size_t tokens = 0;
+
+	do {
+		lexer.GetNextToken();
+		tokens++;
+	}
+	while(lexer.CurrentToken != Token::EndOfFile);
+
+	return tokens;
+}
+
+static size_t LexX86(const std::string& input) {
+
+	X86AssemblyLexer::Content = input;
+	X86AssemblyLexer::Start();
+
+	size_t tokens = 0;
+
+	do {
+		X86AssemblyLexer::GetNextToken();
+		tokens++;
+	}
+	while(X86AssemblyLexer::CurrentToken != X86AssemblyToken::X86EndOfFile);
+
+	return tokens;
+}
+
+// Best of a few runs, so a slow first run (page faults, cold caches) doesn't count.
+static void Bench(const char* name, const std::string& input, size_t (*lex)(const std::string&)) {
+
+	double best = 0;
+	size_t tokens = 0;
+
+	for(int i = 0; i < Runs; i++) {
+
+		auto start = std::chrono::steady_clock::now();
+
+		tokens = lex(input);
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if(i == 0 || seconds < best) {
+			best = seconds;
+		}
+	}
+
+	printf("%-8s %8.1f MB %12zu tokens %10.3f s %8.2f M tokens/s %8.1f MB/s\n", name, input.size() / 1e6, tokens, best, tokens / best / 1e6, input.size() / best / 1e6);
+}
+
+int main(int argc, char const *argv[])
+{
+	size_t megabytes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 32;
+
+	if(megabytes == 0) {
+		printf("Usage: lexer_bench [megabytes per input]\n");
+		return 1;
+	}
+
+	Bench("mascal", Repeat(MascalChunk, megabytes * 1000000), LexMascal);
+	Bench("x86", Repeat(X86Chunk, megabytes * 1000000), LexX86);
+
+	return 0;
+}
@@ -0,0 +1,39 @@
+#!/bin/bash
+
+# Times PHI finalization on a generated program of N statements (default 100000).
+# Every statement is in one loop block, and N / 100 coms are read across its back
+# edge, so each com gets a PHI whose predecessors include the big block.
+#
+#   bench/phi_bench.sh [statements] [path to mascal]
+
+statements=${1:-100000}
+mascal=${2:-./mascal}
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+awk -v n="$statements" 'BEGIN {
+	coms = int(n / 100);
+	if(coms < 1) coms = 1;
+
+	print "program begin";
+	print "";
+	for(i = 0; i < coms; i++) print "\tcom c" i ": i32 = 0;";
+	print "\tcom count: i32 = 0;";
+	print "";
+	print "\tblock Loop begin";
+	print "";
+	for(i = 0; i < n; i++) print "\t\tc" (i % coms) " += c" ((i + 1) % coms) ";";
+	print "";
+	print "\t\tcount += 1;";
+	print "";
+	print "\t\tif COMPARE.IsLessThan(count, 10) then goto Loop;";
+	print "\t\tend;";
+	print "\tend;";
+	print "";
+	print "\treturn c0;";
+	print "";
+	print "end";
+}' > "$dir/phi_bench.mascal"
+
+"$mascal" emit -O0 --time-report -o "$dir" "$dir/phi_bench.mascal" 2>&1 >/dev/null | grep -E "Phase|PHI finalization|codegen: Codegen|parse: Parse"
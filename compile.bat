@@ -15,7 +15,10 @@ set MTCPPAssembly=translators/Assembly/*.cpp
 set MTCPPx86Assembly=translators/Assembly/X86/*.cpp
 
 echo Compiling Mascal on Windows...
-%ClangPath% -g -O3 %MTCPPAssembly% %MTCPPx86Assembly% language/*.cpp *.cpp %LLVMConfigResult% -fstack-protector -lssp -frtti -std=c++20 -static -o mascal
+%ClangPath% -g -O3 %MTCPPAssembly% %MTCPPx86Assembly% language/*.cpp runtime/*.cpp *.cpp %LLVMConfigResult% -fstack-protector -lssp -frtti -fexceptions -std=c++20 -static -o mascal
+
+%ClangPath% -O3 -c runtime/MascalRT.cpp -std=c++20 -fno-exceptions -fno-rtti -o runtime/MascalRT.o
+%BasePath%\llvm-ar rcs libmascalrt.a runtime/MascalRT.o
 
 IF "%ERRORLEVEL%"=="0" (
     echo Mascal Compiled Successfully!
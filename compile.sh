@@ -1,3 +1,10 @@
 #!/bin/bash
 
-clang++ -g -O3 language/*.cpp *.cpp `llvm-config --cxxflags --link-static --ldflags --system-libs --libs all` -fstack-protector -lssp -frtti -std=c++20 -static -o mascal
+clang++ -g -O3 language/*.cpp runtime/*.cpp *.cpp `llvm-config --cxxflags --link-static --ldflags --system-libs --libs all` -fstack-protector -lssp -frtti -fexceptions -std=c++20 -static -o mascal
+
+# libmascalrt, linked into programs that use 'parfor'. Installed next to the compiler.
+clang++ -O3 -c runtime/MascalRT.cpp -std=c++20 -fno-exceptions -fno-rtti -o runtime/MascalRT.o
+ar rcs libmascalrt.a runtime/MascalRT.o
+
+clang++ -O3 -c runtime/MascalRT.cpp -std=c++20 -DMASCALRT_NOSTDLIB -ffreestanding -fno-builtin -fno-exceptions -fno-rtti -fno-stack-protector -o runtime/MascalRT_nostdlib.o
+ar rcs libmascalrt_nostdlib.a runtime/MascalRT_nostdlib.o
@@ -1,10 +1,102 @@
 #include "AST.hpp"
+#include "Session.hpp"
+#include "Timing.hpp"
+#include "../runtime/MascalRT.hpp"
 #include <iostream>
 
-int AST::slash_t_count = 0;
+thread_local int AST::slash_t_count = 0;
+
+thread_local std::map<std::pair<AST::Type*, uint64_t>, AST::Type*> AST::array_types;
+thread_local std::map<std::pair<AST::Type*, uint64_t>, AST::Type*> AST::vector_types;
+thread_local std::map<std::pair<AST::Type*, bool>, AST::Type*> AST::ref_types;
+thread_local std::map<std::pair<AST::Type*, uint64_t>, AST::Type*> AST::soa_types;
+thread_local std::map<std::string, AST::Type*, std::less<>> AST::record_types;
+
+AST::Type* AST::GetArrayType(AST::Type* childTy, uint64_t elements) {
+
+	AST::Type*& ty = array_types[std::make_pair(childTy, elements)];
+
+	if(ty == nullptr) {
+		ty = Arena::New<AST::Array>(childTy, elements);
+	}
+
+	return ty;
+}
+
+AST::Type* AST::GetVectorType(AST::Type* childTy, uint64_t elements) {
+
+	AST::Type*& ty = vector_types[std::make_pair(childTy, elements)];
+
+	if(ty == nullptr) {
+		ty = Arena::New<AST::Vector>(childTy, elements);
+	}
+
+	return ty;
+}
+
+AST::Type* AST::GetRefType(AST::Type* childTy, bool isRestrict) {
+
+	AST::Type*& ty = ref_types[std::make_pair(childTy, isRestrict)];
+
+	if(ty == nullptr) {
+		ty = Arena::New<AST::Ref>(childTy, isRestrict);
+	}
+
+	return ty;
+}
+
+AST::Type* AST::GetSoAType(AST::Type* recordTy, uint64_t elements) {
+
+	AST::Type*& ty = soa_types[std::make_pair(recordTy, elements)];
+
+	if(ty == nullptr) {
+		ty = Arena::New<AST::SoA>(recordTy, elements);
+	}
+
+	return ty;
+}
+
+AST::Type* AST::FindRecordType(std::string_view name) {
+
+	auto it = record_types.find(name);
+
+	if(it == record_types.end()) {
+		return nullptr;
+	}
+
+	return it->second;
+}
+
+void AST::Reset() {
+
+	array_types.clear();
+	vector_types.clear();
+	ref_types.clear();
+	soa_types.clear();
+	record_types.clear();
+
+	slash_t_count = 0;
+
+	Arena::Reset();
+}
+
+// Flags the builder puts on every float operation of a program or procedure.
+static llvm::FastMathFlags GetFastMathFlags(const AST::Attributes& attrs) {
+
+	llvm::FastMathFlags FMF;
+
+	if(attrs.isFastMath) {
+		FMF.setFast();
+	}
+
+	return FMF;
+}
 
 llvm::Function* AST::Program::codegen() {
 
+	llvm::IRBuilderBase::FastMathFlagGuard fastMathGuard(*CodeGen::Builder);
+	CodeGen::Builder->setFastMathFlags(GetFastMathFlags(attrs));
+
 	std::vector<llvm::Type*> llvmArgs;
 
 	llvm::FunctionType* FT = llvm::FunctionType::get(llvm::IntegerType::getInt32Ty(*CodeGen::TheContext), llvmArgs, false);
@@ -17,23 +109,33 @@ llvm::Function* AST::Program::codegen() {
 
 	for(int i = 0; i < all_instructions.size(); i++) {
 
+		// Timed by statement kind. Nested statements are part of the one they are in.
+		Timing::Scope statement("codegen", typeid(*all_instructions[i]));
+
 		all_instructions[i]->codegen();
 	}
 
-	CodeGen::UpdateAllPHIPreds();
+	CodeGen::SealAllBlocks();
+	CodeGen::FinishAliasScopes();
 
 	// mustprogress nofree norecurse nosync nounwind readnone willreturn
 
 	F->addFnAttr(llvm::Attribute::MustProgress);
 	F->addFnAttr(llvm::Attribute::NoFree);
 	F->addFnAttr(llvm::Attribute::NoRecurse);
-	F->addFnAttr(llvm::Attribute::NoSync);
 
 	if(!attrs.isStackProtected) {
 		F->addFnAttr(llvm::Attribute::NoUnwind);
 	}
 
-	F->addFnAttr(llvm::Attribute::ReadNone);
+	// 'parfor' loops wait on the worker threads of libmascalrt, which touch its globals.
+	// Globals ([Static] and big mems) are written by 'main' or the procedures it calls.
+	// Procedures are generated before 'main', so the module has all of its globals here.
+	if(!CodeGen::usesRuntime && CodeGen::TheModule->global_empty()) {
+		F->addFnAttr(llvm::Attribute::NoSync);
+		F->addFnAttr(llvm::Attribute::ReadNone);
+	}
+
 	F->addFnAttr(llvm::Attribute::WillReturn);
 
 	F->setCallingConv(llvm::CallingConv::GHC);
@@ -48,21 +150,239 @@ llvm::Type* AST::Integer16::codegen() { return llvm::IntegerType::getInt16Ty(*Co
 llvm::Type* AST::Integer8::codegen() { return llvm::IntegerType::getInt8Ty(*CodeGen::TheContext); }
 llvm::Type* AST::Integer1::codegen() { return llvm::IntegerType::getInt1Ty(*CodeGen::TheContext); }
 
+llvm::Type* AST::Float64::codegen() { return llvm::Type::getDoubleTy(*CodeGen::TheContext); }
+llvm::Type* AST::Float32::codegen() { return llvm::Type::getFloatTy(*CodeGen::TheContext); }
+
 llvm::Type* AST::Void::codegen() { return llvm::IntegerType::getVoidTy(*CodeGen::TheContext); }
 
 llvm::Type* AST::Array::codegen() { return llvm::ArrayType::get(childTy->codegen(), elements); }
 
+llvm::Type* AST::Vector::codegen() { return llvm::FixedVectorType::get(childTy->codegen(), elements); }
+
 llvm::Type* AST::Ref::codegen() { return llvm::PointerType::getUnqual(*CodeGen::TheContext); }
 
+llvm::Type* AST::Record::codegen() {
+
+	if(llvm::StructType* ST = llvm::StructType::getTypeByName(*CodeGen::TheContext, recordName)) {
+		return ST;
+	}
+
+	std::vector<llvm::Type*> fields;
+
+	for(auto const& i : fieldTypes) {
+		fields.push_back(i->codegen());
+	}
+
+	if(align != 0) {
+
+		uint64_t size = CodeGen::TheModule->getDataLayout().getTypeAllocSize(llvm::StructType::get(*CodeGen::TheContext, fields, isPacked));
+		uint64_t padding = llvm::alignTo(size, align) - size;
+
+		// After the last field, so it doesn't change the index of any of them.
+		if(padding != 0) {
+			fields.push_back(llvm::ArrayType::get(llvm::IntegerType::getInt8Ty(*CodeGen::TheContext), padding));
+		}
+	}
+
+	return llvm::StructType::create(*CodeGen::TheContext, fields, recordName, isPacked);
+}
+
+llvm::Type* AST::SoA::codegen() {
+
+	AST::Record* record = dynamic_cast<AST::Record*>(childTy);
+
+	std::vector<llvm::Type*> fields;
+
+	for(auto const& i : record->fieldTypes) {
+		fields.push_back(llvm::ArrayType::get(i->codegen(), elements));
+	}
+
+	return llvm::StructType::get(*CodeGen::TheContext, fields);
+}
+
 llvm::Value* AST::RetVoid::codegen() { return nullptr; }
 
 llvm::Value* AST::ProcedureCall::codegen() {
 
-	for(auto const& i: body) {
+	llvm::Function* F = CodeGen::TheModule->getFunction(procName);
+
+	if(F == nullptr) {
+		CompilationSession::Out() << "Error: Procedure '" << procName << "' not found inside codegen.\n";
+		CompilationSession::Fail();
+	}
+
+	std::vector<llvm::Value*> args;
+
+	for(size_t i = 0; i < arguments.size(); i++) {
+
+		llvm::Value* arg = nullptr;
+
+		if(isMemArgument[i]) {
+
+			arg = AST::GetAllocaFromMem(arguments[i]);
+
+			if(arg == nullptr) {
+				CompilationSession::Out() << "Error: '" << arguments[i]->name << "' passed to a 'mem' argument of '" << procName << "' is not a mem.\n";
+				CompilationSession::Fail();
+			}
+		}
+		else {
+			arg = AST::GetOrCreateInstruction(arguments[i]);
+		}
+
+		args.push_back(arg);
+	}
+
+	return CodeGen::Builder->CreateCall(F, args);
+}
+
+llvm::Function* AST::Procedure::Declare() {
+
+	if(llvm::Function* F = CodeGen::TheModule->getFunction(procName)) {
+		return F;
+	}
+
+	std::vector<llvm::Type*> llvmArgs;
+
+	for(size_t i = 0; i < all_argument_types.size(); i++) {
+
+		if(IsMemArgument(i)) {
+			llvmArgs.push_back(llvm::PointerType::getUnqual(*CodeGen::TheContext));
+		}
+		else {
+			llvmArgs.push_back(all_argument_types[i]->codegen());
+		}
+	}
+
+	llvm::FunctionType* FT = llvm::FunctionType::get(proc_type->codegen(), llvmArgs, false);
+
+	llvm::Function* F = llvm::Function::Create(FT, llvm::Function::InternalLinkage, procName, CodeGen::TheModule.get());
+
+	int Idx = 0;
+	for(auto& arg : F->args()) {
+
+		arg.setName(all_arguments[Idx]->name);
+
+		AST::Ref* refTy = dynamic_cast<AST::Ref*>(all_argument_types[Idx]);
+
+		if(refTy != nullptr && refTy->isRestrict) {
+			arg.addAttr(llvm::Attribute::NoAlias);
+		}
+
+		if(all_argument_attrs[Idx].align != 0) {
+			arg.addAttr(llvm::Attribute::getWithAlignment(*CodeGen::TheContext, llvm::Align(all_argument_attrs[Idx].align)));
+		}
+
+		Idx++;
+	}
+
+	F->addFnAttr(llvm::Attribute::NoUnwind);
+
+	if(attrs.isInline && attrs.isNoInline) {
+		CompilationSession::Out() << "Error: Procedure '" << procName << "' can't be both 'Inline' and 'NoInline'.\n";
+		CompilationSession::Fail();
+	}
+
+	if(attrs.isHot && attrs.isCold) {
+		CompilationSession::Out() << "Error: Procedure '" << procName << "' can't be both 'Hot' and 'Cold'.\n";
+		CompilationSession::Fail();
+	}
+
+	if(attrs.isInline) {
+		F->addFnAttr(llvm::Attribute::AlwaysInline);
+	}
+
+	if(attrs.isNoInline) {
+		F->addFnAttr(llvm::Attribute::NoInline);
+	}
+
+	// Calls to cold procedures are also treated as unlikely paths by the optimizer.
+	if(attrs.isCold) {
+		F->addFnAttr(llvm::Attribute::Cold);
+	}
+
+	if(attrs.isHot) {
+		F->addFnAttr(llvm::Attribute::Hot);
+	}
+
+	return F;
+}
+
+llvm::Function* AST::Procedure::codegen() {
+
+	llvm::Function* F = Declare();
+
+	llvm::IRBuilderBase::FastMathFlagGuard fastMathGuard(*CodeGen::Builder);
+	CodeGen::Builder->setFastMathFlags(GetFastMathFlags(attrs));
+
+	// Every procedure has its own coms, mems and PHIs. Keep the ones
+	// of whatever was being generated before.
+	LLVM_Symbols oldSymbols = std::move(CodeGen::symbols);
+
+	CodeGen::symbols = LLVM_Symbols();
+
+	llvm::BasicBlock* oldInsertBlock = CodeGen::Builder->GetInsertBlock();
+
+	llvm::BasicBlock* BB = llvm::BasicBlock::Create(*CodeGen::TheContext, "entry", F);
+
+	CodeGen::Builder->SetInsertPoint(BB);
+
+	int Idx = 0;
+	for(auto& arg : F->args()) {
+
+		std::string_view argName = all_arguments[Idx]->name;
+
+		if(IsMemArgument(Idx)) {
+
+			AST::Type* argTy = all_argument_types[Idx];
+
+			AST::Ref* refTy = dynamic_cast<AST::Ref*>(argTy);
+
+			LLVM_Mem* lmem = CodeGen::AddMem(argName, &arg, refTy != nullptr ? argTy->childTy->codegen() : argTy->codegen());
+
+			if(all_argument_attrs[Idx].align != 0) {
+				lmem->align = llvm::Align(all_argument_attrs[Idx].align);
+			}
+
+			if(refTy != nullptr && refTy->isRestrict) {
+				lmem->aliasScope = CodeGen::CreateAliasScope(argName);
+			}
+		}
+		else {
+
+			CodeGen::AddCom(argName, &arg);
+		}
+
+		Idx++;
+	}
+
+	for(auto const& i : body) {
+
+		Timing::Scope statement("codegen", typeid(*i));
+
 		i->codegen();
 	}
 
-	return return_obj->codegen();
+	if(CodeGen::Builder->GetInsertBlock()->getTerminator() == nullptr) {
+
+		if(dynamic_cast<AST::Void*>(proc_type) != nullptr) {
+			CodeGen::Builder->CreateRetVoid();
+		}
+		else {
+			CodeGen::Builder->CreateRet(AST::GetCurrentInstructionByName(procName + "_return"));
+		}
+	}
+
+	CodeGen::SealAllBlocks();
+	CodeGen::FinishAliasScopes();
+
+	CodeGen::symbols = std::move(oldSymbols);
+
+	if(oldInsertBlock != nullptr) {
+		CodeGen::Builder->SetInsertPoint(oldInsertBlock);
+	}
+
+	return F;
 }
 
 llvm::Value* AST::IntNumber::codegen() {
@@ -73,413 +393,1182 @@ llvm::Value* AST::IntNumber::codegen() {
 	if(isa<llvm::IntegerType>(ty_codegen)) {
 		int_ty = dyn_cast<llvm::IntegerType>(ty_codegen);
 	}
-	else if(dynamic_cast<AST::Ref*>(ty.get()) != nullptr) {
+	else if(dynamic_cast<AST::Vector*>(ty) != nullptr) {
+
+		// Numbers used with a vector are the same number in every lane.
+		llvm::Constant* lane = llvm::ConstantInt::get(ty->childTy->codegen(), num, true);
+
+		return llvm::ConstantVector::getSplat(llvm::ElementCount::getFixed(dynamic_cast<AST::Vector*>(ty)->elements), lane);
+	}
+	else if(dynamic_cast<AST::Ref*>(ty) != nullptr) {
 		llvm::Type* childTy_codegen = ty->childTy->codegen();
 
 		if(isa<llvm::IntegerType>(childTy_codegen)) {
 			int_ty = dyn_cast<llvm::IntegerType>(childTy_codegen);
 		}
 		else {
-			std::cout << "Oopsie daisy!\n";
+			CompilationSession::Out() << "Oopsie daisy!\n";
+			CompilationSession::Fail();
 		}
 	}
 	else {
-		std::cout << "Oops!\n";
-		exit(1);
+		CompilationSession::Out() << "Oops!\n";
+		CompilationSession::Fail();
+	}
+
+	return llvm::ConstantInt::get(*CodeGen::TheContext, llvm::APInt(int_ty->getBitWidth(), num, true));
+}
+
+llvm::Value* AST::FloatNumber::codegen() {
+
+	llvm::Type* ty_codegen = ty->codegen();
+
+	// 'Ref<f32>' targets take the type of what they point to.
+	if(dynamic_cast<AST::Ref*>(ty) != nullptr) {
+		ty_codegen = ty->childTy->codegen();
+	}
+
+	if(!ty_codegen->isFPOrFPVectorTy()) {
+		CompilationSession::Out() << "Error: Float number '" << num << "' used as an integer.\n";
+		CompilationSession::Fail();
+	}
+
+	// Splatted when 'ty' is a vector.
+	return llvm::ConstantFP::get(ty_codegen, num);
+}
+
+llvm::Value* AST::Variable::codegen() {
+
+	if(!areInitializersGenerated) {
+
+		for(auto const& i : initializers) {
+			i->codegen();
+		}
+
+		areInitializersGenerated = true;
+	}
+
+	llvm::Value* result = AST::GetCurrentInstructionByName(name);
+
+	if(result == nullptr) {
+
+		CompilationSession::Out() << "Unknown variable '" << name << "'\n";
+		CompilationSession::Fail();
+	}
+
+	return result;
+}
+
+llvm::Value* AST::Com::codegen() {
+
+	llvm::Value* tc;
+
+	llvm::Type* get_type = ty->codegen();
+
+	if(target != nullptr) { tc = AST::GetOrCreateInstruction(target); }
+	else { tc = CodeGen::DefaultFromType(get_type); }
+
+	CodeGen::AddCom(name, tc);
+
+	return tc;
+}
+
+// '[Align(n)]' of the records held by a mem of type 'ty', or 0.
+static uint64_t RecordAlign(AST::Type* ty) {
+
+	while(dynamic_cast<AST::Array*>(ty) != nullptr || dynamic_cast<AST::SoA*>(ty) != nullptr) {
+		ty = ty->childTy;
+	}
+
+	if(AST::Record* record = dynamic_cast<AST::Record*>(ty)) {
+		return record->align;
+	}
+
+	return 0;
+}
+
+// Name of the mem an address is computed from ('GEL' / 'GEF'), or "".
+static std::string_view AddressBase(AST::Expression* e) {
+
+	if(AST::GEL* gel = dynamic_cast<AST::GEL*>(e)) {
+		return gel->array->name;
+	}
+
+	if(AST::GEF* gef = dynamic_cast<AST::GEF*>(e)) {
+		return gef->base->name;
+	}
+
+	return "";
+}
+
+llvm::Value* AST::Mem::codegen() {
+
+	llvm::Value* tc = nullptr;
+
+	llvm::Type* get_type = ty->codegen();
+
+	if(target != nullptr) { tc = AST::GetOrCreateInstruction(target); }
+	else { tc = CodeGen::DefaultFromType(get_type); }
+
+	bool isRef = dynamic_cast<AST::Ref*>(ty) != nullptr;
+
+	if(isRef) {
+
+		// Whatever the reference points to must outlive it.
+		CodeGen::KeepAlive(llvm::getUnderlyingObject(tc));
+
+		LLVM_Mem* lmem = CodeGen::AddMem(name, tc, ty->childTy->codegen());
+
+		if(attrs.align != 0) {
+
+			// Also tells LLVM about the addresses computed from it.
+			CodeGen::Builder->CreateAlignmentAssumption(CodeGen::TheModule->getDataLayout(), tc, attrs.align);
+
+			lmem->align = llvm::Align(attrs.align);
+		}
+
+		// Fields of a '[Packed]' record can be anywhere.
+		else if(AST::GEF* gef = dynamic_cast<AST::GEF*>(target); gef != nullptr && gef->record->isPacked) {
+			lmem->align = llvm::Align(1);
+		}
+
+		std::string_view base = AddressBase(target);
+
+		if(dynamic_cast<AST::Ref*>(ty)->isRestrict) {
+			lmem->aliasScope = CodeGen::CreateAliasScope(name);
+		}
+		else if(LLVM_Mem* baseMem = base != "" ? CodeGen::FindMem(base) : nullptr) {
+			lmem->aliasScope = baseMem->aliasScope;
+		}
+
+		return lmem->origin;
 	}
 
-	return llvm::ConstantInt::get(*CodeGen::TheContext, llvm::APInt(int_ty->getBitWidth(), num, true));
-}
+	llvm::BasicBlock* bb = CodeGen::Builder->GetInsertBlock();
+
+	// 'main' only runs once, so its big arrays (or records) don't need to be on the stack.
+	bool isLargeMainArray = get_type->isAggregateType() && bb->getParent()->getName() == "main" &&
+							CodeGen::TheModule->getDataLayout().getTypeAllocSize(get_type) >= CodeGen::staticMemThreshold;
+
+	uint64_t memAlign = std::max<uint64_t>(attrs.align, RecordAlign(ty));
+
+	if(attrs.isStatic || isLargeMainArray) {
+
+		llvm::Constant* init = dyn_cast<llvm::Constant>(tc);
+
+		// The loader initializes the global when the declaration can't run again.
+		bool initOnce = init != nullptr && (attrs.isStatic || bb->isEntryBlock());
+
+		llvm::GlobalVariable* G = CodeGen::CreateStaticMem(get_type, name, initOnce ? init : CodeGen::DefaultFromType(get_type));
+
+		if(memAlign != 0) {
+			G->setAlignment(std::max(CodeGen::TheModule->getDataLayout().getPrefTypeAlign(get_type), llvm::Align(memAlign)));
+		}
+
+		if(!initOnce) {
+			CodeGen::StoreInitializer(G, tc);
+		}
+
+		return CodeGen::AddMem(name, G, get_type)->origin;
+	}
+
+	llvm::AllocaInst* alloca = CodeGen::CreateEntryAlloca(get_type, name);
+
+	if(memAlign != 0) {
+		alloca->setAlignment(std::max(alloca->getAlign(), llvm::Align(memAlign)));
+	}
+
+	LLVM_Mem* lmem = CodeGen::AddMem(name, alloca, get_type);
+
+	CodeGen::StartLifetime(lmem);
+
+	CodeGen::StoreInitializer(lmem->origin, tc);
+
+	return lmem->origin;
+}
+
+// Signed conversion between any two number types (or vectors of them).
+static llvm::Value* CreateNumericCast(llvm::Value* v, llvm::Type* to, std::string_view name = "") {
+
+	llvm::Type* from = v->getType();
+
+	llvm::StringRef nameRef(name.data(), name.size());
+
+	if(from == to) {
+		return v;
+	}
+
+	if(from->isFPOrFPVectorTy() && to->isFPOrFPVectorTy()) {
+		return CodeGen::Builder->CreateFPCast(v, to, nameRef);
+	}
+
+	if(from->isFPOrFPVectorTy()) {
+		return CodeGen::Builder->CreateFPToSI(v, to, nameRef);
+	}
+
+	if(to->isFPOrFPVectorTy()) {
+		return CodeGen::Builder->CreateSIToFP(v, to, nameRef);
+	}
+
+	return CodeGen::Builder->CreateIntCast(v, to, true, nameRef);
+}
+
+// Bitwise operations and shifts don't exist for floats.
+static void CheckIntegerOperand(llvm::Value* v, std::string_view op) {
+
+	if(v->getType()->isFPOrFPVectorTy()) {
+		CompilationSession::Out() << "Error: '" << op << "' can't be used with floats.\n";
+		CompilationSession::Fail();
+	}
+}
+
+// Scalars mixed with vectors are used in every lane.
+static llvm::Value* SplatToMatch(llvm::Value* v, llvm::Value* other) {
+
+	llvm::FixedVectorType* vecTy = dyn_cast<llvm::FixedVectorType>(other->getType());
+
+	if(vecTy == nullptr || v->getType()->isVectorTy()) {
+		return v;
+	}
+
+	v = CreateNumericCast(v, vecTy->getElementType());
+
+	return CodeGen::Builder->CreateVectorSplat(vecTy->getNumElements(), v, "splat");
+}
+
+static llvm::Value* CastToLane(llvm::Value* v, llvm::Type* laneTy) {
+
+	return CreateNumericCast(v, laneTy);
+}
+
+llvm::Value* AST::Add::codegen() {
+
+	llvm::Value* L = AST::GetOrCreateInstruction(target);
+	llvm::Value* R = SplatToMatch(AST::GetOrCreateInstruction(value), L);
+
+	std::string finalName = std::string("add") + std::string(target->name);
+
+	llvm::Value* result = nullptr;
+
+	if(L->getType()->isFPOrFPVectorTy()) { result = CodeGen::Builder->CreateFAdd(L, CreateNumericCast(R, L->getType()), finalName.c_str()); }
+	else { result = CodeGen::Builder->CreateAdd(L, R, finalName.c_str()); }
+
+	AST::AddInstruction(target, result);
+
+	return result;
+}
+
+llvm::Value* AST::Sub::codegen() {
+
+	llvm::Value* L = AST::GetOrCreateInstruction(target);
+	llvm::Value* R = SplatToMatch(AST::GetOrCreateInstruction(value), L);
+
+	std::string finalName = std::string("sub") + std::string(target->name);
+
+	llvm::Value* result = nullptr;
+
+	if(L->getType()->isFPOrFPVectorTy()) { result = CodeGen::Builder->CreateFSub(L, CreateNumericCast(R, L->getType()), finalName.c_str()); }
+	else { result = CodeGen::Builder->CreateSub(L, R, finalName.c_str()); }
+
+	AST::AddInstruction(target, result);
+
+	return result;
+}
+
+llvm::Value* AST::And::codegen() {
+
+	llvm::Value* L = AST::GetOrCreateInstruction(target);
+	llvm::Value* R = SplatToMatch(AST::GetOrCreateInstruction(value), L);
+
+	CheckIntegerOperand(L, "and");
+
+	std::string finalName = std::string("and") + std::string(target->name);
+
+	llvm::Value* result = CodeGen::Builder->CreateAnd(L, R, finalName.c_str());
+
+	AST::AddInstruction(target, result);
+
+	return result;
+}
+
+llvm::Value* AST::Or::codegen() {
+
+	llvm::Value* L = AST::GetOrCreateInstruction(target);
+	llvm::Value* R = SplatToMatch(AST::GetOrCreateInstruction(value), L);
+
+	CheckIntegerOperand(L, "or");
+
+	std::string finalName = std::string("or") + std::string(target->name);
+
+	llvm::Value* result = CodeGen::Builder->CreateOr(L, R, finalName.c_str());
+
+	AST::AddInstruction(target, result);
+
+	return result;
+}
+
+llvm::Value* AST::Xor::codegen() {
+
+	llvm::Value* L = AST::GetOrCreateInstruction(target);
+	llvm::Value* R = SplatToMatch(AST::GetOrCreateInstruction(value), L);
+
+	CheckIntegerOperand(L, "xor");
+
+	std::string finalName = std::string("xor") + std::string(target->name);
+
+	llvm::Value* result = CodeGen::Builder->CreateXor(L, R, finalName.c_str());
+
+	AST::AddInstruction(target, result);
+
+	return result;
+}
+
+llvm::Value* AST::IntCast::codegen() {
+
+	llvm::Value* targetC = AST::GetOrCreateInstruction(target);
+	llvm::Type* typeC = intType->codegen();
+
+	return CreateNumericCast(targetC, typeC, target->name);
+}
+
+llvm::Value* AST::ComStore::codegen() {
+
+	llvm::Value* result = AST::GetOrCreateInstruction(value);
+
+	AST::AddInstruction(target, result);
+
+	return result;
+}
+
+llvm::Value* AST::GetAllocaFromMem(AST::Expression* e) {
+
+	return GetAllocaFromMemByName(e->name);
+}
+
+llvm::Value* AST::GetAllocaFromMemByName(std::string_view name) {
+
+	if(LLVM_Mem* lmem = CodeGen::FindMem(name)) {
+		return lmem->origin;
+	}
+
+	return nullptr;
+}
+
+llvm::Value* AST::MemStore::codegen() {
+
+	llvm::Value* result = AST::GetOrCreateInstruction(value);
+
+	llvm::Value* mem_alloca = AST::GetAllocaFromMem(target);
+
+	if(mem_alloca == nullptr) {
+		CompilationSession::Out() << "Error: Mem Origin not found for 'memstore'.\n";
+		CompilationSession::Fail();
+	}
+
+	LLVM_Mem* lmem = CodeGen::FindMem(target->name);
+
+	llvm::StoreInst* store = CodeGen::Builder->CreateAlignedStore(result, mem_alloca, lmem->align);
+
+	CodeGen::AddScopedAccess(store, lmem);
+
+	return store;
+}
+
+llvm::Value* AST::LoadMem::codegen() {
+
+	llvm::Value* mem_alloca = AST::GetAllocaFromMem(target);
+
+	if(mem_alloca == nullptr) {
+		CompilationSession::Out() << "Error: Mem Origin not found for 'loadmem'.\n";
+		CompilationSession::Fail();
+	}
+
+	LLVM_Mem* lmem = CodeGen::FindMem(target->name);
+
+	llvm::LoadInst* load = CodeGen::Builder->CreateAlignedLoad(lmem->ty, mem_alloca, lmem->align, target->name);
+
+	CodeGen::AddScopedAccess(load, lmem);
+
+	return load;
+}
+
+llvm::Value* AST::Arithmetic::codegen() {
+
+	llvm::Value* L = AST::GetOrCreateInstruction(target);
+	llvm::Value* R = AST::GetOrCreateInstruction(value);
+
+	bool isUnsigned = arith_type == ArithmeticType::UMul || arith_type == ArithmeticType::UDiv ||
+					  arith_type == ArithmeticType::URem || arith_type == ArithmeticType::UShr;
+
+	std::string finalName = GetKeyword(arith_type) + std::string(target->name);
+
+	llvm::Value* result = nullptr;
+
+	if(L->getType()->isFPOrFPVectorTy()) {
+
+		if(R->getType()->isVectorTy()) {
+			R = CreateNumericCast(R, L->getType());
+		}
+		else {
+			R = SplatToMatch(CreateNumericCast(R, L->getType()->getScalarType()), L);
+		}
+
+		if(arith_type == ArithmeticType::Mul) { result = CodeGen::Builder->CreateFMul(L, R, finalName); }
+		else if(arith_type == ArithmeticType::Div) { result = CodeGen::Builder->CreateFDiv(L, R, finalName); }
+		else if(arith_type == ArithmeticType::Rem) { result = CodeGen::Builder->CreateFRem(L, R, finalName); }
+		else {
+			CheckIntegerOperand(L, GetKeyword(arith_type));
+		}
+
+		AST::AddInstruction(target, result);
+
+		return result;
+	}
+
+	// Shift amounts are often of another width than the value being shifted.
+	if(R->getType()->isIntegerTy() && R->getType() != L->getType()->getScalarType()) {
+		R = CodeGen::Builder->CreateIntCast(R, L->getType()->getScalarType(), !isUnsigned);
+	}
+
+	R = SplatToMatch(R, L);
+
+	// Signed overflow of 'mul' and unsigned overflow of 'umul' are undefined, like in C.
+	if(arith_type == ArithmeticType::Mul) { result = CodeGen::Builder->CreateMul(L, R, finalName, false, true); }
+	else if(arith_type == ArithmeticType::UMul) { result = CodeGen::Builder->CreateMul(L, R, finalName, true, false); }
+	else if(arith_type == ArithmeticType::Div) { result = CodeGen::Builder->CreateSDiv(L, R, finalName); }
+	else if(arith_type == ArithmeticType::UDiv) { result = CodeGen::Builder->CreateUDiv(L, R, finalName); }
+	else if(arith_type == ArithmeticType::Rem) { result = CodeGen::Builder->CreateSRem(L, R, finalName); }
+	else if(arith_type == ArithmeticType::URem) { result = CodeGen::Builder->CreateURem(L, R, finalName); }
+	else if(arith_type == ArithmeticType::Shl) { result = CodeGen::Builder->CreateShl(L, R, finalName); }
+	else if(arith_type == ArithmeticType::Shr) { result = CodeGen::Builder->CreateAShr(L, R, finalName); }
+	else if(arith_type == ArithmeticType::UShr) { result = CodeGen::Builder->CreateLShr(L, R, finalName); }
+
+	AST::AddInstruction(target, result);
+
+	return result;
+}
+
+llvm::Value* AST::Compare::codegen() {
+
+	llvm::Value* L = AST::GetOrCreateInstruction(compareOne);
+	llvm::Value* R = AST::GetOrCreateInstruction(compareTwo);
+
+	// Vectors are compared lane by lane, giving a vector of i1.
+	L = SplatToMatch(L, R);
+	R = SplatToMatch(R, L);
+
+	llvm::Value* comp = nullptr;
+
+	if(R->getType()->isFPOrFPVectorTy()) {
+		L = CreateNumericCast(L, R->getType());
+	}
+
+	// Ordered: false when either side is NaN, except for 'IsNotEquals'.
+	if(L->getType()->isFPOrFPVectorTy()) {
+
+		R = CreateNumericCast(R, L->getType());
+
+		if(cmp_type == AST::CompareType::IsLessThan) { comp = CodeGen::Builder->CreateFCmpOLT(L, R, "cmptmp"); }
+		if(cmp_type == AST::CompareType::IsMoreThan) { comp = CodeGen::Builder->CreateFCmpOGT(L, R, "cmptmp"); }
+		if(cmp_type == AST::CompareType::IsEquals) { comp = CodeGen::Builder->CreateFCmpOEQ(L, R, "cmptmp"); }
+		if(cmp_type == AST::CompareType::IsNotEquals) { comp = CodeGen::Builder->CreateFCmpUNE(L, R, "cmptmp"); }
+		if(cmp_type == AST::CompareType::IsLessThanOrEquals) { comp = CodeGen::Builder->CreateFCmpOLE(L, R, "cmptmp"); }
+		if(cmp_type == AST::CompareType::IsMoreThanOrEquals) { comp = CodeGen::Builder->CreateFCmpOGE(L, R, "cmptmp"); }
+
+		if(comp == nullptr) {
+			CompilationSession::Out() << "Error: Floats can't be compared as unsigned numbers.\n";
+			CompilationSession::Fail();
+		}
+
+		return comp;
+	}
+
+	if(cmp_type == AST::CompareType::IsLessThan) { comp = CodeGen::Builder->CreateICmpSLT(L, R, "cmptmp"); }
+	if(cmp_type == AST::CompareType::IsMoreThan) { comp = CodeGen::Builder->CreateICmpSGT(L, R, "cmptmp"); }
+	if(cmp_type == AST::CompareType::IsEquals) { comp = CodeGen::Builder->CreateICmpEQ(L, R, "cmptmp"); }
+	if(cmp_type == AST::CompareType::IsNotEquals) { comp = CodeGen::Builder->CreateICmpNE(L, R, "cmptmp"); }
+	if(cmp_type == AST::CompareType::IsLessThanOrEquals) { comp = CodeGen::Builder->CreateICmpSLE(L, R, "cmptmp"); }
+	if(cmp_type == AST::CompareType::IsMoreThanOrEquals) { comp = CodeGen::Builder->CreateICmpSGE(L, R, "cmptmp"); }
+	if(cmp_type == AST::CompareType::IsBelow) { comp = CodeGen::Builder->CreateICmpULT(L, R, "cmptmp"); }
+	if(cmp_type == AST::CompareType::IsAbove) { comp = CodeGen::Builder->CreateICmpUGT(L, R, "cmptmp"); }
+	if(cmp_type == AST::CompareType::IsBelowOrEquals) { comp = CodeGen::Builder->CreateICmpULE(L, R, "cmptmp"); }
+	if(cmp_type == AST::CompareType::IsAboveOrEquals) { comp = CodeGen::Builder->CreateICmpUGE(L, R, "cmptmp"); }
+
+	return comp;
+}
+
+bool AST::IsInitializer(AST::Expression* t) {
+
+	return dynamic_cast<AST::Com*>(t) != nullptr || dynamic_cast<AST::Mem*>(t) != nullptr || dynamic_cast<AST::LoadMem*>(t) != nullptr;
+}
+
+bool AST::IsAlgorithm(AST::Expression* t) {
+
+	return dynamic_cast<AST::If*>(t) != nullptr || dynamic_cast<AST::While*>(t) != nullptr || dynamic_cast<AST::Block*>(t) != nullptr;
+}
+
+llvm::Value* AST::GetOrigin(std::string_view name) {
+
+	if(LLVM_Com* lcom = CodeGen::FindCom(name)) {
+		return lcom->origin;
+	}
+
+	if(LLVM_Mem* lmem = CodeGen::FindMem(name)) {
+		return lmem->origin;
+	}
+
+	return nullptr;
+}
+
+llvm::Value* AST::GetCurrent(std::string_view name) {
+
+	if(LLVM_Com* lcom = CodeGen::FindCom(name)) {
+		return CodeGen::ReadCom(lcom, CodeGen::Builder->GetInsertBlock());
+	}
+
+	if(LLVM_Mem* lmem = CodeGen::FindMem(name)) {
+		return lmem->current;
+	}
+
+	return nullptr;
+}
+
+// 'llvm.loop' metadata for the back edges of a loop, nullptr when there's nothing to say.
+// Only loops known to terminate get 'mustprogress'.
+static llvm::MDNode* CreateLoopMetadata(const AST::Attributes& attrs, bool isFinite) {
+
+	llvm::LLVMContext& C = *CodeGen::TheContext;
+
+	// The first operand is the loop ID itself.
+	std::vector<llvm::Metadata*> ops = { nullptr };
+
+	if(isFinite) {
+		ops.push_back(llvm::MDNode::get(C, llvm::MDString::get(C, "llvm.loop.mustprogress")));
+	}
+
+	if(attrs.unrollCount > 0) {
+		ops.push_back(llvm::MDNode::get(C, { llvm::MDString::get(C, "llvm.loop.unroll.count"), llvm::ConstantAsMetadata::get(CodeGen::Builder->getInt32(attrs.unrollCount)) }));
+	}
+
+	if(attrs.vectorizeWidth > 0) {
+		ops.push_back(llvm::MDNode::get(C, { llvm::MDString::get(C, "llvm.loop.vectorize.enable"), llvm::ConstantAsMetadata::get(CodeGen::Builder->getTrue()) }));
+		ops.push_back(llvm::MDNode::get(C, { llvm::MDString::get(C, "llvm.loop.vectorize.width"), llvm::ConstantAsMetadata::get(CodeGen::Builder->getInt32(attrs.vectorizeWidth)) }));
+	}
+
+	if(ops.size() == 1) {
+		return nullptr;
+	}
+
+	llvm::MDNode* loopID = llvm::MDNode::getDistinct(C, ops);
+	loopID->replaceOperandWith(0, loopID);
+
+	return loopID;
+}
+
+llvm::Value* AST::While::codegen() {
+
+	llvm::Value* conditionCodegen = AST::GetOrCreateInstruction(condition);
+
+	llvm::Function *TheFunction = CodeGen::Builder->GetInsertBlock()->getParent();
+
+	llvm::BasicBlock* LoopBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "while", TheFunction);
+	llvm::BasicBlock* ContinueBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "continue");
+
+	for(auto const& i : loop_body) {
+
+		if(i->target != nullptr) {
+
+			if(dynamic_cast<AST::Variable*>(i->target) != nullptr) {
+
+				auto T = dynamic_cast<AST::Variable*>(i->target);
+
+				for(auto const& inits : T->initializers) {
+
+					inits->codegen();
+				}
+
+				i->target->areInitializersGenerated = true;
+			}
+		}
+	}
+
+	CodeGen::Builder->CreateCondBr(conditionCodegen, LoopBlock, ContinueBlock);
+
+	CodeGen::Builder->SetInsertPoint(LoopBlock);
+
+	for(auto const& i: loop_body) {
+		i->codegen();
+	}
+
+	llvm::Instruction* backEdge = CodeGen::Builder->CreateCondBr(repeat_condition->codegen(), LoopBlock, ContinueBlock);
+
+	backEdge->setMetadata(llvm::LLVMContext::MD_loop, CreateLoopMetadata(attrs, false));
+
+	// The back edge is known now.
+	CodeGen::SealBlock(LoopBlock);
+
+	CodeGen::EndScope(LoopBlock);
+
+	auto currentBlock = CodeGen::Builder->GetInsertBlock();
+
+	CodeGen::EndScope(currentBlock);
+
+	TheFunction->insert(TheFunction->end(), ContinueBlock);
+	CodeGen::Builder->SetInsertPoint(ContinueBlock);
+
+	CodeGen::SealBlock(ContinueBlock);
+
+	return nullptr;
+}
+
+// Lowered to the shape LLVM's loop passes expect: a guard, a preheader,
+// a single induction PHI and one latch, so SCEV can compute the trip count.
+llvm::Value* AST::For::codegen() {
+
+	llvm::Type* T = ty->codegen();
+
+	if(!T->isIntegerTy()) {
+		CompilationSession::Out() << "Error: 'for' loop variable '" << name << "' must be an integer.\n";
+		CompilationSession::Fail();
+	}
+
+	llvm::Value* startCG = CodeGen::Builder->CreateIntCast(AST::GetOrCreateInstruction(start), T, true);
+	llvm::Value* endCG = CodeGen::Builder->CreateIntCast(AST::GetOrCreateInstruction(end), T, true);
+
+	llvm::ConstantInt* stepCG = llvm::ConstantInt::get(llvm::cast<llvm::IntegerType>(T), 1);
+
+	if(step != nullptr) {
+
+		stepCG = dyn_cast<llvm::ConstantInt>(CodeGen::Builder->CreateIntCast(AST::GetOrCreateInstruction(step), T, true));
+
+		if(stepCG == nullptr || stepCG->isZero()) {
+			CompilationSession::Out() << "Error: 'step' of 'for' loop '" << name << "' must be a constant other than 0.\n";
+			CompilationSession::Fail();
+		}
+	}
+
+	bool isCountingDown = stepCG->isNegative();
+
+	llvm::Function *TheFunction = CodeGen::Builder->GetInsertBlock()->getParent();
+
+	llvm::BasicBlock* PreheaderBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "for.preheader", TheFunction);
+	llvm::BasicBlock* LoopBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "for", TheFunction);
+	llvm::BasicBlock* ContinueBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "continue");
+
+	llvm::Value* guard = isCountingDown ? CodeGen::Builder->CreateICmpSGE(startCG, endCG) : CodeGen::Builder->CreateICmpSLE(startCG, endCG);
+
+	CodeGen::Builder->CreateCondBr(guard, PreheaderBlock, ContinueBlock);
+
+	CodeGen::Builder->SetInsertPoint(PreheaderBlock);
+
+	CodeGen::SealBlock(PreheaderBlock);
+
+	// The last value the loop variable takes. The latch compares against it before
+	// stepping, so an 'end' near the limits of the type can't make the step overflow.
+	// Past the guard, the distance between 'start' and 'end' fits in the type as unsigned.
+	llvm::Value* lastCG = endCG;
+
+	if(!stepCG->isOne() && !stepCG->isMinusOne()) {
+
+		llvm::Value* distance = isCountingDown ? CodeGen::Builder->CreateSub(startCG, endCG) : CodeGen::Builder->CreateSub(endCG, startCG);
+
+		llvm::Constant* stepSize = llvm::ConstantInt::get(T, stepCG->getValue().abs());
+
+		llvm::Value* span = CodeGen::Builder->CreateMul(CodeGen::Builder->CreateUDiv(distance, stepSize), stepSize);
+
+		lastCG = isCountingDown ? CodeGen::Builder->CreateSub(startCG, span, "for.last") : CodeGen::Builder->CreateAdd(startCG, span, "for.last");
+	}
+
+	CodeGen::Builder->CreateBr(LoopBlock);
+
+	CodeGen::Builder->SetInsertPoint(LoopBlock);
+
+	llvm::PHINode* IV = CodeGen::Builder->CreatePHI(T, 2, name);
+	IV->addIncoming(startCG, PreheaderBlock);
+
+	// Writes to the loop variable in the body don't change the iteration count.
+	CodeGen::AddCom(name, IV);
+
+	for(auto const& i: loop_body) {
+		i->codegen();
+	}
+
+	llvm::BasicBlock* LatchBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "for.latch", TheFunction);
+
+	if(CodeGen::Builder->GetInsertBlock()->getTerminator() == nullptr) {
+		CodeGen::Builder->CreateBr(LatchBlock);
+	}
+
+	CodeGen::EndScope(LoopBlock);
+
+	auto currentBlock = CodeGen::Builder->GetInsertBlock();
+
+	CodeGen::EndScope(currentBlock);
+
+	CodeGen::Builder->SetInsertPoint(LatchBlock);
+
+	CodeGen::SealBlock(LatchBlock);
+
+	llvm::Value* repeat = CodeGen::Builder->CreateICmpNE(IV, lastCG);
+
+	// Wraps on the last iteration, where the back edge isn't taken.
+	llvm::Value* Next = CodeGen::Builder->CreateAdd(IV, stepCG, "for.next");
+	IV->addIncoming(Next, LatchBlock);
+
+	llvm::Instruction* backEdge = CodeGen::Builder->CreateCondBr(repeat, LoopBlock, ContinueBlock);
+
+	backEdge->setMetadata(llvm::LLVMContext::MD_loop, CreateLoopMetadata(attrs, true));
+
+	CodeGen::SealBlock(LoopBlock);
+
+	TheFunction->insert(TheFunction->end(), ContinueBlock);
+	CodeGen::Builder->SetInsertPoint(ContinueBlock);
+
+	CodeGen::SealBlock(ContinueBlock);
+
+	return nullptr;
+}
+
+static llvm::Constant* ReductionIdentity(int reduce_type, llvm::Type* ty) {
+
+	if(reduce_type == AST::ReduceType::ReduceAnd) {
+		return llvm::Constant::getAllOnesValue(ty);
+	}
+
+	return llvm::Constant::getNullValue(ty);
+}
+
+static llvm::Value* CreateReduction(int reduce_type, llvm::Value* L, llvm::Value* R) {
+
+	if(L->getType()->isFPOrFPVectorTy()) {
+
+		if(reduce_type != AST::ReduceType::ReduceAdd) {
+			CompilationSession::Out() << "Error: Floats can only be reduced with 'add'.\n";
+			CompilationSession::Fail();
+		}
+
+		return CodeGen::Builder->CreateFAdd(L, R, "reduce");
+	}
+
+	if(reduce_type == AST::ReduceType::ReduceAnd) { return CodeGen::Builder->CreateAnd(L, R, "reduce"); }
+	if(reduce_type == AST::ReduceType::ReduceOr) { return CodeGen::Builder->CreateOr(L, R, "reduce"); }
+	if(reduce_type == AST::ReduceType::ReduceXor) { return CodeGen::Builder->CreateXor(L, R, "reduce"); }
+
+	return CodeGen::Builder->CreateAdd(L, R, "reduce");
+}
+
+llvm::Value* AST::Parfor::codegen() {
+
+	llvm::Type* i64 = llvm::Type::getInt64Ty(*CodeGen::TheContext);
+	llvm::Type* ptrTy = llvm::PointerType::getUnqual(*CodeGen::TheContext);
+
+	const llvm::DataLayout& DL = CodeGen::TheModule->getDataLayout();
+
+	llvm::Value* loCG = CodeGen::Builder->CreateIntCast(AST::GetOrCreateInstruction(lo), i64, true);
+	llvm::Value* hiCG = CodeGen::Builder->CreateIntCast(AST::GetOrCreateInstruction(hi), i64, true);
 
-llvm::Value* AST::Variable::codegen() {
+	std::vector<llvm::Type*> reductionTypes;
 
-	if(!areInitializersGenerated) {
+	for(auto const& r : reductions) {
 
-		for(auto const& i : initializers) {
-			i->codegen();
+		LLVM_Com* lcom = CodeGen::FindCom(r.name);
+
+		if(lcom == nullptr) {
+			CompilationSession::Out() << "Error: 'reduce' target '" << r.name << "' is not a com.\n";
+			CompilationSession::Fail();
 		}
 
-		areInitializersGenerated = true;
+		if(DL.getTypeAllocSize(lcom->ty) > MASCALRT_SLOT_SIZE) {
+			CompilationSession::Out() << "Error: 'reduce' target '" << r.name << "' is bigger than " << MASCALRT_SLOT_SIZE << " bytes.\n";
+			CompilationSession::Fail();
+		}
+
+		reductionTypes.push_back(lcom->ty);
 	}
 
-	llvm::Value* result = AST::GetCurrentInstructionByName(name);
+	// void parfor(i64 lo, i64 hi, ptr ctx, i64 worker) runs the iterations [lo, hi).
+	llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getVoidTy(*CodeGen::TheContext), { i64, i64, ptrTy, i64 }, false);
+	llvm::Function* F = llvm::Function::Create(FT, llvm::Function::InternalLinkage, "parfor", CodeGen::TheModule.get());
 
-	if(result == nullptr) {
+	F->addFnAttr(llvm::Attribute::NoUnwind);
 
-		std::cout << "Unknown variable '" << name << "'\n";
-		exit(1);
-	}
+	llvm::Argument* chunkLo = F->getArg(0);
+	llvm::Argument* chunkHi = F->getArg(1);
+	llvm::Argument* ctx = F->getArg(2);
+	llvm::Argument* worker = F->getArg(3);
 
-	return result;
-}
+	chunkLo->setName("lo");
+	chunkHi->setName("hi");
+	ctx->setName("ctx");
+	worker->setName("worker");
 
-llvm::Value* AST::Com::codegen() {
+	llvm::BasicBlock* outerBlock = CodeGen::Builder->GetInsertBlock();
 
-	llvm::Value* tc;
+	// Like procedures, the body has its own coms, mems and PHIs.
+	LLVM_Symbols outer = std::move(CodeGen::symbols);
 
-	llvm::Type* get_type = ty->codegen();
+	CodeGen::symbols = LLVM_Symbols();
 
-	if(target != nullptr) { tc = AST::GetOrCreateInstruction(target.get()); }
-	else if(get_type->isArrayTy()) { tc = CodeGen::DefaultFromType(get_type, get_type->getArrayElementType()); }
-	else { tc = CodeGen::DefaultFromType(get_type); }
+	LLVM_Captures captures;
+	captures.outer = &outer;
+	captures.parent = CodeGen::captures;
+	captures.ctx = ctx;
+	captures.firstCapture = reductions.size();
 
-	std::unique_ptr<LLVM_Com> lcom = std::make_unique<LLVM_Com>();
-	lcom->origin = tc;
-	lcom->current = tc;
+	llvm::BasicBlock* Entry = llvm::BasicBlock::Create(*CodeGen::TheContext, "entry", F);
+	llvm::BasicBlock* Header = llvm::BasicBlock::Create(*CodeGen::TheContext, "parfor.header", F);
+	llvm::BasicBlock* LoopBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "parfor.body", F);
+	llvm::BasicBlock* ExitBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "parfor.exit");
 
-	CodeGen::all_coms[name] = std::move(lcom);
+	captures.entry = Entry;
 
-	CodeGen::SetOriginBlock(name);
+	CodeGen::Builder->SetInsertPoint(Entry);
 
-	AST::SaveState(name, CodeGen::Builder->GetInsertBlock());
+	// Inside the body, reduction targets are the partial of the current chunk.
+	for(size_t r = 0; r < reductions.size(); r++) {
+		CodeGen::AddCom(reductions[r].name, ReductionIdentity(reductions[r].reduce_type, reductionTypes[r]));
+	}
 
-	return CodeGen::all_coms[name]->current;
-}
+	CodeGen::Builder->CreateBr(Header);
 
-llvm::Value* AST::Mem::codegen() {
+	// Captures are loaded right before this branch.
+	CodeGen::captures = &captures;
 
-	llvm::Value* tc = nullptr;
+	CodeGen::Builder->SetInsertPoint(Header);
 
-	llvm::Type* get_type = ty->codegen();
+	llvm::PHINode* IV = CodeGen::Builder->CreatePHI(i64, 2, name);
+	IV->addIncoming(chunkLo, Entry);
 
-	if(target != nullptr) { tc = AST::GetOrCreateInstruction(target.get()); }
-	else if(get_type->isArrayTy()) { tc = CodeGen::DefaultFromType(get_type, get_type->getArrayElementType()); }
-	else { tc = CodeGen::DefaultFromType(get_type); }
+	CodeGen::AddCom(name, IV);
 
-	std::unique_ptr<LLVM_Mem> lmem = std::make_unique<LLVM_Mem>();
+	CodeGen::Builder->CreateCondBr(CodeGen::Builder->CreateICmpSLT(IV, chunkHi, "parfor.cond"), LoopBlock, ExitBlock);
 
-	llvm::Value* alloc_origin = nullptr;
+	CodeGen::Builder->SetInsertPoint(LoopBlock);
 
-	bool isRef = dynamic_cast<AST::Ref*>(ty.get()) != nullptr;
+	CodeGen::SealBlock(LoopBlock);
 
-	if(!isRef) {
-		alloc_origin = CodeGen::Builder->CreateAlloca(get_type, 0, name);
-	}
-	else {
-		alloc_origin = tc;
+	for(auto const& i : loop_body) {
+		i->codegen();
 	}
 
-	lmem->origin = alloc_origin;
+	llvm::BasicBlock* Latch = llvm::BasicBlock::Create(*CodeGen::TheContext, "parfor.latch", F);
 
-	if(!isRef) {
-		CodeGen::Builder->CreateStore(tc, lmem->origin);
-	}
+	CodeGen::Builder->CreateBr(Latch);
 
-	lmem->current = alloc_origin;
+	CodeGen::Builder->SetInsertPoint(Latch);
 
-	if(!isRef) {
-		lmem->ty = get_type;
-	}
-	else {
-		lmem->ty = ty->childTy->codegen();
-	}
+	CodeGen::SealBlock(Latch);
 
-	CodeGen::all_mems[name] = std::move(lmem);
+	llvm::Value* Next = CodeGen::Builder->CreateAdd(IV, CodeGen::Builder->getInt64(1), "parfor.next", false, true);
+	IV->addIncoming(Next, Latch);
 
-	CodeGen::SetOriginBlock(name);
+	CodeGen::Builder->CreateBr(Header);
 
-	return CodeGen::all_mems[name]->origin;
-}
+	CodeGen::SealBlock(Header);
 
-llvm::Value* AST::Add::codegen() {
+	F->insert(F->end(), ExitBlock);
+	CodeGen::Builder->SetInsertPoint(ExitBlock);
 
-	llvm::Value* L = AST::GetOrCreateInstruction(target.get());
-	llvm::Value* R = AST::GetOrCreateInstruction(value.get());
+	CodeGen::SealBlock(ExitBlock);
 
-	std::string finalName = std::string("add") + target->name;
+	// Only this worker writes its slot, so merging the chunk needs no atomics.
+	llvm::Value* slotOffset = CodeGen::Builder->CreateMul(worker, CodeGen::Builder->getInt64(MASCALRT_SLOT_SIZE));
 
-	llvm::Value* result = CodeGen::Builder->CreateAdd(L, R, finalName.c_str());
+	for(size_t r = 0; r < reductions.size(); r++) {
 
-	AST::AddInstruction(target.get(), result);
+		llvm::Value* partials = CodeGen::Builder->CreateLoad(ptrTy, CodeGen::Builder->CreateConstInBoundsGEP1_64(ptrTy, ctx, r));
+		llvm::Value* slot = CodeGen::Builder->CreateInBoundsGEP(CodeGen::Builder->getInt8Ty(), partials, slotOffset);
 
-	return result;
-}
+		llvm::Value* old = CodeGen::Builder->CreateLoad(reductionTypes[r], slot);
 
-llvm::Value* AST::Sub::codegen() {
+		CodeGen::Builder->CreateStore(CreateReduction(reductions[r].reduce_type, old, AST::GetCurrentInstructionByName(reductions[r].name)), slot);
+	}
 
-	llvm::Value* L = AST::GetOrCreateInstruction(target.get());
-	llvm::Value* R = AST::GetOrCreateInstruction(value.get());
+	CodeGen::Builder->CreateRetVoid();
 
-	std::string finalName = std::string("sub") + target->name;
+	CodeGen::SealAllBlocks();
+	CodeGen::FinishAliasScopes();
 
-	llvm::Value* result = CodeGen::Builder->CreateSub(L, R, finalName.c_str());
+	CodeGen::captures = captures.parent;
+	CodeGen::symbols = std::move(outer);
 
-	AST::AddInstruction(target.get(), result);
+	CodeGen::Builder->SetInsertPoint(outerBlock);
 
-	return result;
-}
+	// Back in the enclosing function: fill the context and run the loop.
+	unsigned ctxSize = captures.firstCapture + captures.order.size();
 
-llvm::Value* AST::And::codegen() {
+	llvm::AllocaInst* Ctx = CodeGen::CreateEntryAlloca(llvm::ArrayType::get(ptrTy, std::max(ctxSize, 1u)), "parfor.ctx");
 
-	llvm::Value* L = AST::GetOrCreateInstruction(target.get());
-	llvm::Value* R = AST::GetOrCreateInstruction(value.get());
+	std::vector<llvm::Value*> allPartials;
 
-	std::string finalName = std::string("and") + target->name;
+	for(size_t r = 0; r < reductions.size(); r++) {
 
-	llvm::Value* result = CodeGen::Builder->CreateAnd(L, R, finalName.c_str());
+		uint64_t partialsSize = MASCALRT_MAX_WORKERS * MASCALRT_SLOT_SIZE;
 
-	AST::AddInstruction(target.get(), result);
+		llvm::AllocaInst* partials = CodeGen::CreateEntryAlloca(llvm::ArrayType::get(CodeGen::Builder->getInt8Ty(), partialsSize), "parfor.partials");
+		partials->setAlignment(llvm::Align(MASCALRT_SLOT_SIZE));
 
-	return result;
-}
+		// Every slot starts as the identity of the reduction: zeros, or all ones for 'and'.
+		uint8_t identityByte = reductions[r].reduce_type == AST::ReduceType::ReduceAnd ? 0xFF : 0x00;
 
-llvm::Value* AST::Or::codegen() {
+		CodeGen::Builder->CreateMemSet(partials, CodeGen::Builder->getInt8(identityByte), partialsSize, llvm::Align(MASCALRT_SLOT_SIZE));
+		CodeGen::Builder->CreateStore(partials, CodeGen::Builder->CreateConstInBoundsGEP1_64(ptrTy, Ctx, r));
 
-	llvm::Value* L = AST::GetOrCreateInstruction(target.get());
-	llvm::Value* R = AST::GetOrCreateInstruction(value.get());
+		allPartials.push_back(partials);
+	}
 
-	std::string finalName = std::string("or") + target->name;
+	for(size_t k = 0; k < captures.order.size(); k++) {
 
-	llvm::Value* result = CodeGen::Builder->CreateOr(L, R, finalName.c_str());
+		llvm::Value* p = nullptr;
 
-	AST::AddInstruction(target.get(), result);
+		if(captures.order[k].first) {
+			p = captures.mems[captures.order[k].second]->origin;
+		}
+		else {
 
-	return result;
-}
+			LLVM_Com* lcom = captures.coms[captures.order[k].second];
 
-llvm::Value* AST::Xor::codegen() {
+			p = CodeGen::CreateEntryAlloca(lcom->ty, lcom->name);
 
-	llvm::Value* L = AST::GetOrCreateInstruction(target.get());
-	llvm::Value* R = AST::GetOrCreateInstruction(value.get());
+			CodeGen::Builder->CreateStore(CodeGen::ReadCom(lcom, CodeGen::Builder->GetInsertBlock()), p);
+		}
 
-	std::string finalName = std::string("xor") + target->name;
+		CodeGen::Builder->CreateStore(p, CodeGen::Builder->CreateConstInBoundsGEP1_64(ptrTy, Ctx, captures.firstCapture + k));
+	}
 
-	llvm::Value* result = CodeGen::Builder->CreateXor(L, R, finalName.c_str());
+	llvm::Value* Workers = CodeGen::Builder->CreateCall(CodeGen::GetParforRuntime(), { loCG, hiCG, F, Ctx }, "workers");
 
-	AST::AddInstruction(target.get(), result);
+	if(reductions.empty()) {
+		return nullptr;
+	}
 
-	return result;
-}
+	// Fold the slots of the workers that ran into the targets. There's always at least one.
+	llvm::Function* TheFunction = CodeGen::Builder->GetInsertBlock()->getParent();
 
-llvm::Value* AST::IntCast::codegen() {
+	llvm::BasicBlock* PreMerge = CodeGen::Builder->GetInsertBlock();
 
-	llvm::Value* targetC = AST::GetOrCreateInstruction(target.get());
-	llvm::Type* typeC = intType->codegen();
+	std::vector<llvm::Value*> startValues;
 
-	return CodeGen::Builder->CreateIntCast(targetC, typeC, true, target->name);
-}
+	for(auto const& r : reductions) {
+		startValues.push_back(AST::GetCurrentInstructionByName(r.name));
+	}
 
-llvm::Value* AST::ComStore::codegen() {
+	llvm::BasicBlock* MergeBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "parfor.merge", TheFunction);
+	llvm::BasicBlock* ContinueBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "continue");
 
-	llvm::Value* result = AST::GetOrCreateInstruction(value.get());
+	CodeGen::Builder->CreateBr(MergeBlock);
 
-	AST::AddInstruction(target.get(), result);
+	CodeGen::Builder->SetInsertPoint(MergeBlock);
 
-	return result;
-}
+	llvm::PHINode* K = CodeGen::Builder->CreatePHI(i64, 2, "worker");
+	K->addIncoming(CodeGen::Builder->getInt64(0), PreMerge);
 
-llvm::Value* AST::GetAllocaFromMem(AST::Expression* e) {
+	std::vector<llvm::PHINode*> accs;
 
-	return GetAllocaFromMemByName(e->name);
-}
+	for(size_t r = 0; r < reductions.size(); r++) {
+
+		accs.push_back(CodeGen::Builder->CreatePHI(reductionTypes[r], 2, "merged"));
+		accs.back()->addIncoming(startValues[r], PreMerge);
+	}
+
+	llvm::Value* mergeOffset = CodeGen::Builder->CreateMul(K, CodeGen::Builder->getInt64(MASCALRT_SLOT_SIZE));
+
+	std::vector<llvm::Value*> merged;
+
+	for(size_t r = 0; r < reductions.size(); r++) {
 
-llvm::Value* AST::GetAllocaFromMemByName(std::string name) {
+		llvm::Value* slot = CodeGen::Builder->CreateInBoundsGEP(CodeGen::Builder->getInt8Ty(), allPartials[r], mergeOffset);
+		llvm::Value* partial = CodeGen::Builder->CreateLoad(reductionTypes[r], slot);
 
-	if(CodeGen::all_mems.find(name) != CodeGen::all_mems.end()) {
-		return CodeGen::all_mems[name]->origin;
+		merged.push_back(CreateReduction(reductions[r].reduce_type, accs[r], partial));
+		accs[r]->addIncoming(merged.back(), MergeBlock);
 	}
 
-	return nullptr;
-}
+	llvm::Value* KNext = CodeGen::Builder->CreateAdd(K, CodeGen::Builder->getInt64(1), "worker.next", false, true);
+	K->addIncoming(KNext, MergeBlock);
 
-llvm::Value* AST::MemStore::codegen() {
+	CodeGen::Builder->CreateCondBr(CodeGen::Builder->CreateICmpSLT(KNext, Workers), MergeBlock, ContinueBlock);
+
+	CodeGen::SealBlock(MergeBlock);
 
-	llvm::Value* result = AST::GetOrCreateInstruction(value.get());
+	TheFunction->insert(TheFunction->end(), ContinueBlock);
+	CodeGen::Builder->SetInsertPoint(ContinueBlock);
 
-	llvm::Value* mem_alloca = AST::GetAllocaFromMem(target.get());
+	CodeGen::SealBlock(ContinueBlock);
 
-	if(mem_alloca == nullptr) {
-		std::cout << "Error: Mem Origin not found for 'memstore'.\n";
-		exit(1);
+	for(size_t r = 0; r < reductions.size(); r++) {
+		AST::AddInstructionToName(reductions[r].name, merged[r]);
 	}
 
-	return CodeGen::Builder->CreateStore(result, mem_alloca);
+	return nullptr;
 }
 
-llvm::Value* AST::LoadMem::codegen() {
+llvm::BasicBlock* GetAOTBasicBlock(std::string_view name) {
 
-	llvm::Value* mem_alloca = AST::GetAllocaFromMem(target.get());
+	for(auto i : CodeGen::pureBlocks) {
+		std::string bName = std::string(i->getName());
 
-	if(mem_alloca == nullptr) {
-		std::cout << "Error: Mem Origin not found for 'loadmem'.\n";
-		exit(1);
+		if(bName == name) {
+			return i;
+		}
 	}
 
-	return CodeGen::Builder->CreateLoad(CodeGen::all_mems[target->name]->ty, mem_alloca, target->name);
+	CompilationSession::Out() << "Error: Block '" << name << "' not found inside codegen.\n";
+	CompilationSession::Fail();
+	return nullptr;
 }
 
-llvm::Value* AST::Compare::codegen() {
+llvm::Value* AST::GEL::codegen() {
 
-	llvm::Value* L = AST::GetOrCreateInstruction(compareOne.get());
-	llvm::Value* R = AST::GetOrCreateInstruction(compareTwo.get());
+	llvm::Value* arrayCG = AST::GetOrCreateInstruction(array);
 
-	llvm::Value* comp = nullptr;
+	llvm::Value* itemCG = AST::GetOrCreateInstruction(item);
 
-	if(cmp_type == AST::CompareType::IsLessThan) { comp = CodeGen::Builder->CreateICmpUGT(R, L, "cmptmp"); }
-	if(cmp_type == AST::CompareType::IsMoreThan) { comp = CodeGen::Builder->CreateICmpUGT(L, R, "cmptmp"); }
-	if(cmp_type == AST::CompareType::IsEquals) { comp = CodeGen::Builder->CreateICmpEQ(L, R, "cmptmp"); }
-	if(cmp_type == AST::CompareType::IsNotEquals) { comp = CodeGen::Builder->CreateICmpNE(L, R, "cmptmp"); }
-	if(cmp_type == AST::CompareType::IsLessThanOrEquals) { comp = CodeGen::Builder->CreateICmpUGE(R, L, "cmptmp"); }
-	if(cmp_type == AST::CompareType::IsMoreThanOrEquals) { comp = CodeGen::Builder->CreateICmpUGE(L, R, "cmptmp"); }
+	llvm::Value* indexList[1] = { itemCG };
 
-	return comp;
-}
+	llvm::Type* tyCG = ty->codegen();
 
-bool AST::IsInitializer(AST::Expression* t) {
+	auto gel = CodeGen::Builder->CreateInBoundsGEP(tyCG, arrayCG, llvm::ArrayRef<llvm::Value*>(indexList, 1), "GEL");
 
-	return dynamic_cast<AST::Com*>(t) != nullptr || dynamic_cast<AST::Mem*>(t) != nullptr || dynamic_cast<AST::LoadMem*>(t) != nullptr;
+	return gel;
 }
 
-bool AST::IsAlgorithm(AST::Expression* t) {
+llvm::Value* AST::SEL::codegen() {
 
-	return dynamic_cast<AST::If*>(t) != nullptr || dynamic_cast<AST::While*>(t) != nullptr || dynamic_cast<AST::Block*>(t) != nullptr;
-}
+	llvm::Value* arrayCG = AST::GetOrCreateInstruction(array);
 
-llvm::Value* AST::GetOrigin(std::string name) {
+	llvm::Value* indexList[1] = {AST::GetOrCreateInstruction(item)};
 
-	if(CodeGen::all_coms.find(name) != CodeGen::all_coms.end()) {
-		return CodeGen::all_coms[name]->origin;
-	}
+	auto gel = CodeGen::Builder->CreateGEP(arrayCG->getType()->getArrayElementType(), arrayCG, llvm::ArrayRef<llvm::Value*>(indexList, 1), "SEL");
 
-	if(CodeGen::all_mems.find(name) != CodeGen::all_mems.end()) {
-		return CodeGen::all_mems[name]->origin;
-	}
+	CodeGen::AddScopedAccess(CodeGen::Builder->CreateStore(AST::GetOrCreateInstruction(result), gel), CodeGen::FindMem(array->name));
 
 	return nullptr;
 }
 
-llvm::Value* AST::GetCurrent(std::string name) {
+llvm::Value* AST::GEF::codegen() {
 
-	if(CodeGen::all_coms.find(name) != CodeGen::all_coms.end()) {
-		return CodeGen::all_coms[name]->current;
-	}
-
-	if(CodeGen::all_mems.find(name) != CodeGen::all_mems.end()) {
-		return CodeGen::all_mems[name]->current;
-	}
+	llvm::Value* baseCG = AST::GetOrCreateInstruction(base);
 
-	return nullptr;
-}
+	llvm::Value* fieldCG = CodeGen::Builder->getInt32(field);
 
-void CreatePHIs() {
+	std::string gefName = std::string(base->name) + "." + record->fieldNames[field];
 
-	UNORDERED_MAP_FOREACH(std::string, std::unique_ptr<LLVM_Com>, CodeGen::all_coms, it) {
+	// The field of every record is its own array: base.field[item].
+	if(dynamic_cast<AST::SoA*>(baseTy) != nullptr) {
 
-		if(!it->second->isOutOfScope) {
+		llvm::Value* indexList[3] = { CodeGen::Builder->getInt32(0), fieldCG, AST::GetOrCreateInstruction(item) };
 
-			llvm::PHINode* phi = CodeGen::Builder->CreatePHI(it->second->current->getType(), 2, "phi");
+		return CodeGen::Builder->CreateInBoundsGEP(baseTy->codegen(), baseCG, llvm::ArrayRef<llvm::Value*>(indexList, 3), gefName);
+	}
 
-			CodeGen::AddPHINodeToVec(it->first, phi);
-			it->second->current = phi;
+	llvm::Value* indexList[2] = { item != nullptr ? AST::GetOrCreateInstruction(item) : CodeGen::Builder->getInt32(0), fieldCG };
 
-			AST::SaveState(it->first, CodeGen::Builder->GetInsertBlock());
-		}
-	}
+	return CodeGen::Builder->CreateInBoundsGEP(record->codegen(), baseCG, llvm::ArrayRef<llvm::Value*>(indexList, 2), gefName);
 }
 
-llvm::Value* AST::While::codegen() {
+llvm::Value* AST::Splat::codegen() {
 
-	llvm::Value* conditionCodegen = AST::GetOrCreateInstruction(condition.get());
+	llvm::FixedVectorType* vecTy = dyn_cast<llvm::FixedVectorType>(ty->codegen());
 
-	llvm::Function *TheFunction = CodeGen::Builder->GetInsertBlock()->getParent();
+	llvm::Value* lane = CastToLane(AST::GetOrCreateInstruction(value), vecTy->getElementType());
 
-	llvm::BasicBlock* EntryBlock = CodeGen::Builder->GetInsertBlock();
+	return CodeGen::Builder->CreateVectorSplat(vecTy->getNumElements(), lane, "splat");
+}
 
-	AST::GlobalSaveState(EntryBlock);
+llvm::Value* AST::Extract::codegen() {
 
-	llvm::BasicBlock* LoopBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "while", TheFunction);
-	llvm::BasicBlock* ContinueBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "continue");
+	llvm::Value* vecCG = AST::GetOrCreateInstruction(vec);
 
-	for(auto const& i : loop_body) {
+	return CodeGen::Builder->CreateExtractElement(vecCG, AST::GetOrCreateInstruction(lane), "extract");
+}
 
-		if(i->target != nullptr) {
+llvm::Value* AST::Insert::codegen() {
 
-			if(dynamic_cast<AST::Variable*>(i->target.get()) != nullptr) {
+	llvm::Value* vecCG = AST::GetOrCreateInstruction(vec);
 
-				auto T = dynamic_cast<AST::Variable*>(i->target.get());
+	llvm::Value* valueCG = CastToLane(AST::GetOrCreateInstruction(value), vecCG->getType()->getScalarType());
 
-				for(auto const& inits : T->initializers) {
+	return CodeGen::Builder->CreateInsertElement(vecCG, valueCG, AST::GetOrCreateInstruction(lane), "insert");
+}
 
-					inits->codegen();
-					AST::SaveState(inits->name, EntryBlock);
-				}
+static llvm::Align VectorAlign(llvm::Type* laneTy, uint64_t align) {
 
-				i->target->areInitializersGenerated = true;
-			}
-		}
+	if(align == 0) {
+		return CodeGen::TheModule->getDataLayout().getABITypeAlign(laneTy);
 	}
 
-	CodeGen::Builder->CreateCondBr(conditionCodegen, LoopBlock, ContinueBlock);
+	return llvm::Align(align);
+}
 
-	CodeGen::Builder->SetInsertPoint(LoopBlock);
+llvm::Value* AST::VLoad::codegen() {
 
-	CreatePHIs();
+	llvm::Type* vecTy = ty->codegen();
+	llvm::Type* laneTy = vecTy->getScalarType();
 
-	for(auto const& i: loop_body) {
+	llvm::Value* arrayCG = AST::GetOrCreateInstruction(array);
 
-		if(AST::IsAlgorithm(i.get())) {
-			AST::GlobalSaveState(LoopBlock);
-		}
+	llvm::Value* indexList[1] = { AST::GetOrCreateInstruction(item) };
 
-		auto t = i->codegen();
-	}
+	llvm::Value* ptr = CodeGen::Builder->CreateInBoundsGEP(laneTy, arrayCG, llvm::ArrayRef<llvm::Value*>(indexList, 1), "VLOAD");
 
-	CodeGen::Builder->CreateCondBr(repeat_condition->codegen(), LoopBlock, ContinueBlock);
+	llvm::LoadInst* load = CodeGen::Builder->CreateAlignedLoad(vecTy, ptr, VectorAlign(laneTy, align), "vload");
 
-	CodeGen::EndScope(LoopBlock);
+	CodeGen::AddScopedAccess(load, CodeGen::FindMem(array->name));
 
-	auto currentBlock = CodeGen::Builder->GetInsertBlock();
+	return load;
+}
 
-	CodeGen::EndScope(currentBlock);
-	AST::GlobalSaveState(currentBlock);
+llvm::Value* AST::VStore::codegen() {
 
-	TheFunction->insert(TheFunction->end(), ContinueBlock);
-	CodeGen::Builder->SetInsertPoint(ContinueBlock);
+	llvm::Value* valueCG = AST::GetOrCreateInstruction(value);
 
-	CreatePHIs();
+	llvm::Type* laneTy = valueCG->getType()->getScalarType();
 
-	return nullptr;
-}
+	llvm::Value* arrayCG = AST::GetOrCreateInstruction(array);
 
-llvm::BasicBlock* GetAOTBasicBlock(std::string name) {
+	llvm::Value* indexList[1] = { AST::GetOrCreateInstruction(item) };
 
-	for(auto i : CodeGen::pureBlocks) {
-		std::string bName = std::string(i->getName());
+	llvm::Value* ptr = CodeGen::Builder->CreateInBoundsGEP(laneTy, arrayCG, llvm::ArrayRef<llvm::Value*>(indexList, 1), "VSTORE");
 
-		if(bName == name) {
-			return i;
-		}
-	}
+	CodeGen::AddScopedAccess(CodeGen::Builder->CreateAlignedStore(valueCG, ptr, VectorAlign(laneTy, align)), CodeGen::FindMem(array->name));
 
-	std::cout << "Error: Block '" << name << "' not found inside codegen.\n";
-	exit(1);
 	return nullptr;
 }
 
-llvm::Value* AST::GEL::codegen() {
+llvm::Value* AST::NTStore::codegen() {
 
-	llvm::Value* arrayCG = AST::GetOrCreateInstruction(array.get());
+	llvm::Value* valueCG = AST::GetOrCreateInstruction(value);
 
-	llvm::Value* itemCG = AST::GetOrCreateInstruction(item.get());
+	llvm::Type* laneTy = valueCG->getType()->getScalarType();
 
-	llvm::Value* indexList[1] = { itemCG };
+	llvm::Value* arrayCG = AST::GetOrCreateInstruction(array);
 
-	llvm::Type* tyCG = ty->codegen();
+	llvm::Value* indexList[1] = { AST::GetOrCreateInstruction(item) };
 
-	auto gel = CodeGen::Builder->CreateInBoundsGEP(tyCG, arrayCG, llvm::ArrayRef<llvm::Value*>(indexList, 1), "GEL");
+	llvm::Value* ptr = CodeGen::Builder->CreateInBoundsGEP(laneTy, arrayCG, llvm::ArrayRef<llvm::Value*>(indexList, 1), "NTSTORE");
 
-	return gel;
+	llvm::StoreInst* store = CodeGen::Builder->CreateAlignedStore(valueCG, ptr, VectorAlign(laneTy, align));
+
+	// Only used by the backend when the store is aligned to its own size.
+	llvm::Metadata* one = llvm::ConstantAsMetadata::get(CodeGen::Builder->getInt32(1));
+	store->setMetadata(llvm::LLVMContext::MD_nontemporal, llvm::MDNode::get(*CodeGen::TheContext, one));
+
+	CodeGen::AddScopedAccess(store, CodeGen::FindMem(array->name));
+
+	return nullptr;
 }
 
-llvm::Value* AST::SEL::codegen() {
+llvm::Value* AST::Prefetch::codegen() {
 
-	llvm::Value* arrayCG = AST::GetOrCreateInstruction(array.get());
+	llvm::Value* arrayCG = AST::GetOrCreateInstruction(array);
 
-	llvm::Value* indexList[1] = {AST::GetOrCreateInstruction(item.get())};
+	llvm::Value* indexList[1] = { AST::GetOrCreateInstruction(item) };
 
-	auto gel = CodeGen::Builder->CreateGEP(arrayCG->getType()->getArrayElementType(), arrayCG, llvm::ArrayRef<llvm::Value*>(indexList, 1), "SEL");
+	llvm::Value* ptr = CodeGen::Builder->CreateInBoundsGEP(ty->codegen(), arrayCG, llvm::ArrayRef<llvm::Value*>(indexList, 1), "PREFETCH");
 
-	CodeGen::Builder->CreateStore(AST::GetOrCreateInstruction(result.get()), gel);
+	// Read, high locality, data cache.
+	CodeGen::Builder->CreateIntrinsic(llvm::Intrinsic::prefetch, { ptr->getType() }, { ptr, CodeGen::Builder->getInt32(0), CodeGen::Builder->getInt32(3), CodeGen::Builder->getInt32(1) });
 
 	return nullptr;
 }
@@ -490,12 +1579,10 @@ llvm::Value* AST::Block::codegen() {
 
 	llvm::BasicBlock* EntryBlock = CodeGen::Builder->GetInsertBlock();
 
-	AST::GlobalSaveState(EntryBlock);
-
 	llvm::BasicBlock* TheBlock = GetAOTBasicBlock(name);
 	llvm::BasicBlock* ContinueBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "continue");
 
-	if(!isa<llvm::BranchInst>(EntryBlock->back())) {
+	if(EntryBlock->getTerminator() == nullptr) {
 		CodeGen::Builder->CreateBr(TheBlock);
 	}
 
@@ -504,42 +1591,50 @@ llvm::Value* AST::Block::codegen() {
 
 	CodeGen::pureBlocks.push_back(TheBlock);
 
-	CreatePHIs();
+	// Left unsealed: any 'goto' in the function can still jump here.
+
+	// Jumps to the block from its own body are the back edges of a loop.
+	llvm::SmallPtrSet<llvm::BasicBlock*, 4> forwardPreds(llvm::pred_begin(TheBlock), llvm::pred_end(TheBlock));
 
 	bool containsGotoOrReturn = false;
 
 	for(auto const& i: body) {
 
-		if(AST::IsAlgorithm(i.get())) {
-			AST::GlobalSaveState(TheBlock);
-		}
-
-		if(dynamic_cast<AST::Goto*>(i.get())) {
+		if(dynamic_cast<AST::Goto*>(i)) {
 			containsGotoOrReturn = true;
 		}
 
-		if(dynamic_cast<AST::LLReturn*>(i.get())) {
+		if(dynamic_cast<AST::LLReturn*>(i)) {
 			containsGotoOrReturn = true;
 		}
 
-		auto t = i->codegen();
+		i->codegen();
 	}
 
 	if(!containsGotoOrReturn) {
 		CodeGen::Builder->CreateBr(ContinueBlock);
 	}
 
+	if(llvm::MDNode* loopID = CreateLoopMetadata(attrs, false)) {
+
+		for(llvm::BasicBlock* pred : llvm::predecessors(TheBlock)) {
+
+			if(!forwardPreds.contains(pred)) {
+				pred->getTerminator()->setMetadata(llvm::LLVMContext::MD_loop, loopID);
+			}
+		}
+	}
+
 	CodeGen::EndScope(TheBlock);
 
 	auto currentBlock = CodeGen::Builder->GetInsertBlock();
 
 	CodeGen::EndScope(currentBlock);
-	AST::GlobalSaveState(currentBlock);
 
 	TheFunction->insert(TheFunction->end(), ContinueBlock);
 	CodeGen::Builder->SetInsertPoint(ContinueBlock);
 
-	CreatePHIs();
+	CodeGen::SealBlock(ContinueBlock);
 
 	return nullptr;
 }
@@ -548,119 +1643,80 @@ llvm::Value* AST::Goto::codegen() {
 	return CodeGen::Builder->CreateBr(GetAOTBasicBlock(name));
 }
 
-bool IsValueAlreadySet(std::vector<std::string>& strVec, std::string name) {
-
-	for(auto i : strVec) {
-		if(i == name) {
-			return true;
-		}
-	}
-
-	return false;
-}
-
 llvm::Value* AST::If::codegen() {
 
-	llvm::Value* conditionCodegen = AST::GetOrCreateInstruction(condition.get());
+	llvm::Value* conditionCodegen = AST::GetOrCreateInstruction(condition);
 
 	llvm::Function *TheFunction = CodeGen::Builder->GetInsertBlock()->getParent();
 
-	llvm::BasicBlock* EntryBlock = CodeGen::Builder->GetInsertBlock();
-
 	llvm::BasicBlock* IfBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "if", TheFunction);
 	llvm::BasicBlock* ElseBlock = nullptr;
 	llvm::BasicBlock* ContinueBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "continue");
 
+	// Same weights as '__builtin_expect'.
+	llvm::MDNode* weights = nullptr;
+
+	if(attrs.isLikely) { weights = llvm::MDBuilder(*CodeGen::TheContext).createBranchWeights(2000, 1); }
+	else if(attrs.isCold) { weights = llvm::MDBuilder(*CodeGen::TheContext).createBranchWeights(1, 2000); }
+
 	if(else_body.size() == 0) {
-		CodeGen::Builder->CreateCondBr(conditionCodegen, IfBlock, ContinueBlock);
+		CodeGen::Builder->CreateCondBr(conditionCodegen, IfBlock, ContinueBlock, weights);
 	}
 	else {
 		ElseBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "else");
-		CodeGen::Builder->CreateCondBr(conditionCodegen, IfBlock, ElseBlock);
+		CodeGen::Builder->CreateCondBr(conditionCodegen, IfBlock, ElseBlock, weights);
 	}
 
-	AST::GlobalSaveState(EntryBlock);
-
 	CodeGen::Builder->SetInsertPoint(IfBlock);
 
+	CodeGen::SealBlock(IfBlock);
+
 	bool IfContainsLLReturn = false;
 
 	for(auto const& i: if_body) {
-		IfContainsLLReturn = dynamic_cast<AST::LLReturn*>(i.get()) != nullptr;
+		IfContainsLLReturn = dynamic_cast<AST::LLReturn*>(i) != nullptr;
 	}
 
-	bool skipPHICreation = else_body.size() == 0 && IfContainsLLReturn;
 	bool containsGotoOrReturn = IfContainsLLReturn;
 
-	/*if(!skipPHICreation) { */CreatePHIs(); //}
-
-	llvm::BasicBlock* finalEntryBlock = nullptr;
-
-	if(parent_entry_block != nullptr) {
-		finalEntryBlock = parent_entry_block;
-	}
-	else {
-		finalEntryBlock = EntryBlock;
-	}
-
-	std::vector<std::string> valuesAlreadySet;
-
 	for(auto const& i: if_body) {
 
-		if(parent_entry_block != nullptr && !IsValueAlreadySet(valuesAlreadySet, i->name)) {
-			AST::SetExistingState(i->name, finalEntryBlock);
-			valuesAlreadySet.push_back(i->name);
-		}
-
 		i->codegen();
 
-		if(dynamic_cast<AST::Goto*>(i.get())) {
+		if(dynamic_cast<AST::Goto*>(i)) {
 			containsGotoOrReturn = true;
 		}
 	}
 
 	CodeGen::EndScope(IfBlock);
 
-	AST::GlobalSaveState(IfBlock);
-
 	if(!containsGotoOrReturn) {
 		CodeGen::Builder->CreateBr(ContinueBlock);
 	}
 
 	containsGotoOrReturn = false;
 
-	valuesAlreadySet.clear();
-
 	if(else_body.size() != 0) {
 
 		TheFunction->insert(TheFunction->end(), ElseBlock);
 		CodeGen::Builder->SetInsertPoint(ElseBlock);
 
-		CreatePHIs();
+		CodeGen::SealBlock(ElseBlock);
 
 		for(auto const& i: else_body) {
 
-			if(!IsValueAlreadySet(valuesAlreadySet, i->name)) {
-				AST::SetExistingState(i->name, finalEntryBlock);
-				valuesAlreadySet.push_back(i->name);
-			}
-
-			i->parent_entry_block = finalEntryBlock;
-
 			i->codegen();
 
-			if(dynamic_cast<AST::Goto*>(i.get())) {
+			if(dynamic_cast<AST::Goto*>(i)) {
 				containsGotoOrReturn = true;
 			}
 
-			if(dynamic_cast<AST::LLReturn*>(i.get())) {
+			if(dynamic_cast<AST::LLReturn*>(i)) {
 				containsGotoOrReturn = true;
 			}
 		}
 
 		CodeGen::EndScope(ElseBlock);
-
-		AST::GlobalSaveState(ElseBlock);
 	
 		if(!containsGotoOrReturn) {
 			CodeGen::Builder->CreateBr(ContinueBlock);
@@ -670,7 +1726,7 @@ llvm::Value* AST::If::codegen() {
 	TheFunction->insert(TheFunction->end(), ContinueBlock);
 	CodeGen::Builder->SetInsertPoint(ContinueBlock);
 
-	/*if(!skipPHICreation) { */CreatePHIs(); //}
+	CodeGen::SealBlock(ContinueBlock);
 
 	return nullptr;
 }
@@ -680,22 +1736,7 @@ llvm::Value* AST::GetCurrentInstruction(AST::Expression* e) {
 	return AST::GetCurrentInstructionByName(e->name);
 }
 
-bool AST::IsInstructionInsideOfBlock(llvm::BasicBlock* bb, llvm::Value* v) {
-
-	if(v == nullptr) {
-		return false;
-	}
-
-	for (llvm::BasicBlock::iterator I = bb->begin(), IE = bb->end(); I != IE; ++I) {
-		if(v->getName() == I->getName()) {
-			return true;
-		}
-	}
-
-	return false;
-}
-
-llvm::Value* AST::GetCurrentInstructionByName(std::string name) {
+llvm::Value* AST::GetCurrentInstructionByName(std::string_view name) {
 
 	llvm::Value* res = nullptr;
 
@@ -703,13 +1744,13 @@ llvm::Value* AST::GetCurrentInstructionByName(std::string name) {
 		return res;
 	}
 
-	if(CodeGen::all_coms.find(name) != CodeGen::all_coms.end()) {
-		res = CodeGen::all_coms[name]->current;
+	if(LLVM_Com* lcom = CodeGen::FindCom(name)) {
+		res = CodeGen::ReadCom(lcom, CodeGen::Builder->GetInsertBlock());
 	}
 
 	if(res == nullptr) {
-		if(CodeGen::all_mems.find(name) != CodeGen::all_mems.end()) {
-			res = CodeGen::all_mems[name]->current;
+		if(LLVM_Mem* lmem = CodeGen::FindMem(name)) {
+			res = lmem->current;
 		}
 	}
 
@@ -733,93 +1774,20 @@ void AST::AddInstruction(AST::Expression* e, llvm::Value* l) {
 	AST::AddInstructionToName(e->name, l);
 }
 
-void AST::AddInstructionToName(std::string name, llvm::Value* l) {
+void AST::AddInstructionToName(std::string_view name, llvm::Value* l) {
 
 	if(name != "") {
 
-		UNORDERED_MAP_FOREACH(std::string, std::unique_ptr<LLVM_Com>, CodeGen::all_coms, it) {
-
-			if(it->first == name) {
-				it->second->current = l;
+		if(LLVM_Com* lcom = CodeGen::FindCom(name)) {
 
-				bool blockParentFound = false;
-				auto currentBlock = CodeGen::Builder->GetInsertBlock();
-
-				for(auto i : it->second->blockParents) {
-
-					if(i == currentBlock) {
-						blockParentFound = true;
-						break;
-					}
-				}
-
-				if(blockParentFound) {
-					it->second->blockParents.push_back(currentBlock);
-				}
-
-				break;
-			}
+			CodeGen::WriteCom(lcom, CodeGen::Builder->GetInsertBlock(), l);
 		}
 	}
 }
 
 llvm::Value* AST::LLReturn::codegen() {
 
-	return CodeGen::Builder->CreateRet(AST::GetOrCreateInstruction(target.get()));
-}
-
-void AST::GlobalSaveState(llvm::BasicBlock* bb) {
-
-	std::string bbName = std::string(bb->getName());
-	UNORDERED_MAP_FOREACH(std::string, std::unique_ptr<LLVM_Com>, CodeGen::all_coms, it) {
-
-		AST::SaveState(it->first, bb);
-		
-	}
-}
-
-void AST::SaveState(std::string name, llvm::BasicBlock* bb) {
-	
-	if(name == "" || bb == nullptr) {
-		return;
-	}
-
-	std::string bbName = std::string(bb->getName());
-
-	if(CodeGen::all_coms.find(name) != CodeGen::all_coms.end()) {
-
-		//std::cout << "Saved '" << name << "' state in '" << bbName << "'.\n";
-
-		CodeGen::all_coms[name]->states[bbName] = CodeGen::all_coms[name]->current;
-	}
-}
-
-void AST::SetExistingState(std::string name, llvm::BasicBlock* bb) {
-
-	if(CodeGen::all_coms.find(name) != CodeGen::all_coms.end()) {
-	
-		std::string bbName = std::string(bb->getName());
-		if(CodeGen::all_coms[name]->states.find(bbName) != CodeGen::all_coms[name]->states.end()) {
-
-			CodeGen::all_coms[name]->current = CodeGen::all_coms[name]->states[bbName];
-		}
-	}
-}
-
-llvm::Value* AST::FindExistingState(std::string name, llvm::BasicBlock* bb) {
-
-	if(CodeGen::all_coms.find(name) != CodeGen::all_coms.end()) {
-	
-		std::string bbName = std::string(bb->getName());
-		if(CodeGen::all_coms[name]->states.find(bbName) != CodeGen::all_coms[name]->states.end()) {
-
-			return CodeGen::all_coms[name]->states[bbName];
-		}
-
-		return CodeGen::all_coms[name]->origin;
-	}
-
-	return nullptr;
+	return CodeGen::Builder->CreateRet(AST::GetOrCreateInstruction(target));
 }
 
 /*
@@ -2,14 +2,17 @@
 #define AST_HPP
 
 #include "CodeGen.hpp"
+#include "Arena.hpp"
+#include <map>
+#include <sstream>
 
-#define NEW_TYPE(x, y) struct x : public Type { llvm::Type* codegen() override; std::string ToLLMascal() override { y } std::unique_ptr<Type> Clone() override { return std::make_unique<x>(); } }
+#define NEW_TYPE(x, y) struct x : public Type { llvm::Type* codegen() override; std::string ToLLMascal() override { y } }
 
-#define EXPR_OBJ() std::unique_ptr<Expression>
-#define EXPR_OBJ_VECTOR() std::vector<std::unique_ptr<Expression>>
+#define EXPR_OBJ() Expression*
+#define EXPR_OBJ_VECTOR() std::vector<Expression*>
 
-#define TYPE_OBJ() std::unique_ptr<Type>
-#define TYPE_OBJ_VECTOR() std::vector<std::unique_ptr<Type>>
+#define TYPE_OBJ() Type*
+#define TYPE_OBJ_VECTOR() std::vector<Type*>
 
 #define MAP_FOREACH(x, y, z, w) for(std::map<x, y>::iterator w = z.begin(); w != z.end(); ++w)
 #define MAP_FOREACH_PAIR(x, y1, y2, z, w) for(std::map<x, std::pair<y1, y2>>::iterator w = z.begin(); w != z.end(); ++w)
@@ -17,18 +20,12 @@
 #define UNORDERED_MAP_FOREACH(x, y, z, w) for(std::unordered_map<x, y>::iterator w = z.begin(); w != z.end(); ++w)
 #define UNORDERED_MAP_FOREACH_PAIR(x, y1, y2, z, w) for(std::unordered_map<x, std::pair<y1, y2>>::iterator w = z.begin(); w != z.end(); ++w)
 
-#define CLONE_EXPR_VECTOR(x, y) std::vector<std::unique_ptr<AST::Expression>> y; for(auto const& i: x) { auto z = i->Clone(); y.push_back(std::move(z)); }
-#define CLONE_TYPE_VECTOR(x, y) std::vector<std::unique_ptr<AST::Type>> y; for(auto const& i: x) { auto z = i->Clone(); y.push_back(std::move(z)); }
-#define CLONE_AST_CUSTOM_VECTOR(z, x, y) std::vector<std::unique_ptr<z>> y; for(auto const& i: x) { auto z = i->Clone(); y.push_back(std::move(z)); }
+#define CLONE_EXPR_VECTOR(x, y) std::vector<AST::Expression*> y; for(auto const& i: x) { y.push_back(i->Clone()); }
 
 #define EMPTY_TOLLMASCAL() std::string ToLLMascal() override { return ""; }
 
 #define DEFAULT_TOLLMASCALBEFORE() std::string ToLLMascalBefore() override { return ""; }
 
-#define DEFAULT_REPLACE_TARGET_NAME_TO() void ReplaceTargetNameTo(std::string from, std::string to) override { return; }
-
-#define DEFAULT_CONTAINS_NAME() bool ContainsName(std::string str) override { return false; }
-
 struct AST {
 
 	struct Type {
@@ -39,9 +36,7 @@ struct AST {
 
 		virtual std::string ToLLMascal() = 0;
 
-		virtual std::unique_ptr<Type> Clone() = 0;
-
-		std::unique_ptr<AST::Type> childTy;
+		AST::Type* childTy = nullptr;
 	};
 
 	NEW_TYPE(Integer128, return "i128"; );
@@ -51,6 +46,9 @@ struct AST {
 	NEW_TYPE(Integer8, return "i8"; );
 	NEW_TYPE(Integer1, return "i1"; );
 
+	NEW_TYPE(Float64, return "f64"; );
+	NEW_TYPE(Float32, return "f32"; );
+
 	NEW_TYPE(Void, return "void"; );
 
 	struct Array : public Type { 
@@ -58,38 +56,148 @@ struct AST {
 		llvm::Type* codegen() override; 
 		uint64_t elements = 0;
 
-		Array(std::unique_ptr<AST::Type> t_in, uint64_t elements_in) {
-			childTy = std::move(t_in);
+		Array(AST::Type* t_in, uint64_t elements_in) {
+			childTy = t_in;
 			elements = elements_in;
 		}
 
 		std::string ToLLMascal() override { 
 			return std::string("Array<") + childTy->ToLLMascal() + std::string(", ") + std::to_string(elements) + std::string(">");
 		}
+	};
+
+	// Lane-wise arithmetic on it is lowered straight to LLVM vector IR.
+	struct Vector : public Type { 
+
+		llvm::Type* codegen() override; 
+		uint64_t elements = 0;
+
+		Vector(AST::Type* t_in, uint64_t elements_in) {
+			childTy = t_in;
+			elements = elements_in;
+		}
 
-		std::unique_ptr<Type> Clone() override { 
-			return std::make_unique<Array>(childTy->Clone(), elements); 
-		} 
+		std::string ToLLMascal() override { 
+			return std::string("Vector<") + childTy->ToLLMascal() + std::string(", ") + std::to_string(elements) + std::string(">");
+		}
 	};
 
 	struct Ref : public Type { 
 
 		llvm::Type* codegen() override; 
 
-		Ref(std::unique_ptr<AST::Type> t_in) {
-			childTy = std::move(t_in);
+		// 'restrict &T': nothing else reaches what it points to while it is used. Lowered
+		// to 'noalias' on arguments and alias scopes on the loads and stores through it.
+		bool isRestrict = false;
+
+		Ref(AST::Type* t_in, bool isRestrict_in) {
+			childTy = t_in;
+			isRestrict = isRestrict_in;
+		}
+
+		std::string ToLLMascal() override { 
+			return std::string(isRestrict ? "restrict " : "") + std::string("Ref<") + childTy->ToLLMascal() + std::string(">");
+		}
+	};
+
+	// Declared with 'record'. Lowered to a named LLVM struct, its fields are reached with 'GEF'.
+	struct Record : public Type { 
+
+		llvm::Type* codegen() override; 
+
+		std::string recordName;
+
+		std::vector<std::string> fieldNames;
+		std::vector<AST::Type*> fieldTypes;
+
+		// '[Packed]': no padding between fields, which are then only 1-byte aligned.
+		bool isPacked = false;
+
+		// '[Align(n)]': mems holding the record are n-aligned and its size is padded
+		// to a multiple of n, so every element of an array of them is n-aligned too.
+		uint64_t align = 0;
+
+		Record(std::string name_in, std::vector<std::string> fieldNames_in, std::vector<AST::Type*> fieldTypes_in, bool isPacked_in, uint64_t align_in) {
+
+			recordName = std::move(name_in);
+			fieldNames = std::move(fieldNames_in);
+			fieldTypes = std::move(fieldTypes_in);
+			isPacked = isPacked_in;
+			align = align_in;
+		}
+
+		// -1 when the record has no such field.
+		int FindField(std::string_view name) const {
+
+			for(size_t i = 0; i < fieldNames.size(); i++) {
+
+				if(fieldNames[i] == name) {
+					return i;
+				}
+			}
+
+			return -1;
 		}
 
 		std::string ToLLMascal() override { 
-			return std::string("Ref<") + childTy->ToLLMascal() + std::string(">");
+			return recordName;
+		}
+	};
+
+	// Array of records stored field by field (a struct of one array per field), made
+	// by '[SoA]' on an 'Array<Record, n>' mem. Elements are only reached with 'GEF'.
+	struct SoA : public Type { 
+
+		llvm::Type* codegen() override; 
+		uint64_t elements = 0;
+
+		SoA(AST::Type* t_in, uint64_t elements_in) {
+			childTy = t_in;
+			elements = elements_in;
 		}
 
-		std::unique_ptr<Type> Clone() override { 
-			return std::make_unique<Ref>(childTy->Clone()); 
-		} 
+		// Written like the array it replaces, the mem keeps the '[SoA]' attribute.
+		std::string ToLLMascal() override { 
+			return std::string("Array<") + childTy->ToLLMascal() + std::string(", ") + std::to_string(elements) + std::string(">");
+		}
 	};
 
-	static int slash_t_count;
+	// Types are immutable and uniqued, so every node shares them and they can be compared by pointer.
+	template<typename T>
+	static Type* GetType() {
+
+		static T ty;
+		return &ty;
+	}
+
+	static thread_local std::map<std::pair<Type*, uint64_t>, Type*> array_types;
+	static thread_local std::map<std::pair<Type*, uint64_t>, Type*> vector_types;
+	static thread_local std::map<std::pair<Type*, bool>, Type*> ref_types;
+	static thread_local std::map<std::pair<Type*, uint64_t>, Type*> soa_types;
+	static thread_local std::map<std::string, Type*, std::less<>> record_types;
+
+	static Type* GetArrayType(Type* childTy, uint64_t elements);
+	static Type* GetVectorType(Type* childTy, uint64_t elements);
+	static Type* GetRefType(Type* childTy, bool isRestrict = false);
+	static Type* GetSoAType(Type* recordTy, uint64_t elements);
+
+	// nullptr when no record has that name.
+	static Type* FindRecordType(std::string_view name);
+
+	// 'f32' / 'f64', or a vector of them.
+	static bool IsFloatType(Type* ty) {
+
+		if(dynamic_cast<Vector*>(ty) != nullptr) {
+			ty = ty->childTy;
+		}
+
+		return ty == GetType<Float32>() || ty == GetType<Float64>();
+	}
+
+	// Frees the whole AST. Nothing created by the parser can be used after this.
+	static void Reset();
+
+	static thread_local int slash_t_count;
 
 	static std::string GetSlashT() {
 
@@ -101,17 +209,93 @@ struct AST {
 		return res;
 	}
 
+	struct Attributes {
+
+		bool isStackProtected = false;
+		bool usesCStdLib = false;
+
+		// Procedures only. Forces LLVM to inline every call.
+		bool isInline = false;
+
+		// Mems only. Places the mem in a global (.bss/.data) instead of the stack.
+		// It is initialized once, like a C 'static', when its initializer is a constant.
+		bool isStatic = false;
+
+		// Procedures only. 'cold' / 'hot' / 'noinline' function attributes.
+		bool isHot = false;
+		bool isNoInline = false;
+
+		// Procedures: 'cold' function attribute. 'if': the 'then' side is unlikely.
+		bool isCold = false;
+
+		// 'if' only. The 'then' side is likely.
+		bool isLikely = false;
+
+		// Programs and procedures. Float math may be reassociated and
+		// assume no NaNs or infinities (LLVM 'fast' flags).
+		bool isFastMath = false;
+
+		// Records only. See 'AST::Record'.
+		bool isPacked = false;
+
+		// Records, mems and 'mem' arguments. In bytes. Mems are allocated with it,
+		// references (and arguments) are assumed to point to memory aligned to it.
+		unsigned align = 0;
+
+		// Mems of type 'Array<Record, n>' only. See 'AST::SoA'.
+		bool isSoA = false;
+
+		// Loops only ('while', 'for' and blocks that are jumped back to).
+		// Lowered to 'llvm.loop' metadata, 0 leaves the choice to LLVM.
+		unsigned unrollCount = 0;
+		unsigned vectorizeWidth = 0;
+
+		// "[A, B] " with every attribute that is set, or "" when none is.
+		std::string ToLLMascal() const {
+
+			std::vector<std::string> names;
+
+			if(isStackProtected) { names.push_back("StackProtected"); }
+			if(usesCStdLib) { names.push_back("CStdLib"); }
+			if(isInline) { names.push_back("Inline"); }
+			if(isStatic) { names.push_back("Static"); }
+			if(isHot) { names.push_back("Hot"); }
+			if(isNoInline) { names.push_back("NoInline"); }
+			if(isCold) { names.push_back("Cold"); }
+			if(isLikely) { names.push_back("Likely"); }
+			if(isFastMath) { names.push_back("FastMath"); }
+			if(isPacked) { names.push_back("Packed"); }
+			if(align > 0) { names.push_back("Align(" + std::to_string(align) + ")"); }
+			if(isSoA) { names.push_back("SoA"); }
+			if(unrollCount > 0) { names.push_back("Unroll(" + std::to_string(unrollCount) + ")"); }
+			if(vectorizeWidth > 0) { names.push_back("Vectorize(" + std::to_string(vectorizeWidth) + ")"); }
+
+			if(names.empty()) {
+				return "";
+			}
+
+			std::string res = "[";
+
+			for(size_t i = 0; i < names.size(); i++) {
+
+				if(i != 0) { res += ", "; }
+				res += names[i];
+			}
+
+			return res + "] ";
+		}
+	};
+
 	struct Expression {
 
 		virtual ~Expression() = default;
 
-		std::string name;
+		// Interned by 'Arena::Intern'.
+		std::string_view name;
 
-		std::unique_ptr<Type> ty;
+		Type* ty = nullptr;
 
-		std::unique_ptr<Expression> target;
-
-		llvm::BasicBlock* parent_entry_block = nullptr;
+		Expression* target = nullptr;
 
 		bool areInitializersGenerated = false;
 
@@ -121,28 +305,22 @@ struct AST {
 
 		virtual std::string ToLLMascalBefore() = 0;
 
-		virtual void ReplaceTargetNameTo(std::string from, std::string to) = 0;
-
-		virtual bool ContainsName(std::string s) = 0;
-
-		virtual std::unique_ptr<Expression> Clone() = 0;
+		virtual Expression* Clone() = 0;
 	};
 
 	struct IntNumber : public Expression {
 
 		int64_t num = 0;
 
-		IntNumber(int64_t num_in, std::unique_ptr<Type> ty_in) {
+		IntNumber(int64_t num_in, Type* ty_in) {
 
 			num = num_in;
-			ty = std::move(ty_in);
+			ty = ty_in;
 		}
 
 		llvm::Value* codegen() override;
 
 		DEFAULT_TOLLMASCALBEFORE()
-		DEFAULT_REPLACE_TARGET_NAME_TO()
-		DEFAULT_CONTAINS_NAME()
 
 		std::string ToLLMascal() override {
 			return std::to_string(num);
@@ -150,7 +328,35 @@ struct AST {
 
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<IntNumber>(num, ty->Clone());
+			return Arena::New<IntNumber>(num, ty);
+		}
+	};
+
+	struct FloatNumber : public Expression {
+
+		double num = 0;
+
+		FloatNumber(double num_in, Type* ty_in) {
+
+			num = num_in;
+			ty = ty_in;
+		}
+
+		llvm::Value* codegen() override;
+
+		DEFAULT_TOLLMASCALBEFORE()
+
+		std::string ToLLMascal() override {
+
+			std::ostringstream res;
+			res << std::showpoint << num;
+
+			return res.str();
+		}
+
+		EXPR_OBJ() Clone() override {
+
+			return Arena::New<FloatNumber>(num, ty);
 		}
 	};
 
@@ -158,16 +364,16 @@ struct AST {
 
 		EXPR_OBJ_VECTOR() initializers;
 
-		Variable(std::string name_in, EXPR_OBJ_VECTOR() initializers_in = {} ) {
+		Variable(std::string_view name_in, EXPR_OBJ_VECTOR() initializers_in = {} ) {
 
 			initializers = std::move(initializers_in);
-			name = name_in;
+			name = Arena::Intern(name_in);
 		}
 
 		llvm::Value* codegen() override;
 
 		std::string ToLLMascal() override {
-			return name;
+			return std::string(name);
 		}
 
 		std::string ToLLMascalBefore() override {
@@ -187,35 +393,19 @@ struct AST {
 			return res;
 		}
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-
-			for(auto const& i : initializers) {
-				i->ReplaceTargetNameTo(from, to);
-			}
-		}
-
-		bool ContainsName(std::string str) override {
-
-			return name == str;
-		}
-
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<Variable>(name);
+			return Arena::New<Variable>(name);
 		}
 	};
 
 	struct Com : public Expression {
 
-		Com(std::string name_in, std::unique_ptr<Type> ty_in, EXPR_OBJ() target_in) {
+		Com(std::string_view name_in, Type* ty_in, EXPR_OBJ() target_in) {
 
-			name = name_in;
-			ty = std::move(ty_in);
-			if(target_in != nullptr) { target = std::move(target_in); }
+			name = Arena::Intern(name_in);
+			ty = ty_in;
+			if(target_in != nullptr) { target = target_in; }
 		}
 
 		llvm::Value* codegen() override;
@@ -250,41 +440,27 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-
-			if(target != nullptr) { target->ReplaceTargetNameTo(from, to); }
-		}
-
-		bool ContainsName(std::string str) override {
-
-			if(target != nullptr) {
-				return name == str || target->ContainsName(str);
-			}
-
-			return name == str;
-		}
-
 		EXPR_OBJ() Clone() override {
 
 			if(target != nullptr) {
-				return std::make_unique<Com>(name, ty->Clone(), target->Clone());
+				return Arena::New<Com>(name, ty, target->Clone());
 			}
 
-			return std::make_unique<Com>(name, ty->Clone(), nullptr);
+			return Arena::New<Com>(name, ty, nullptr);
 		}
 	};
 
 	struct Mem : public Expression {
 
-		Mem(std::string name_in, std::unique_ptr<Type> ty_in, EXPR_OBJ() target_in) {
+		Attributes attrs;
+
+		Mem(std::string_view name_in, Type* ty_in, EXPR_OBJ() target_in, Attributes attrs_in) {
 
-			name = name_in;
-			ty = std::move(ty_in);
-			if(target_in != nullptr) { target = std::move(target_in); }
+			name = Arena::Intern(name_in);
+			ty = ty_in;
+			if(target_in != nullptr) { target = target_in; }
+
+			attrs = attrs_in;
 		}
 
 		llvm::Value* codegen() override;
@@ -303,6 +479,9 @@ struct AST {
 			}
 
 			res += "mem ";
+
+			res += attrs.ToLLMascal();
+
 			res += name;
 			res += ": ";
 			res += ty->ToLLMascal();
@@ -319,31 +498,13 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-
-			if(target != nullptr) { target->ReplaceTargetNameTo(from, to); }
-		}
-
-		bool ContainsName(std::string str) override {
-
-			if(target != nullptr) {
-				return name == str || target->ContainsName(str);
-			}
-
-			return name == str;
-		}
-
 		EXPR_OBJ() Clone() override {
 
 			if(target != nullptr) {
-				return std::make_unique<Mem>(name, ty->Clone(), target->Clone());
+				return Arena::New<Mem>(name, ty, target->Clone(), attrs);
 			}
 
-			return std::make_unique<Mem>(name, ty->Clone(), nullptr);
+			return Arena::New<Mem>(name, ty, nullptr, attrs);
 		}
 	};
 
@@ -355,12 +516,10 @@ struct AST {
 
 		EMPTY_TOLLMASCAL()
 		DEFAULT_TOLLMASCALBEFORE()
-		DEFAULT_REPLACE_TARGET_NAME_TO()
-		DEFAULT_CONTAINS_NAME()
 
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<RetVoid>();
+			return Arena::New<RetVoid>();
 		}
 	};
 
@@ -368,7 +527,7 @@ struct AST {
 
 		LLReturn(EXPR_OBJ() target_in) {
 
-			target = std::move(target_in);
+			target = target_in;
 		}
 
 		llvm::Value* codegen() override;
@@ -393,19 +552,9 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			target->ReplaceTargetNameTo(from, to);
-		}
-
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str);
-		}
-
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<LLReturn>(target->Clone());
+			return Arena::New<LLReturn>(target->Clone());
 		}
 	};
 
@@ -415,8 +564,8 @@ struct AST {
 
 		Add(EXPR_OBJ() target_in, EXPR_OBJ() value_in) {
 
-			target = std::move(target_in);
-			value = std::move(value_in);
+			target = target_in;
+			value = value_in;
 
 			name = target->name;
 		}
@@ -445,24 +594,9 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-
-			target->ReplaceTargetNameTo(from, to);
-			value->ReplaceTargetNameTo(from, to);
-		}
-
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str) || value->ContainsName(str);
-		}
-
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<Add>(target->Clone(), value->Clone());
+			return Arena::New<Add>(target->Clone(), value->Clone());
 		}
 	};
 
@@ -472,8 +606,8 @@ struct AST {
 
 		Sub(EXPR_OBJ() target_in, EXPR_OBJ() value_in) {
 
-			target = std::move(target_in);
-			value = std::move(value_in);
+			target = target_in;
+			value = value_in;
 
 			name = target->name;
 		}
@@ -502,24 +636,9 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str) || value->ContainsName(str);
-		}
-
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-
-			target->ReplaceTargetNameTo(from, to);
-			value->ReplaceTargetNameTo(from, to);
-		}
-
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<Sub>(target->Clone(), value->Clone());
+			return Arena::New<Sub>(target->Clone(), value->Clone());
 		}
 	};
 
@@ -529,8 +648,8 @@ struct AST {
 
 		And(EXPR_OBJ() target_in, EXPR_OBJ() value_in) {
 
-			target = std::move(target_in);
-			value = std::move(value_in);
+			target = target_in;
+			value = value_in;
 
 			name = target->name;
 		}
@@ -559,24 +678,9 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str) || value->ContainsName(str);
-		}
-
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-
-			target->ReplaceTargetNameTo(from, to);
-			value->ReplaceTargetNameTo(from, to);
-		}
-
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<And>(target->Clone(), value->Clone());
+			return Arena::New<And>(target->Clone(), value->Clone());
 		}
 	};
 
@@ -586,8 +690,8 @@ struct AST {
 
 		Or(EXPR_OBJ() target_in, EXPR_OBJ() value_in) {
 
-			target = std::move(target_in);
-			value = std::move(value_in);
+			target = target_in;
+			value = value_in;
 
 			name = target->name;
 		}
@@ -616,24 +720,9 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str) || value->ContainsName(str);
-		}
-
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-
-			target->ReplaceTargetNameTo(from, to);
-			value->ReplaceTargetNameTo(from, to);
-		}
-
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<Or>(target->Clone(), value->Clone());
+			return Arena::New<Or>(target->Clone(), value->Clone());
 		}
 	};
 
@@ -643,8 +732,8 @@ struct AST {
 
 		Xor(EXPR_OBJ() target_in, EXPR_OBJ() value_in) {
 
-			target = std::move(target_in);
-			value = std::move(value_in);
+			target = target_in;
+			value = value_in;
 
 			name = target->name;
 		}
@@ -673,35 +762,21 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str) || value->ContainsName(str);
-		}
-
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-
-			target->ReplaceTargetNameTo(from, to);
-			value->ReplaceTargetNameTo(from, to);
-		}
-
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<Xor>(target->Clone(), value->Clone());
+			return Arena::New<Xor>(target->Clone(), value->Clone());
 		}
 	};
 
+	// Converts between any two number types, floats included. Signed, like the rest of the language.
 	struct IntCast : public Expression {
 
 		TYPE_OBJ() intType;
 
 		IntCast(EXPR_OBJ() target_in, TYPE_OBJ() intType_in) {
 
-			target = std::move(target_in);
-			intType = std::move(intType_in);
+			target = target_in;
+			intType = intType_in;
 		}
 
 		llvm::Value* codegen() override;
@@ -732,19 +807,9 @@ struct AST {
 			return res;
 		}
 
-		bool ContainsName(std::string str) override {
-
-			return target->ContainsName(str);
-		}
-
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			target->ReplaceTargetNameTo(from, to);
-		}
-
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<IntCast>(target->Clone(), intType->Clone());
+			return Arena::New<IntCast>(target->Clone(), intType);
 		}
 	};
 
@@ -754,8 +819,8 @@ struct AST {
 
 		ComStore(EXPR_OBJ() target_in, EXPR_OBJ() value_in) {
 
-			target = std::move(target_in);
-			value = std::move(value_in);
+			target = target_in;
+			value = value_in;
 
 			name = target->name;
 		}
@@ -784,24 +849,9 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-
-			target->ReplaceTargetNameTo(from, to);
-			value->ReplaceTargetNameTo(from, to);
-		}
-
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str) || value->ContainsName(str);
-		}
-
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<ComStore>(target->Clone(), value->Clone());
+			return Arena::New<ComStore>(target->Clone(), value->Clone());
 		}
 	};
 
@@ -809,7 +859,7 @@ struct AST {
 
 		LoadMem(EXPR_OBJ() target_in) {
 
-			target = std::move(target_in);
+			target = target_in;
 		}
 
 		llvm::Value* codegen() override;
@@ -837,19 +887,9 @@ struct AST {
 			return res;
 		}
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			target->ReplaceTargetNameTo(from, to);
-		}
-
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str);
-		}
-
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<LoadMem>(target->Clone());
+			return Arena::New<LoadMem>(target->Clone());
 		}
 	};
 
@@ -859,8 +899,8 @@ struct AST {
 
 		MemStore(EXPR_OBJ() target_in, EXPR_OBJ() value_in) {
 
-			target = std::move(target_in);
-			value = std::move(value_in);
+			target = target_in;
+			value = value_in;
 
 			name = target->name;
 		}
@@ -889,34 +929,99 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
+		EXPR_OBJ() Clone() override {
 
-			if(name == from) {
-				name = to;
-			}
+			return Arena::New<MemStore>(target->Clone(), value->Clone());
+		}
+	};
+
+	// Operations without a signedness are signed, the 'U' forms are unsigned.
+	enum ArithmeticType {
+		Mul,
+		UMul,
+		Div,
+		UDiv,
+		Rem,
+		URem,
+		Shl,
+		Shr,
+		UShr
+	};
+
+	// 'mul', 'div', 'rem', 'shl', 'shr' and their unsigned forms. Stores the result in 'target'.
+	struct Arithmetic : public Expression {
+
+		EXPR_OBJ() value;
+
+		int arith_type;
+
+		Arithmetic(EXPR_OBJ() target_in, EXPR_OBJ() value_in, int arith_type_in) {
+
+			target = target_in;
+			value = value_in;
 
-			target->ReplaceTargetNameTo(from, to);
-			value->ReplaceTargetNameTo(from, to);
+			name = target->name;
+
+			arith_type = arith_type_in;
+		}
+
+		llvm::Value* codegen() override;
+
+		static std::string GetKeyword(int arith_type) {
+
+			if(arith_type == ArithmeticType::Mul) { return "mul"; }
+			else if(arith_type == ArithmeticType::UMul) { return "umul"; }
+			else if(arith_type == ArithmeticType::Div) { return "div"; }
+			else if(arith_type == ArithmeticType::UDiv) { return "udiv"; }
+			else if(arith_type == ArithmeticType::Rem) { return "rem"; }
+			else if(arith_type == ArithmeticType::URem) { return "urem"; }
+			else if(arith_type == ArithmeticType::Shl) { return "shl"; }
+			else if(arith_type == ArithmeticType::Shr) { return "shr"; }
+
+			return "ushr";
 		}
 
-		bool ContainsName(std::string str) override {
+		std::string ToLLMascal() override {
+
+			std::string res;
+
+			if(value->ToLLMascalBefore() != "") {
+
+				res += value->ToLLMascalBefore();
+				res += "\n";
+				res += GetSlashT();
+			}
+
+			res += GetKeyword(arith_type);
+			res += " ";
+			res += target->ToLLMascal();
+			res += ", ";
+			res += value->ToLLMascal();
+			res += ";";
 
-			return name == str || target->ContainsName(str) || value->ContainsName(str);
+			return res;
 		}
 
+		DEFAULT_TOLLMASCALBEFORE()
+
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<MemStore>(target->Clone(), value->Clone());
+			return Arena::New<Arithmetic>(target->Clone(), value->Clone(), arith_type);
 		}
 	};
 
+	// Orderings are signed, like 'intcast'. 'Below' / 'Above' are the unsigned ones.
 	enum CompareType {
 		IsLessThan,
 		IsMoreThan,
 		IsEquals,
 		IsNotEquals,
 		IsLessThanOrEquals,
-		IsMoreThanOrEquals
+		IsMoreThanOrEquals,
+		IsBelow,
+		IsAbove,
+		IsBelowOrEquals,
+		IsAboveOrEquals
 	};
 
 	struct Compare : public Expression {
@@ -928,8 +1033,8 @@ struct AST {
 
 		Compare(EXPR_OBJ() compareOne_in, EXPR_OBJ() compareTwo_in, int cmp_type_in) {
 
-			compareOne = std::move(compareOne_in);
-			compareTwo = std::move(compareTwo_in);
+			compareOne = compareOne_in;
+			compareTwo = compareTwo_in;
 
 			cmp_type = cmp_type_in;
 		}
@@ -962,6 +1067,10 @@ struct AST {
 			else if(cmp_type == CompareType::IsNotEquals) { res += "IsNotEquals"; }
 			else if(cmp_type == CompareType::IsLessThanOrEquals) { res += "IsLessThanOrEquals"; }
 			else if(cmp_type == CompareType::IsMoreThanOrEquals) { res += "IsMoreThanOrEquals"; }
+			else if(cmp_type == CompareType::IsBelow) { res += "IsBelow"; }
+			else if(cmp_type == CompareType::IsAbove) { res += "IsAbove"; }
+			else if(cmp_type == CompareType::IsBelowOrEquals) { res += "IsBelowOrEquals"; }
+			else if(cmp_type == CompareType::IsAboveOrEquals) { res += "IsAboveOrEquals"; }
 
 			res += "(";
 			res += compareOne->ToLLMascal();
@@ -974,38 +1083,27 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		bool ContainsName(std::string str) override {
+		EXPR_OBJ() Clone() override {
 
-			return name == str || compareOne->ContainsName(str) || compareTwo->ContainsName(str);
+			return Arena::New<Compare>(compareOne->Clone(), compareTwo->Clone(), cmp_type);
 		}
+	};
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-
-			compareOne->ReplaceTargetNameTo(from, to);
-			compareTwo->ReplaceTargetNameTo(from, to);
-		}
-
-		EXPR_OBJ() Clone() override {
-
-			return std::make_unique<Compare>(compareOne->Clone(), compareTwo->Clone(), cmp_type);
-		}
-	};
-
-	struct While : public Expression {
+	struct While : public Expression {
 
 		EXPR_OBJ() condition;
 		EXPR_OBJ() repeat_condition;
 		EXPR_OBJ_VECTOR() loop_body;
 
-		While(EXPR_OBJ() condition_in, EXPR_OBJ() repeat_condition_in, EXPR_OBJ_VECTOR() loop_body_in) {
+		Attributes attrs;
+
+		While(EXPR_OBJ() condition_in, EXPR_OBJ() repeat_condition_in, EXPR_OBJ_VECTOR() loop_body_in, Attributes attrs_in) {
 
-			condition = std::move(condition_in);
-			repeat_condition = std::move(repeat_condition_in);
+			condition = condition_in;
+			repeat_condition = repeat_condition_in;
 			loop_body = std::move(loop_body_in);
+
+			attrs = attrs_in;
 		}
 
 		llvm::Value* codegen() override;
@@ -1022,7 +1120,8 @@ struct AST {
 			}
 
 			res += "while ";
-			
+
+			res += attrs.ToLLMascal();
 			res += condition->ToLLMascal();
 			res += " do\n";
 
@@ -1047,41 +1146,179 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
+		EXPR_OBJ() Clone() override {
 
-			condition->ReplaceTargetNameTo(from, to);
-			repeat_condition->ReplaceTargetNameTo(from, to);
+			CLONE_EXPR_VECTOR(loop_body, clone_loop_body);
 
-			for(auto const& i : loop_body) {
+			return Arena::New<While>(condition->Clone(), repeat_condition->Clone(), std::move(clone_loop_body), attrs);
+		}
+	};
 
-				i->ReplaceTargetNameTo(from, to);
-			}
+	// Counted loop. 'start', 'end' and 'step' are evaluated once, 'end' is inclusive.
+	struct For : public Expression {
+
+		EXPR_OBJ() start;
+		EXPR_OBJ() end;
+		EXPR_OBJ() step;
+		EXPR_OBJ_VECTOR() loop_body;
+
+		Attributes attrs;
+
+		For(std::string_view name_in, Type* ty_in, EXPR_OBJ() start_in, EXPR_OBJ() end_in, EXPR_OBJ() step_in, EXPR_OBJ_VECTOR() loop_body_in, Attributes attrs_in) {
+
+			name = Arena::Intern(name_in);
+			ty = ty_in;
+
+			start = start_in;
+			end = end_in;
+			step = step_in;
+			loop_body = std::move(loop_body_in);
+
+			attrs = attrs_in;
 		}
 
-		bool ContainsName(std::string str) override {
+		llvm::Value* codegen() override;
 
-			if(condition->ContainsName(str)) {
-				return true;
+		std::string ToLLMascal() override {
+
+			std::string res;
+
+			res += "for ";
+			res += attrs.ToLLMascal();
+			res += name;
+			res += ": ";
+			res += ty->ToLLMascal();
+			res += " = ";
+			res += start->ToLLMascal();
+			res += " to ";
+			res += end->ToLLMascal();
+
+			if(step != nullptr) {
+				res += " step ";
+				res += step->ToLLMascal();
 			}
 
-			if(repeat_condition->ContainsName(str)) {
-				return true;
+			res += " do\n";
+
+			slash_t_count += 1;
+
+			for(auto const& i: loop_body) {
+				res += GetSlashT();
+				res += i->ToLLMascalBefore();
+				res += "\n";
+
+				res += GetSlashT();
+				res += i->ToLLMascal();
+				res += "\n";
 			}
 
-			for(auto const& i : loop_body) {
-				if(i->ContainsName(str)) {
-					return true;
-				}
+			slash_t_count -= 1;
+
+			res += GetSlashT() + "end;\n";
+
+			return res;
+		}
+
+		DEFAULT_TOLLMASCALBEFORE()
+
+		EXPR_OBJ() Clone() override {
+
+			CLONE_EXPR_VECTOR(loop_body, clone_loop_body);
+
+			return Arena::New<For>(name, ty, start->Clone(), end->Clone(), step != nullptr ? step->Clone() : nullptr, std::move(clone_loop_body), attrs);
+		}
+	};
+
+	enum ReduceType {
+		ReduceAdd,
+		ReduceAnd,
+		ReduceOr,
+		ReduceXor
+	};
+
+	struct Reduction {
+
+		int reduce_type;
+
+		// Com of the enclosing function the partials are merged into.
+		std::string_view name;
+	};
+
+	// 'parfor i in lo..hi do ... end'. The body is outlined into its own function and
+	// its iterations run on the libmascalrt thread pool, in no particular order.
+	struct Parfor : public Expression {
+
+		EXPR_OBJ() lo;
+		EXPR_OBJ() hi;
+		EXPR_OBJ_VECTOR() loop_body;
+
+		std::vector<Reduction> reductions;
+
+		Parfor(std::string_view name_in, EXPR_OBJ() lo_in, EXPR_OBJ() hi_in, EXPR_OBJ_VECTOR() loop_body_in, std::vector<Reduction> reductions_in) {
+
+			name = Arena::Intern(name_in);
+
+			lo = lo_in;
+			hi = hi_in;
+			loop_body = std::move(loop_body_in);
+
+			reductions = std::move(reductions_in);
+		}
+
+		llvm::Value* codegen() override;
+
+		std::string ToLLMascal() override {
+
+			std::string res;
+
+			res += "parfor ";
+			res += name;
+			res += " in ";
+			res += lo->ToLLMascal();
+			res += "..";
+			res += hi->ToLLMascal();
+
+			for(auto const& r : reductions) {
+
+				res += " reduce ";
+
+				if(r.reduce_type == ReduceType::ReduceAdd) { res += "add"; }
+				else if(r.reduce_type == ReduceType::ReduceAnd) { res += "and"; }
+				else if(r.reduce_type == ReduceType::ReduceOr) { res += "or"; }
+				else if(r.reduce_type == ReduceType::ReduceXor) { res += "xor"; }
+
+				res += " into ";
+				res += r.name;
+			}
+
+			res += " do\n";
+
+			slash_t_count += 1;
+
+			for(auto const& i: loop_body) {
+				res += GetSlashT();
+				res += i->ToLLMascalBefore();
+				res += "\n";
+
+				res += GetSlashT();
+				res += i->ToLLMascal();
+				res += "\n";
 			}
 
-			return false;
+			slash_t_count -= 1;
+
+			res += GetSlashT() + "end;\n";
+
+			return res;
 		}
 
+		DEFAULT_TOLLMASCALBEFORE()
+
 		EXPR_OBJ() Clone() override {
 
 			CLONE_EXPR_VECTOR(loop_body, clone_loop_body);
 
-			return std::make_unique<While>(condition->Clone(), repeat_condition->Clone(), std::move(clone_loop_body));
+			return Arena::New<Parfor>(name, lo->Clone(), hi->Clone(), std::move(clone_loop_body), reductions);
 		}
 	};
 
@@ -1091,11 +1328,11 @@ struct AST {
 		EXPR_OBJ() array;
 		EXPR_OBJ() item;
 
-		GEL(EXPR_OBJ() array_in, EXPR_OBJ() item_in, std::unique_ptr<AST::Type> ty_in) {
+		GEL(EXPR_OBJ() array_in, EXPR_OBJ() item_in, AST::Type* ty_in) {
 
-			array = std::move(array_in);
-			item = std::move(item_in);
-			ty = std::move(ty_in);
+			array = array_in;
+			item = item_in;
+			ty = ty_in;
 		}
 
 		llvm::Value* codegen() override;
@@ -1116,43 +1353,225 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
+		EXPR_OBJ() Clone() override {
 
-			array->ReplaceTargetNameTo(from, to);
-			item->ReplaceTargetNameTo(from, to);
+			return Arena::New<GEL>(array->Clone(), item->Clone(), ty);
 		}
+	};
 
-		bool ContainsName(std::string str) override {
+	struct SEL : public Expression {
 
-			if(array->ContainsName(str)) {
-				return true;
-			}
 
-			if(item->ContainsName(str)) {
-				return true;
+		EXPR_OBJ() array;
+		EXPR_OBJ() item;
+		EXPR_OBJ() result;
+
+		SEL(EXPR_OBJ() array_in, EXPR_OBJ() item_in, EXPR_OBJ() result_in) {
+
+			array = array_in;
+			item = item_in;
+			result = result_in;
+		}
+
+		llvm::Value* codegen() override;
+
+		std::string ToLLMascal() override {
+
+			std::string res;
+
+			res += "SEL(";
+			res += array->ToLLMascal();
+			res += ", ";
+			res += item->ToLLMascal();
+			res += ", ";
+			res += result->ToLLMascal();
+			res += ")";
+			
+			return res;
+		}
+
+		DEFAULT_TOLLMASCALBEFORE()
+
+		EXPR_OBJ() Clone() override {
+
+			return Arena::New<SEL>(array->Clone(), item->Clone(), result->Clone());
+		}
+	};
+
+	// Pointer to a field of a record. 'GEF(p, field)' takes the record 'p' points to,
+	// 'GEF(a, i, field)' the 'i'th record of 'a' (which can be a '[SoA]' mem).
+	struct GEF : public Expression {
+
+		EXPR_OBJ() base;
+		EXPR_OBJ() item = nullptr;
+
+		// 'Record', or 'SoA' when 'base' is stored field by field.
+		AST::Type* baseTy = nullptr;
+		AST::Record* record = nullptr;
+
+		int field = 0;
+
+		GEF(EXPR_OBJ() base_in, EXPR_OBJ() item_in, AST::Type* baseTy_in, int field_in) {
+
+			base = base_in;
+			item = item_in;
+			baseTy = baseTy_in;
+			field = field_in;
+
+			record = dynamic_cast<AST::Record*>(dynamic_cast<AST::SoA*>(baseTy) != nullptr ? baseTy->childTy : baseTy);
+
+			ty = record->fieldTypes[field];
+		}
+
+		llvm::Value* codegen() override;
+
+		std::string ToLLMascal() override {
+
+			std::string res;
+
+			res += "GEF(";
+			res += base->ToLLMascal();
+
+			if(item != nullptr) {
+				res += ", ";
+				res += item->ToLLMascal();
 			}
 
-			return false;
+			res += ", ";
+			res += record->fieldNames[field];
+			res += ")";
+
+			return res;
+		}
+
+		DEFAULT_TOLLMASCALBEFORE()
+
+		EXPR_OBJ() Clone() override {
+
+			return Arena::New<GEF>(base->Clone(), item != nullptr ? item->Clone() : nullptr, baseTy, field);
 		}
+	};
+
+	struct Splat : public Expression {
+
+		EXPR_OBJ() value;
+
+		Splat(EXPR_OBJ() value_in, AST::Type* ty_in) {
+
+			value = value_in;
+			ty = ty_in;
+		}
+
+		llvm::Value* codegen() override;
+
+		std::string ToLLMascal() override {
+
+			std::string res;
+
+			res += "SPLAT(";
+			res += value->ToLLMascal();
+			res += ") as ";
+			res += ty->ToLLMascal();
+
+			return res;
+		}
+
+		DEFAULT_TOLLMASCALBEFORE()
 
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<GEL>(array->Clone(), item->Clone(), ty->Clone());
+			return Arena::New<Splat>(value->Clone(), ty);
 		}
 	};
 
-	struct SEL : public Expression {
+	struct Extract : public Expression {
+
+		EXPR_OBJ() vec;
+		EXPR_OBJ() lane;
 
+		Extract(EXPR_OBJ() vec_in, EXPR_OBJ() lane_in) {
+
+			vec = vec_in;
+			lane = lane_in;
+		}
+
+		llvm::Value* codegen() override;
+
+		std::string ToLLMascal() override {
+
+			std::string res;
+
+			res += "EXTRACT(";
+			res += vec->ToLLMascal();
+			res += ", ";
+			res += lane->ToLLMascal();
+			res += ")";
+
+			return res;
+		}
+
+		DEFAULT_TOLLMASCALBEFORE()
+
+		EXPR_OBJ() Clone() override {
+
+			return Arena::New<Extract>(vec->Clone(), lane->Clone());
+		}
+	};
+
+	// Returns the vector with one lane replaced, the original one is left untouched.
+	struct Insert : public Expression {
+
+		EXPR_OBJ() vec;
+		EXPR_OBJ() lane;
+		EXPR_OBJ() value;
+
+		Insert(EXPR_OBJ() vec_in, EXPR_OBJ() lane_in, EXPR_OBJ() value_in) {
+
+			vec = vec_in;
+			lane = lane_in;
+			value = value_in;
+		}
+
+		llvm::Value* codegen() override;
+
+		std::string ToLLMascal() override {
+
+			std::string res;
+
+			res += "INSERT(";
+			res += vec->ToLLMascal();
+			res += ", ";
+			res += lane->ToLLMascal();
+			res += ", ";
+			res += value->ToLLMascal();
+			res += ")";
+
+			return res;
+		}
+
+		DEFAULT_TOLLMASCALBEFORE()
+
+		EXPR_OBJ() Clone() override {
+
+			return Arena::New<Insert>(vec->Clone(), lane->Clone(), value->Clone());
+		}
+	};
+
+	// Loads 'ty' (a vector) from 'array', starting at element 'item'.
+	// 'align' is in bytes, 0 means the alignment of a single element.
+	struct VLoad : public Expression {
 
 		EXPR_OBJ() array;
 		EXPR_OBJ() item;
-		EXPR_OBJ() result;
 
-		SEL(EXPR_OBJ() array_in, EXPR_OBJ() item_in, EXPR_OBJ() result_in) {
+		uint64_t align = 0;
+
+		VLoad(EXPR_OBJ() array_in, EXPR_OBJ() item_in, uint64_t align_in, AST::Type* ty_in) {
 
-			array = std::move(array_in);
-			item = std::move(item_in);
-			result = std::move(result_in);
+			array = array_in;
+			item = item_in;
+			align = align_in;
+			ty = ty_in;
 		}
 
 		llvm::Value* codegen() override;
@@ -1161,46 +1580,160 @@ struct AST {
 
 			std::string res;
 
-			res += "SEL(";
+			res += "VLOAD(";
+			res += array->ToLLMascal();
+			res += ", ";
+			res += item->ToLLMascal();
+
+			if(align != 0) {
+				res += ", ";
+				res += std::to_string(align);
+			}
+
+			res += ") as ";
+			res += ty->ToLLMascal();
+
+			return res;
+		}
+
+		DEFAULT_TOLLMASCALBEFORE()
+
+		EXPR_OBJ() Clone() override {
+
+			return Arena::New<VLoad>(array->Clone(), item->Clone(), align, ty);
+		}
+	};
+
+	struct VStore : public Expression {
+
+		EXPR_OBJ() array;
+		EXPR_OBJ() item;
+		EXPR_OBJ() value;
+
+		uint64_t align = 0;
+
+		VStore(EXPR_OBJ() array_in, EXPR_OBJ() item_in, EXPR_OBJ() value_in, uint64_t align_in) {
+
+			array = array_in;
+			item = item_in;
+			value = value_in;
+			align = align_in;
+		}
+
+		llvm::Value* codegen() override;
+
+		std::string ToLLMascal() override {
+
+			std::string res;
+
+			res += "VSTORE(";
 			res += array->ToLLMascal();
 			res += ", ";
 			res += item->ToLLMascal();
 			res += ", ";
-			res += result->ToLLMascal();
+			res += value->ToLLMascal();
+
+			if(align != 0) {
+				res += ", ";
+				res += std::to_string(align);
+			}
+
 			res += ")";
-			
+
 			return res;
 		}
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
+		EXPR_OBJ() Clone() override {
 
-			array->ReplaceTargetNameTo(from, to);
-			item->ReplaceTargetNameTo(from, to);
-			result->ReplaceTargetNameTo(from, to);
+			return Arena::New<VStore>(array->Clone(), item->Clone(), value->Clone(), align);
 		}
+	};
 
-		bool ContainsName(std::string str) override {
+	// Store that bypasses the caches ('!nontemporal'), for data that won't be read
+	// again soon. The value can be a number or a vector, indexed by lane like 'VSTORE'.
+	struct NTStore : public Expression {
 
-			if(array->ContainsName(str)) {
-				return true;
-			}
+		EXPR_OBJ() array;
+		EXPR_OBJ() item;
+		EXPR_OBJ() value;
 
-			if(item->ContainsName(str)) {
-				return true;
-			}
+		uint64_t align = 0;
+
+		NTStore(EXPR_OBJ() array_in, EXPR_OBJ() item_in, EXPR_OBJ() value_in, uint64_t align_in) {
+
+			array = array_in;
+			item = item_in;
+			value = value_in;
+			align = align_in;
+		}
+
+		llvm::Value* codegen() override;
+
+		std::string ToLLMascal() override {
+
+			std::string res;
 
-			if(result->ContainsName(str)) {
-				return true;
+			res += "NTSTORE(";
+			res += array->ToLLMascal();
+			res += ", ";
+			res += item->ToLLMascal();
+			res += ", ";
+			res += value->ToLLMascal();
+
+			if(align != 0) {
+				res += ", ";
+				res += std::to_string(align);
 			}
 
-			return false;
+			res += ")";
+
+			return res;
 		}
 
+		DEFAULT_TOLLMASCALBEFORE()
+
 		EXPR_OBJ() Clone() override {
 
-			return std::make_unique<SEL>(array->Clone(), item->Clone(), result->Clone());
+			return Arena::New<NTStore>(array->Clone(), item->Clone(), value->Clone(), align);
+		}
+	};
+
+	// 'llvm.prefetch' (read, keep in all cache levels) of the 'item'th element of 'array'.
+	// 'ty' is the element type.
+	struct Prefetch : public Expression {
+
+		EXPR_OBJ() array;
+		EXPR_OBJ() item;
+
+		Prefetch(EXPR_OBJ() array_in, EXPR_OBJ() item_in, AST::Type* ty_in) {
+
+			array = array_in;
+			item = item_in;
+			ty = ty_in;
+		}
+
+		llvm::Value* codegen() override;
+
+		std::string ToLLMascal() override {
+
+			std::string res;
+
+			res += "PREFETCH(";
+			res += array->ToLLMascal();
+			res += ", ";
+			res += item->ToLLMascal();
+			res += ")";
+
+			return res;
+		}
+
+		DEFAULT_TOLLMASCALBEFORE()
+
+		EXPR_OBJ() Clone() override {
+
+			return Arena::New<Prefetch>(array->Clone(), item->Clone(), ty);
 		}
 	};
 
@@ -1208,11 +1741,16 @@ struct AST {
 
 		EXPR_OBJ_VECTOR() body;
 
-		Block(std::string name_in, EXPR_OBJ_VECTOR() body_in) {
+		// Loop attributes apply to the 'goto's that jump back to the block.
+		Attributes attrs;
 
-			name = name_in;
+		Block(std::string_view name_in, EXPR_OBJ_VECTOR() body_in, Attributes attrs_in) {
+
+			name = Arena::Intern(name_in);
 			body = std::move(body_in);
 
+			attrs = attrs_in;
+
 			CodeGen::pureBlocks.push_back(llvm::BasicBlock::Create(*CodeGen::TheContext, name));
 		}
 
@@ -1223,7 +1761,8 @@ struct AST {
 			std::string res;
 
 			res += "block ";
-			
+
+			res += attrs.ToLLMascal();
 			res += name;
 			res += " begin\n";
 
@@ -1248,45 +1787,18 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-
-			for(auto const& i : body) {
-
-				i->ReplaceTargetNameTo(from, to);
-			}
-		}
-
-		bool ContainsName(std::string str) override {
-
-			if(name == str) {
-				return true;
-			}
-
-			for(auto const& i : body) {
-				if(i->ContainsName(str)) {
-					return true;
-				}
-			}
-
-			return false;
-		}
-
 		EXPR_OBJ() Clone() override {
 
 			CLONE_EXPR_VECTOR(body, clone_body);
 
-			return std::make_unique<Block>(name, std::move(clone_body));
+			return Arena::New<Block>(name, std::move(clone_body), attrs);
 		}
 	};
 
 	struct Goto : public Expression {
 
-		Goto(std::string name_in) {
-			name = name_in;
+		Goto(std::string_view name_in) {
+			name = Arena::Intern(name_in);
 		}
 
 		llvm::Value* codegen() override;
@@ -1305,24 +1817,8 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-		}
-
-		bool ContainsName(std::string str) override {
-
-			if(name == str) {
-				return true;
-			}
-
-			return false;
-		}
-
 		EXPR_OBJ() Clone() override {
-			return std::make_unique<Goto>(name);
+			return Arena::New<Goto>(name);
 		}
 	};
 
@@ -1332,11 +1828,15 @@ struct AST {
 		EXPR_OBJ_VECTOR() if_body;
 		EXPR_OBJ_VECTOR() else_body;
 
-		If(EXPR_OBJ() condition_in, EXPR_OBJ_VECTOR() if_body_in, EXPR_OBJ_VECTOR() else_body_in) {
+		Attributes attrs;
+
+		If(EXPR_OBJ() condition_in, EXPR_OBJ_VECTOR() if_body_in, EXPR_OBJ_VECTOR() else_body_in, Attributes attrs_in) {
 
-			condition = std::move(condition_in);
+			condition = condition_in;
 			if_body = std::move(if_body_in);
 			else_body = std::move(else_body_in);
+
+			attrs = attrs_in;
 		}
 
 		llvm::Value* codegen() override;
@@ -1353,7 +1853,8 @@ struct AST {
 			}
 
 			res += "if ";
-			
+
+			res += attrs.ToLLMascal();
 			res += condition->ToLLMascal();
 			res += " then\n";
 
@@ -1397,73 +1898,59 @@ struct AST {
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			condition->ReplaceTargetNameTo(from, to);
-
-			for(auto const& i : if_body) {
-
-				i->ReplaceTargetNameTo(from, to);
-			}
+		EXPR_OBJ() Clone() override {
 
-			for(auto const& i : else_body) {
+			CLONE_EXPR_VECTOR(if_body, clone_if_body);
+			CLONE_EXPR_VECTOR(else_body, clone_else_body);
 
-				i->ReplaceTargetNameTo(from, to);
-			}
+			return Arena::New<If>(condition->Clone(), std::move(clone_if_body), std::move(clone_else_body), attrs);
 		}
+	};
 
-		bool ContainsName(std::string str) override {
+	struct ProcedureCall : public Expression {
 
-			if(condition->ContainsName(str)) {
-				return true;
-			}
+		std::string_view procName;
 
-			for(auto const& i : if_body) {
-				if(i->ContainsName(str)) {
-					return true;
-				}
-			}
+		// Arguments passed to 'mem' parameters are passed by reference.
+		std::vector<bool> isMemArgument;
 
-			for(auto const& i : else_body) {
-				if(i->ContainsName(str)) {
-					return true;
-				}
-			}
+		EXPR_OBJ_VECTOR() arguments;
+
+		ProcedureCall(std::string_view procName_in, std::vector<bool> isMemArgument_in, EXPR_OBJ_VECTOR() arguments_in) {
 
-			return false;
+			procName = Arena::Intern(procName_in);
+			isMemArgument = isMemArgument_in;
+			arguments = std::move(arguments_in);
 		}
 
-		EXPR_OBJ() Clone() override {
+		llvm::Value* codegen() override;
 
-			CLONE_EXPR_VECTOR(if_body, clone_if_body);
-			CLONE_EXPR_VECTOR(else_body, clone_else_body);
+		std::string ToLLMascal() override {
 
-			return std::make_unique<If>(condition->Clone(), std::move(clone_if_body), std::move(clone_else_body));
-		}
-	};
+			std::string res;
 
-	struct ProcedureCall : public Expression {
+			res += procName;
+			res += "(";
 
-		EXPR_OBJ_VECTOR() body;
-		EXPR_OBJ() return_obj;
+			for(size_t i = 0; i < arguments.size(); i++) {
 
-		ProcedureCall(EXPR_OBJ_VECTOR() body_in, EXPR_OBJ() return_obj_in) {
+				if(i != 0) {
+					res += ", ";
+				}
 
-			body = std::move(body_in);
-			return_obj = std::move(return_obj_in);
-		}
+				res += arguments[i]->ToLLMascal();
+			}
 
-		llvm::Value* codegen() override;
+			res += ")";
 
-		std::string ToLLMascal() override {
-			return return_obj->ToLLMascal();
+			return res;
 		}
 
 		std::string ToLLMascalBefore() override {
 
 			std::string res;
 
-			for(auto const& i: body) {
+			for(auto const& i: arguments) {
 
 				if(i->ToLLMascalBefore() != "") {
 
@@ -1471,26 +1958,17 @@ struct AST {
 					res += "\n";
 					res += GetSlashT();
 				}
-
-				res += GetSlashT();
-				res += i->ToLLMascal();
-				res += "\n";
 			}
 
 			return res;
 		}
 
-		DEFAULT_REPLACE_TARGET_NAME_TO()
-
-		DEFAULT_CONTAINS_NAME()
-
 		EXPR_OBJ() Clone() override {
 
-			CLONE_EXPR_VECTOR(body, body_clone);
+			CLONE_EXPR_VECTOR(arguments, arguments_clone);
 
-			return std::make_unique<AST::ProcedureCall>(std::move(body_clone), return_obj->Clone());
+			return Arena::New<AST::ProcedureCall>(procName, isMemArgument, std::move(arguments_clone));
 		}
-
 	};
 
 	struct Procedure {
@@ -1500,66 +1978,37 @@ struct AST {
 		std::vector<std::string> all_argument_var_types;
 		EXPR_OBJ_VECTOR() all_arguments;
 		TYPE_OBJ_VECTOR() all_argument_types;
+		std::vector<Attributes> all_argument_attrs;
 
 		TYPE_OBJ() proc_type;
 
 		EXPR_OBJ_VECTOR() body;
 
-		int call_count = 0;
-
-		Procedure(std::string procName_in, std::vector<std::string> all_argument_var_types_in, EXPR_OBJ_VECTOR() all_arguments_in, TYPE_OBJ_VECTOR() all_argument_types_in, TYPE_OBJ() proc_type_in) {
-
-			procName = procName_in;
-
-			all_argument_var_types = all_argument_var_types_in;
-			all_arguments = std::move(all_arguments_in);
-			all_argument_types = std::move(all_argument_types_in);
-
-			proc_type = std::move(proc_type_in);
-		}
+		Attributes attrs;
 
-		Procedure(std::string procName_in, std::vector<std::string> all_argument_var_types_in, EXPR_OBJ_VECTOR() all_arguments_in, TYPE_OBJ_VECTOR() all_argument_types_in, TYPE_OBJ() proc_type_in, EXPR_OBJ_VECTOR() body_in) {
+		Procedure(std::string procName_in, std::vector<std::string> all_argument_var_types_in, EXPR_OBJ_VECTOR() all_arguments_in, TYPE_OBJ_VECTOR() all_argument_types_in, std::vector<Attributes> all_argument_attrs_in, TYPE_OBJ() proc_type_in, Attributes attrs_in) {
 
 			procName = procName_in;
 
 			all_argument_var_types = all_argument_var_types_in;
 			all_arguments = std::move(all_arguments_in);
 			all_argument_types = std::move(all_argument_types_in);
+			all_argument_attrs = std::move(all_argument_attrs_in);
 
-			proc_type = std::move(proc_type_in);
-
-			body = std::move(body_in);
-		}
-
-		std::unique_ptr<AST::Procedure> Clone() {
-
-			CLONE_EXPR_VECTOR(all_arguments, all_arguments_clone);
-			CLONE_TYPE_VECTOR(all_argument_types, all_argument_types_clone);
+			proc_type = proc_type_in;
 
-			CLONE_EXPR_VECTOR(body, body_clone);
-
-			auto proc = std::make_unique<AST::Procedure>(procName, all_argument_var_types, std::move(all_arguments_clone), std::move(all_argument_types_clone), proc_type->Clone(), std::move(body_clone));
-
-			proc->call_count = call_count;
-
-			return proc;
+			attrs = attrs_in;
 		}
 
-		std::unique_ptr<AST::Procedure> CloneWithoutBody() {
-
-			CLONE_EXPR_VECTOR(all_arguments, all_arguments_clone);
-			CLONE_TYPE_VECTOR(all_argument_types, all_argument_types_clone);
-
-			return std::make_unique<AST::Procedure>(procName, all_argument_var_types, std::move(all_arguments_clone), std::move(all_argument_types_clone), proc_type->Clone());
+		bool IsMemArgument(int idx) {
+			return all_argument_var_types[idx] == "mem";
 		}
 
-		llvm::Value* codegen();
-	};
-
-	struct Attributes {
+		// Creates the 'llvm::Function' without a body, so calls can be emitted
+		// before the procedure itself (or from inside it).
+		llvm::Function* Declare();
 
-		bool isStackProtected = false;
-		bool usesCStdLib = false;
+		llvm::Function* codegen();
 	};
 
 	struct Program {
@@ -1603,21 +2052,15 @@ struct AST {
 	};
 
 	static llvm::Value* GetCurrentInstruction(AST::Expression* e);
-	static llvm::Value* GetCurrentInstructionByName(std::string name);
+	static llvm::Value* GetCurrentInstructionByName(std::string_view name);
 
 	static llvm::Value* GetOrCreateInstruction(AST::Expression* e);
 
 	static llvm::Value* GetAllocaFromMem(AST::Expression* e);
-	static llvm::Value* GetAllocaFromMemByName(std::string name);
+	static llvm::Value* GetAllocaFromMemByName(std::string_view name);
 
 	static void AddInstruction(AST::Expression* e, llvm::Value* l);
-	static void AddInstructionToName(std::string name, llvm::Value* l);
-
-	static void GlobalSaveState(llvm::BasicBlock* bb);
-	
-	static void SaveState(std::string name, llvm::BasicBlock* bb);
-	static void SetExistingState(std::string name, llvm::BasicBlock* bb);
-	static llvm::Value* FindExistingState(std::string name, llvm::BasicBlock* bb);
+	static void AddInstructionToName(std::string_view name, llvm::Value* l);
 
 	static void CreateIfPHIs(llvm::BasicBlock* continueBlock);
 	static void CreateIfElsePHIs(llvm::BasicBlock* continueBlock);
@@ -1625,10 +2068,8 @@ struct AST {
 	static bool IsInitializer(AST::Expression* t);
 	static bool IsAlgorithm(AST::Expression* t);
 
-	static bool IsInstructionInsideOfBlock(llvm::BasicBlock* bb, llvm::Value* v);
-
-	static llvm::Value* GetOrigin(std::string name);
-	static llvm::Value* GetCurrent(std::string name);
+	static llvm::Value* GetOrigin(std::string_view name);
+	static llvm::Value* GetCurrent(std::string_view name);
 };
 
 #endif
\ No newline at end of file
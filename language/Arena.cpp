@@ -0,0 +1,19 @@
+#include "Arena.hpp"
+
+thread_local llvm::BumpPtrAllocator Arena::allocator;
+
+thread_local std::vector<std::pair<void*, void(*)(void*)>> Arena::destructors;
+
+thread_local llvm::StringSet<> Arena::names;
+
+void Arena::Reset() {
+
+	for(auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+		it->second(it->first);
+	}
+
+	destructors.clear();
+	names.clear();
+
+	allocator.Reset();
+}
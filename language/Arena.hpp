@@ -0,0 +1,46 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include "llvm/Support/Allocator.h"
+#include "llvm/ADT/StringSet.h"
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for everything the parser creates (AST nodes, procedures, programs).
+// Nothing is freed one by one: 'Reset' drops the whole AST at once after codegen.
+// Each thread has its own arena, so sessions on different threads never share one.
+
+struct Arena {
+
+	static thread_local llvm::BumpPtrAllocator allocator;
+
+	// Objects that own memory outside of the arena (std::vector members),
+	// destroyed in reverse order by 'Reset'.
+	static thread_local std::vector<std::pair<void*, void(*)(void*)>> destructors;
+
+	static thread_local llvm::StringSet<> names;
+
+	template<typename T, typename... Args>
+	static T* New(Args&&... args) {
+
+		T* obj = new (allocator.Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+		if constexpr (!std::is_trivially_destructible_v<T>) {
+			destructors.push_back(std::make_pair((void*)obj, [](void* p) { static_cast<T*>(p)->~T(); }));
+		}
+
+		return obj;
+	}
+
+	// Returns the unique copy of 's'. It lives until 'Reset'.
+	static std::string_view Intern(std::string_view s) {
+
+		return names.insert(llvm::StringRef(s.data(), s.size())).first->getKey();
+	}
+
+	static void Reset();
+};
+
+#endif
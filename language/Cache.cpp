@@ -0,0 +1,400 @@
+#include "Cache.hpp"
+#include "Session.hpp"
+#include "Optimizer.hpp"
+#include "Timing.hpp"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SHA256.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+
+std::string CompilationCache::dir;
+
+uint64_t CompilationCache::maxBytes = 1024ull * 1024 * 1024;
+
+std::string CompilationCache::compilerPath;
+
+std::atomic<uint64_t> CompilationCache::hits = 0;
+std::atomic<uint64_t> CompilationCache::misses = 0;
+std::atomic<uint64_t> CompilationCache::evictions = 0;
+
+static std::mutex pruneLock;
+
+// What an entry holds besides the module, in its 'meta' file.
+struct CacheMeta {
+
+	bool usesRuntime = false;
+	bool usesCStdLib = false;
+
+	unsigned objects = 0;
+};
+
+bool CompilationCache::ParseArgument(std::string arg) {
+
+	std::string dirArg = "--cache-dir=";
+	std::string sizeArg = "--cache-max-size=";
+
+	if(arg.rfind(dirArg, 0) == 0) {
+
+		dir = arg.substr(dirArg.size());
+		return !dir.empty();
+	}
+
+	if(arg.rfind(sizeArg, 0) == 0) {
+
+		uint64_t megabytes = 0;
+
+		if(llvm::StringRef(arg).substr(sizeArg.size()).getAsInteger(10, megabytes)) {
+			return false;
+		}
+
+		maxBytes = megabytes * 1024 * 1024;
+		return true;
+	}
+
+	return false;
+}
+
+// Changes every time the compiler is rebuilt.
+static std::string CompilerVersion() {
+
+	std::string version = "mascal llvm-" LLVM_VERSION_STRING;
+
+	llvm::sys::fs::file_status status;
+
+	if(!CompilationCache::compilerPath.empty() && !llvm::sys::fs::status(CompilationCache::compilerPath, status)) {
+
+		version += " " + std::to_string(status.getSize());
+		version += " " + std::to_string(status.getLastModificationTime().time_since_epoch().count());
+	}
+
+	return version;
+}
+
+std::string CompilationCache::Key(CompilationSession& session) {
+
+	llvm::SHA256 hash;
+
+	// Every part ends with a 0, so two different lists of parts never hash the same bytes.
+	auto add = [&](llvm::StringRef s) {
+		hash.update(s);
+		hash.update(llvm::StringRef("\0", 1));
+	};
+
+	add(CompilerVersion());
+
+	add(CodeGen::TheModule->getTargetTriple());
+	add(CodeGen::TheTargetMachine->getTargetCPU());
+	add(CodeGen::TheTargetMachine->getTargetFeatureString());
+
+	add(Optimizer::LevelToString(Optimizer::GetLevel()));
+	add(Optimizer::customPasses);
+
+	add(CodeGen::splitBackend ? "split" : "whole");
+
+	// Attributes are tokens of the source too, so they are part of the key like everything else.
+	Lexer tokens(session.lexer->Content);
+	tokens.Start();
+
+	for(int t = tokens.GetToken(); t != Token::EndOfFile; t = tokens.GetToken()) {
+
+		add(std::to_string(t));
+
+		if(t == Token::Identifier) add(tokens.IdentifierStr);
+		else if(t == Token::Number) add(tokens.NumValString);
+		else if(t == Token::String) add(tokens.StringString);
+	}
+
+	return llvm::toHex(hash.final(), true);
+}
+
+static std::string EntryFile(const std::string& key, std::string name) {
+
+	llvm::SmallString<256> path(CompilationCache::dir);
+	llvm::sys::path::append(path, key, name);
+
+	return path.str().str();
+}
+
+// Written to a temporary file and renamed, so readers find the old file or the new one.
+static bool WriteFile(const std::string& path, llvm::StringRef data) {
+
+	int fd = -1;
+	llvm::SmallString<256> tmp;
+
+	if(llvm::sys::fs::createUniqueFile(path + ".tmp%%%%%%", fd, tmp)) {
+		return false;
+	}
+
+	llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+	os << data;
+	os.close();
+
+	if(os.has_error()) {
+		os.clear_error();
+		llvm::sys::fs::remove(tmp);
+		return false;
+	}
+
+	if(llvm::sys::fs::rename(tmp, path)) {
+		llvm::sys::fs::remove(tmp);
+		return false;
+	}
+
+	return true;
+}
+
+static bool CopyFile(const std::string& from, const std::string& to) {
+
+	auto buffer = llvm::MemoryBuffer::getFile(from, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+
+	return buffer && WriteFile(to, (*buffer)->getBuffer());
+}
+
+static bool ReadMeta(const std::string& key, CacheMeta& meta) {
+
+	auto buffer = llvm::MemoryBuffer::getFile(EntryFile(key, "meta"));
+
+	if(!buffer) {
+		return false;
+	}
+
+	std::istringstream in((*buffer)->getBuffer().str());
+
+	return (bool)(in >> meta.usesRuntime >> meta.usesCStdLib >> meta.objects);
+}
+
+static bool WriteMeta(const std::string& key, const CacheMeta& meta) {
+
+	std::string data = std::to_string(meta.usesRuntime) + " " + std::to_string(meta.usesCStdLib) + " " + std::to_string(meta.objects) + "\n";
+
+	return WriteFile(EntryFile(key, "meta"), data);
+}
+
+// Entries are evicted by the date of their 'meta', the last time they were used.
+static void Touch(const std::string& key) {
+
+	int fd = -1;
+
+	if(llvm::sys::fs::openFileForWrite(EntryFile(key, "meta"), fd, llvm::sys::fs::CD_OpenExisting, llvm::sys::fs::OF_Append)) {
+		return;
+	}
+
+	llvm::sys::fs::setLastAccessAndModificationTime(fd, std::chrono::time_point_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now()));
+	llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+}
+
+bool CompilationCache::Load(CompilationSession& session) {
+
+	if(dir.empty()) {
+		return false;
+	}
+
+	Timing::Scope scope("cache", "Cache lookup");
+
+	session.cacheKey = Key(session);
+
+	CacheMeta meta;
+
+	auto bitcode = llvm::MemoryBuffer::getFile(EntryFile(session.cacheKey, "module.bc"), /*IsText=*/false, /*RequiresNullTerminator=*/false);
+	auto llm = llvm::MemoryBuffer::getFile(EntryFile(session.cacheKey, "llm.mascal"));
+
+	// An entry can be missing a file while another process writes or evicts it. That's a miss.
+	if(!ReadMeta(session.cacheKey, meta) || !bitcode || !llm) {
+		misses++;
+		return false;
+	}
+
+	auto M = llvm::parseBitcodeFile((*bitcode)->getMemBufferRef(), *CodeGen::TheContext);
+
+	if(!M) {
+		llvm::consumeError(M.takeError());
+		misses++;
+		return false;
+	}
+
+	if(!WriteFile(session.llmPath, (*llm)->getBuffer())) {
+		CompilationSession::Out() << "Error: Could not write '" << session.llmPath << "'.\n";
+		CompilationSession::Fail();
+	}
+
+	// Another source with the same tokens may have stored it.
+	(*M)->setModuleIdentifier(CodeGen::TheModule->getModuleIdentifier());
+	(*M)->setSourceFileName(CodeGen::TheModule->getSourceFileName());
+
+	CodeGen::TheModule = std::move(*M);
+	CodeGen::usesRuntime = meta.usesRuntime;
+
+	session.usesCStdLib = meta.usesCStdLib;
+	session.cachedObjectCount = meta.objects;
+	session.cacheHit = true;
+
+	Touch(session.cacheKey);
+
+	hits++;
+
+	return true;
+}
+
+bool CompilationCache::LoadObjects(CompilationSession& session) {
+
+	if(!session.cacheHit || session.cachedObjectCount == 0) {
+		return false;
+	}
+
+	Timing::Scope scope("cache", "Cache load objects");
+
+	std::vector<std::string> objects = CodeGen::ObjectFileNames(session.objectPath, session.cachedObjectCount);
+
+	for(size_t i = 0; i < objects.size(); i++) {
+
+		if(!CopyFile(EntryFile(session.cacheKey, "object." + std::to_string(i) + ".o"), objects[i])) {
+			return false;
+		}
+	}
+
+	session.objects = objects;
+
+	return true;
+}
+
+void CompilationCache::StoreModule(CompilationSession& session) {
+
+	if(session.cacheKey.empty() || session.cacheHit) {
+		return;
+	}
+
+	Timing::Scope scope("cache", "Cache store");
+
+	if(llvm::sys::fs::create_directories(EntryFile(session.cacheKey, ""))) {
+		return;
+	}
+
+	llvm::SmallVector<char, 0> bitcode;
+	llvm::raw_svector_ostream os(bitcode);
+
+	llvm::WriteBitcodeToFile(*CodeGen::TheModule, os);
+
+	if(!WriteFile(EntryFile(session.cacheKey, "module.bc"), llvm::StringRef(bitcode.data(), bitcode.size()))) {
+		return;
+	}
+
+	if(!CopyFile(session.llmPath, EntryFile(session.cacheKey, "llm.mascal"))) {
+		return;
+	}
+
+	CacheMeta meta;
+	meta.usesRuntime = CodeGen::usesRuntime;
+	meta.usesCStdLib = session.usesCStdLib;
+
+	WriteMeta(session.cacheKey, meta);
+}
+
+void CompilationCache::StoreObjects(CompilationSession& session) {
+
+	if(session.cacheKey.empty()) {
+		return;
+	}
+
+	Timing::Scope scope("cache", "Cache store objects");
+
+	if(llvm::sys::fs::create_directories(EntryFile(session.cacheKey, ""))) {
+		return;
+	}
+
+	for(size_t i = 0; i < session.objects.size(); i++) {
+
+		if(!CopyFile(session.objects[i], EntryFile(session.cacheKey, "object." + std::to_string(i) + ".o"))) {
+			return;
+		}
+	}
+
+	CacheMeta meta;
+	meta.usesRuntime = CodeGen::usesRuntime;
+	meta.usesCStdLib = session.usesCStdLib;
+	meta.objects = session.objects.size();
+
+	WriteMeta(session.cacheKey, meta);
+}
+
+void CompilationCache::Prune() {
+
+	if(dir.empty()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(pruneLock);
+
+	Timing::Scope scope("cache", "Cache prune");
+
+	struct Entry {
+
+		std::string path;
+		uint64_t bytes = 0;
+
+		llvm::sys::TimePoint<> used;
+	};
+
+	std::vector<Entry> entries;
+	uint64_t total = 0;
+
+	std::error_code EC;
+
+	for(llvm::sys::fs::directory_iterator it(dir, EC), end; it != end && !EC; it.increment(EC)) {
+
+		if(it->type() != llvm::sys::fs::file_type::directory_file) {
+			continue;
+		}
+
+		Entry e;
+		e.path = it->path();
+
+		// Entries still being written have no 'meta' yet, they are left alone.
+		llvm::sys::fs::file_status meta;
+
+		if(llvm::sys::fs::status(e.path + "/meta", meta)) {
+			continue;
+		}
+
+		e.used = meta.getLastModificationTime();
+
+		std::error_code fileEC;
+
+		for(llvm::sys::fs::directory_iterator f(e.path, fileEC), fileEnd; f != fileEnd && !fileEC; f.increment(fileEC)) {
+
+			auto status = f->status();
+
+			if(status) {
+				e.bytes += status->getSize();
+			}
+		}
+
+		total += e.bytes;
+		entries.push_back(e);
+	}
+
+	if(total <= maxBytes) {
+		return;
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+
+	for(auto const& e : entries) {
+
+		if(total <= maxBytes) {
+			break;
+		}
+
+		if(!llvm::sys::fs::remove_directories(e.path)) {
+			total -= e.bytes;
+			evictions++;
+		}
+	}
+}
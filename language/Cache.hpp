@@ -0,0 +1,51 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+struct CompilationSession;
+
+// On-disk cache of compiled programs ('--cache-dir=dir'). An entry is keyed by a hash
+// of the token stream of the source (so whitespace and comments don't matter), the
+// compiler, the target and the options that change the output. It holds the optimized
+// bitcode, the objects once a 'build' emitted them, and the '.llm.mascal' of the program.
+//
+// Entries are directories named after their key. Files are written to a temporary
+// name and renamed, so processes and threads sharing the cache never read half of one.
+// The least recently used entries are removed once the cache is over '--cache-max-size'.
+struct CompilationCache {
+
+	// Empty when the cache is off.
+	static std::string dir;
+
+	static uint64_t maxBytes;
+
+	// Set by 'main'. Its size and date identify the compiler in the key.
+	static std::string compilerPath;
+
+	static std::atomic<uint64_t> hits;
+	static std::atomic<uint64_t> misses;
+	static std::atomic<uint64_t> evictions;
+
+	// Consumes '--cache-dir=dir' and '--cache-max-size=MB'.
+	// Returns false if the argument is not a cache argument.
+	static bool ParseArgument(std::string arg);
+
+	static std::string Key(CompilationSession& session);
+
+	// Replaces the module of the session with the cached one. Sets 'session.cacheHit'.
+	static bool Load(CompilationSession& session);
+
+	// Copies the cached objects to the ones the session builds. False if there are none.
+	static bool LoadObjects(CompilationSession& session);
+
+	static void StoreModule(CompilationSession& session);
+	static void StoreObjects(CompilationSession& session);
+
+	// Evicts entries until the cache fits in 'maxBytes'.
+	static void Prune();
+};
+
+#endif
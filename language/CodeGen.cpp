@@ -1,156 +1,832 @@
 #include "CodeGen.hpp"
 #include "AST.hpp"
+#include "Optimizer.hpp"
+#include "Session.hpp"
+#include "Timing.hpp"
+#include "../runtime/MascalRT.hpp"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
-std::unique_ptr<llvm::LLVMContext> 	CodeGen::TheContext;
-std::unique_ptr<llvm::IRBuilder<>> 	CodeGen::Builder;
-std::unique_ptr<llvm::Module> 		CodeGen::TheModule;
+thread_local std::unique_ptr<llvm::LLVMContext> 	CodeGen::TheContext;
+thread_local std::unique_ptr<llvm::IRBuilder<>> 	CodeGen::Builder;
+thread_local std::unique_ptr<llvm::Module> 		CodeGen::TheModule;
 
-std::unordered_map<std::string, std::unique_ptr<LLVM_Com>> CodeGen::all_coms;
-std::unordered_map<std::string, std::unique_ptr<LLVM_Mem>> CodeGen::all_mems;
+thread_local std::unique_ptr<llvm::TargetMachine> CodeGen::TheTargetMachine;
+
+thread_local LLVM_Symbols CodeGen::symbols;
 
 bool CodeGen::releaseMode = false;
 
-std::vector<std::pair<std::string, llvm::PHINode*>> CodeGen::all_phi_nodes;
+bool CodeGen::splitBackend = false;
+unsigned CodeGen::backendThreads = 0;
+
+thread_local bool CodeGen::usesRuntime = false;
+std::string CodeGen::runtimeDir = ".";
+
+thread_local LLVM_Captures* CodeGen::captures = nullptr;
 
-std::vector<llvm::BasicBlock*> CodeGen::pureBlocks;
+thread_local std::vector<llvm::BasicBlock*> CodeGen::pureBlocks;
 
-void CodeGen::Initialize()
+static std::once_flag nativeTargetFlag;
+
+std::unique_ptr<llvm::TargetMachine> CodeGen::InitializeTarget(llvm::Module* M)
 {
-	// Open a new context and module.
- 	TheContext = std::make_unique<llvm::LLVMContext>();
+	// The target registry is global, it is filled once and shared by every session.
+	std::call_once(nativeTargetFlag, []() {
+		llvm::InitializeNativeTarget();
+		llvm::InitializeNativeTargetAsmPrinter();
+		llvm::InitializeNativeTargetAsmParser();
+	});
+
+	std::string targetTriple = llvm::sys::getDefaultTargetTriple();
+
+	std::string error;
+	const llvm::Target* target = llvm::TargetRegistry::lookupTarget(targetTriple, error);
 
- 	TheModule = std::make_unique<llvm::Module>("Mascal", *TheContext);
- 	//TheModule->setDataLayout(TheJIT->getDataLayout());
+	if(target == nullptr) {
+		CompilationSession::Out() << "Error: " << error << "\n";
+		CompilationSession::Fail();
+	}
+
+	llvm::SubtargetFeatures features;
+	llvm::StringMap<bool> hostFeatures;
+
+	if(llvm::sys::getHostCPUFeatures(hostFeatures)) {
+		for(auto& f : hostFeatures) {
+			features.AddFeature(f.first(), f.second);
+		}
+	}
 
- 	 // Create a new builder for the module.
- 	Builder = std::make_unique<llvm::IRBuilder<>>(*TheContext);
+	llvm::CodeGenOpt::Level cgLevel = Optimizer::GetLevel() == OptimizerLevel::OptO0 ? llvm::CodeGenOpt::None : llvm::CodeGenOpt::Default;
+
+	llvm::TargetOptions opt;
+	std::unique_ptr<llvm::TargetMachine> TM(target->createTargetMachine(targetTriple, llvm::sys::getHostCPUName(), features.getString(), opt, std::optional<llvm::Reloc::Model>(), std::nullopt, cgLevel));
+
+	M->setTargetTriple(targetTriple);
+	M->setDataLayout(TM->createDataLayout());
+
+	return TM;
 }
 
-void CodeGen::AddPHINodeToVec(std::string name, llvm::PHINode* p) {
+void CodeGen::Reset()
+{
+	symbols = LLVM_Symbols();
+	captures = nullptr;
+
+	pureBlocks.clear();
 
-	CodeGen::all_phi_nodes.push_back(std::make_pair(name, p));
+	usesRuntime = false;
 }
 
-llvm::Value* CodeGen::Default(llvm::Value* v) {
+void CodeGen::AddGCCMainStub()
+{
+	// MinGW and Cygwin backends insert a call to '__main' at the start of 'main'.
+	// Without the C runtime nothing defines it, so give the linker an empty one.
+	if(!TheTargetMachine->getTargetTriple().isOSCygMing()) {
+		return;
+	}
 
-	return CodeGen::DefaultFromType(v->getType());
+	if(TheModule->getFunction("__main") != nullptr) {
+		return;
+	}
+
+	llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getVoidTy(*TheContext), false);
+	llvm::Function* F = llvm::Function::Create(FT, llvm::Function::WeakAnyLinkage, "__main", TheModule.get());
+
+	llvm::IRBuilder<> StubBuilder(llvm::BasicBlock::Create(*TheContext, "entry", F));
+	StubBuilder.CreateRetVoid();
 }
 
-llvm::Constant* CodeGen::DefaultFromType(llvm::Type* t, llvm::Type* arrayElementT) {
+bool CodeGen::ParseArgument(std::string arg)
+{
+	std::string threadsArg = "--backend-threads=";
 
-	if(dyn_cast<llvm::IntegerType>(t) != nullptr) {
+	if(arg.rfind(threadsArg, 0) == 0) {
 
-		auto intType = dyn_cast<llvm::IntegerType>(t);
+		if(llvm::StringRef(arg).substr(threadsArg.size()).getAsInteger(10, backendThreads)) {
+			return false;
+		}
 
-		return llvm::ConstantInt::get(*CodeGen::TheContext, llvm::APInt(intType->getBitWidth(), 0, true));
+		splitBackend = true;
+		return true;
+	}
+
+	return false;
+}
+
+// Empty on success. Backend threads can't end the session themselves, so errors are returned.
+static std::string EmitObject(llvm::Module* M, llvm::TargetMachine* TM, const std::string& fileName)
+{
+	Timing::Scope scope("emit", "Emit object", fileName);
+
+	std::error_code EC;
+	llvm::raw_fd_ostream dest(fileName, EC, llvm::sys::fs::OF_None);
+
+	if(EC) {
+		return "Error: Could not open file '" + fileName + "': " + EC.message() + "\n";
+	}
+
+	llvm::legacy::PassManager pass;
+
+	if(TM->addPassesToEmitFile(pass, dest, nullptr, llvm::CGFT_ObjectFile)) {
+		return "Error: The target machine can't emit an object file.\n";
+	}
+
+	pass.run(*M);
+	dest.flush();
+
+	return "";
+}
+
+void CodeGen::EmitObjectFile(std::string fileName)
+{
+	std::string error = EmitObject(TheModule.get(), TheTargetMachine.get(), fileName);
+
+	if(!error.empty()) {
+		CompilationSession::Out() << error;
+		CompilationSession::Fail();
+	}
+}
+
+// Runs on a backend thread. The partition is read back into a context of its own,
+// since an LLVMContext can only be used by one thread at a time.
+static std::string EmitPartition(const llvm::SmallVector<char, 0>& bitcode, const std::string& fileName)
+{
+	Timing::Scope scope("emit", "Emit partition", fileName);
+
+	llvm::LLVMContext context;
+
+	auto M = llvm::parseBitcodeFile(llvm::MemoryBufferRef(llvm::StringRef(bitcode.data(), bitcode.size()), fileName), context);
+
+	if(!M) {
+		return "Error: Could not read back a partition of the module: " + llvm::toString(M.takeError()) + "\n";
+	}
+
+	std::unique_ptr<llvm::TargetMachine> TM = CodeGen::InitializeTarget(M->get());
+
+	return EmitObject(M->get(), TM.get(), fileName);
+}
+
+std::vector<std::string> CodeGen::ObjectFileNames(std::string fileName, size_t count)
+{
+	if(!splitBackend) {
+		return { fileName };
+	}
+
+	llvm::SmallString<256> stem(fileName);
+	llvm::sys::path::replace_extension(stem, "");
+
+	std::vector<std::string> objects;
+
+	for(size_t i = 0; i < count; i++) {
+		objects.push_back(stem.str().str() + "." + std::to_string(i) + ".o");
+	}
+
+	return objects;
+}
+
+std::vector<std::string> CodeGen::EmitObjectFiles(std::string fileName)
+{
+	Timing::Scope scope("emit", "Emit");
+
+	if(!splitBackend) {
+
+		EmitObjectFile(fileName);
+
+		return { fileName };
 	}
 
-	else if(dyn_cast<llvm::ArrayType>(t) != nullptr) {
+	unsigned definedFunctions = 0;
+
+	for(auto const& F : *TheModule) {
+		if(!F.isDeclaration()) definedFunctions++;
+	}
+
+	// The partitions only depend on the module, never on the number of threads,
+	// so the objects (and the program linked from them) are the same for any '-j'.
+	unsigned partitions = definedFunctions < maxBackendPartitions ? definedFunctions : maxBackendPartitions;
+
+	if(partitions == 0) partitions = 1;
+
+	std::vector<llvm::SmallVector<char, 0>> bitcodes;
+
+	{
+		Timing::Scope scope("emit", "Split module");
+
+		llvm::SplitModule(*TheModule, partitions, [&](std::unique_ptr<llvm::Module> part) {
+
+			bitcodes.emplace_back();
+
+			llvm::raw_svector_ostream os(bitcodes.back());
+			llvm::WriteBitcodeToFile(*part, os);
+		});
+	}
+
+	std::vector<std::string> objects = ObjectFileNames(fileName, bitcodes.size());
+
+	std::vector<std::string> errors(bitcodes.size());
+
+	unsigned threads = backendThreads == 0 ? std::thread::hardware_concurrency() : backendThreads;
+
+	if(threads == 0) threads = 1;
+	if(threads > bitcodes.size()) threads = bitcodes.size();
 
-		if(arrayElementT == nullptr) {
+	std::atomic<size_t> next = 0;
 
-			std::cout << "Error: Array Element Type not found.\n";
-			exit(1);
+	auto worker = [&]() {
+
+		for(size_t i = next++; i < bitcodes.size(); i = next++) {
+			errors[i] = EmitPartition(bitcodes[i], objects[i]);
 		}
+	};
+
+	std::vector<std::thread> pool;
+
+	for(unsigned t = 1; t < threads; t++) {
+		pool.emplace_back(worker);
+	}
+
+	worker();
 
-		auto arrType = dyn_cast<llvm::ArrayType>(t);
+	for(auto& t : pool) {
+		t.join();
+	}
 
-		std::vector<llvm::Constant*> a;
+	for(auto const& error : errors) {
 
-		for(int i = 0; i < arrType->getNumElements(); i++) {
-			a.push_back(CodeGen::DefaultFromType(arrayElementT));
+		if(!error.empty()) {
+			CompilationSession::Out() << error;
+			CompilationSession::Fail();
 		}
+	}
+
+	return objects;
+}
+
+llvm::FunctionCallee CodeGen::GetParforRuntime() {
+
+	llvm::Type* i64 = llvm::Type::getInt64Ty(*TheContext);
+	llvm::Type* ptr = llvm::PointerType::getUnqual(*TheContext);
+
+	llvm::FunctionType* FT = llvm::FunctionType::get(i64, { i64, i64, ptr, ptr }, false);
+
+	usesRuntime = true;
+
+	return TheModule->getOrInsertFunction("__mascal_parfor", FT);
+}
+
+// Runs 'find' as if the function enclosing the current 'parfor' was the one being generated.
+template<typename T, typename F>
+static T* FindInEnclosing(F find) {
+
+	LLVM_Captures* current = CodeGen::captures;
+
+	std::swap(CodeGen::symbols, *current->outer);
+	CodeGen::captures = current->parent;
+
+	T* found = find();
+
+	CodeGen::captures = current;
+	std::swap(CodeGen::symbols, *current->outer);
+
+	return found;
+}
+
+// Loads the pointer stored for a new capture in the context of the current 'parfor'.
+static llvm::Value* LoadCapturePointer() {
+
+	LLVM_Captures* c = CodeGen::captures;
 
-		return llvm::ConstantArray::get(arrType, llvm::ArrayRef(a));
+	llvm::Type* ptrTy = llvm::PointerType::getUnqual(*CodeGen::TheContext);
+
+	llvm::Value* slot = CodeGen::Builder->CreateConstInBoundsGEP1_64(ptrTy, c->ctx, c->firstCapture + c->order.size());
+
+	return CodeGen::Builder->CreateLoad(ptrTy, slot);
+}
+
+LLVM_Com* CodeGen::FindCom(std::string_view name) {
+
+	auto it = symbols.comIds.find(name);
+
+	if(it != symbols.comIds.end()) {
+		return symbols.coms[it->second].get();
 	}
 
-	std::cout << "Error: Type not found.\n";
-	exit(1);
+	if(captures == nullptr) {
+		return nullptr;
+	}
 
-	return nullptr;
+	LLVM_Com* outerCom = FindInEnclosing<LLVM_Com>([&]() { return CodeGen::FindCom(name); });
+
+	if(outerCom == nullptr) {
+		return nullptr;
+	}
+
+	// Every chunk of the body gets its own copy of the com.
+	llvm::IRBuilderBase::InsertPointGuard guard(*Builder);
+	Builder->SetInsertPoint(captures->entry->getTerminator());
+
+	llvm::Value* v = Builder->CreateLoad(outerCom->ty, LoadCapturePointer(), llvm::StringRef(name.data(), name.size()));
+
+	captures->order.push_back(std::make_pair(false, (unsigned)captures->coms.size()));
+	captures->coms.push_back(outerCom);
+
+	return AddCom(name, v);
 }
 
-void CodeGen::UpdateAllPHIPreds() {
+LLVM_Mem* CodeGen::FindMem(std::string_view name) {
+
+	auto it = symbols.memIds.find(name);
 
-	for(auto i : CodeGen::all_phi_nodes) {
+	if(it == symbols.memIds.end()) {
 
-		llvm::BasicBlock* parent = i.second->getParent();
+		if(captures == nullptr) {
+			return nullptr;
+		}
 
-		std::vector<llvm::BasicBlock*> blockPreds;
+		LLVM_Mem* outerMem = FindInEnclosing<LLVM_Mem>([&]() { return CodeGen::FindMem(name); });
 
-		for (auto it = llvm::pred_begin(parent), et = llvm::pred_end(parent); it != et; ++it)
-		{
-			llvm::BasicBlock* predecessor = *it;
-			blockPreds.push_back(predecessor);
+		if(outerMem == nullptr) {
+			return nullptr;
 		}
 
-		for(auto b : blockPreds) {
-			auto V = AST::FindExistingState(i.first, b);
+		// Mems are shared, the body gets a pointer to the same storage.
+		llvm::IRBuilderBase::InsertPointGuard guard(*Builder);
+		Builder->SetInsertPoint(captures->entry->getTerminator());
 
-			if(!AST::IsInstructionInsideOfBlock(b, V)) {
-				auto newV = AST::GetOrigin(i.first);
+		llvm::Value* ptr = LoadCapturePointer();
 
-				if(!AST::IsInstructionInsideOfBlock(b, newV)) {
-					V = Default(newV);
-				}
-				else {
-					V = newV;
-				}
-			}
+		captures->order.push_back(std::make_pair(true, (unsigned)captures->mems.size()));
+		captures->mems.push_back(outerMem);
+
+		LLVM_Mem* capturedMem = AddMem(name, ptr, outerMem->ty);
+		capturedMem->align = outerMem->align;
+		capturedMem->aliasScope = outerMem->aliasScope;
 
-			if(V == nullptr) {
-				std::cout << i.first << "'s state doesn't exist in block '" << std::string(b->getName()) << "'.\n";
-				exit(1);
+		return capturedMem;
+	}
+
+	LLVM_Mem* lmem = symbols.mems[it->second].get();
+
+	// Mems are still visible after their scope ends, so using one there keeps it alive.
+	if(lmem->isOutOfScope) {
+		CodeGen::KeepAlive(lmem);
+	}
+
+	return lmem;
+}
+
+LLVM_Com* CodeGen::AddCom(std::string_view name, llvm::Value* v) {
+
+	LLVM_Com* lcom = nullptr;
+
+	// Not 'FindCom': declaring a com inside a 'parfor' must not capture the outer one.
+	auto it = symbols.comIds.find(name);
+
+	if(it != symbols.comIds.end()) {
+		lcom = symbols.coms[it->second].get();
+	}
+
+	if(lcom == nullptr) {
+
+		symbols.comIds[name] = symbols.coms.size();
+		symbols.coms.push_back(std::make_unique<LLVM_Com>());
+
+		lcom = symbols.coms.back().get();
+		lcom->name = name;
+		lcom->id = symbols.coms.size() - 1;
+	}
+
+	lcom->origin = v;
+	lcom->ty = v->getType();
+	lcom->originBlock = CodeGen::Builder->GetInsertBlock();
+	lcom->isOutOfScope = false;
+
+	CodeGen::WriteCom(lcom, lcom->originBlock, v);
+
+	return lcom;
+}
+
+LLVM_Mem* CodeGen::AddMem(std::string_view name, llvm::Value* v, llvm::Type* ty) {
+
+	std::unique_ptr<LLVM_Mem> lmem = std::make_unique<LLVM_Mem>();
+	lmem->name = name;
+	lmem->origin = v;
+	lmem->current = v;
+	lmem->ty = ty;
+	lmem->originBlock = CodeGen::Builder->GetInsertBlock();
+
+	auto it = symbols.memIds.find(name);
+
+	if(it != symbols.memIds.end()) {
+
+		lmem->id = it->second;
+		symbols.mems[lmem->id] = std::move(lmem);
+		return symbols.mems[it->second].get();
+	}
+
+	lmem->id = symbols.mems.size();
+	symbols.memIds[name] = lmem->id;
+	symbols.mems.push_back(std::move(lmem));
+
+	return symbols.mems.back().get();
+}
+
+llvm::AllocaInst* CodeGen::CreateEntryAlloca(llvm::Type* ty, std::string_view name) {
+
+	llvm::Function* F = CodeGen::Builder->GetInsertBlock()->getParent();
+
+	llvm::IRBuilder<> EntryBuilder(&F->getEntryBlock(), F->getEntryBlock().begin());
+
+	return EntryBuilder.CreateAlloca(ty, nullptr, llvm::StringRef(name.data(), name.size()));
+}
+
+void CodeGen::StartLifetime(LLVM_Mem* lmem) {
+
+	llvm::BasicBlock* bb = CodeGen::Builder->GetInsertBlock();
+
+	// Mems of the entry block live as long as the function.
+	if(bb->isEntryBlock()) {
+		return;
+	}
+
+	uint64_t size = TheModule->getDataLayout().getTypeAllocSize(lmem->ty);
+
+	CodeGen::Builder->CreateLifetimeStart(lmem->origin, CodeGen::Builder->getInt64(size));
+
+	lmem->hasLifetime = true;
+}
+
+llvm::GlobalVariable* CodeGen::CreateStaticMem(llvm::Type* ty, std::string_view name, llvm::Constant* init) {
+
+	return new llvm::GlobalVariable(*TheModule, ty, false, llvm::GlobalValue::InternalLinkage, init, llvm::StringRef(name.data(), name.size()));
+}
+
+llvm::MDNode* CodeGen::CreateAliasScope(std::string_view name) {
+
+	llvm::MDBuilder MDB(*TheContext);
+
+	if(symbols.aliasDomain == nullptr) {
+		symbols.aliasDomain = MDB.createAnonymousAliasScopeDomain(Builder->GetInsertBlock()->getParent()->getName());
+	}
+
+	return MDB.createAnonymousAliasScope(symbols.aliasDomain, llvm::StringRef(name.data(), name.size()));
+}
+
+void CodeGen::AddScopedAccess(llvm::Instruction* I, LLVM_Mem* lmem) {
+
+	if(lmem != nullptr && lmem->aliasScope != nullptr) {
+		symbols.scopedAccesses.push_back(std::make_pair(I, lmem->aliasScope));
+	}
+}
+
+void CodeGen::FinishAliasScopes() {
+
+	std::vector<llvm::Metadata*> scopes;
+
+	for(auto const& [I, scope] : symbols.scopedAccesses) {
+
+		if(std::find(scopes.begin(), scopes.end(), scope) == scopes.end()) {
+			scopes.push_back(scope);
+		}
+	}
+
+	for(auto const& [I, scope] : symbols.scopedAccesses) {
+
+		std::vector<llvm::Metadata*> others;
+
+		for(auto const& i : scopes) {
+
+			if(i != scope) {
+				others.push_back(i);
 			}
+		}
 
-			i.second->addIncoming(V, b);
+		I->setMetadata(llvm::LLVMContext::MD_alias_scope, llvm::MDNode::get(*TheContext, { scope }));
+
+		if(!others.empty()) {
+			I->setMetadata(llvm::LLVMContext::MD_noalias, llvm::MDNode::get(*TheContext, others));
 		}
 	}
+
+	symbols.scopedAccesses.clear();
 }
 
-int CodeGen::GetParentId(std::string name, llvm::BasicBlock* bb) {
+void CodeGen::StoreInitializer(llvm::Value* ptr, llvm::Value* v) {
 
-	if(CodeGen::all_coms.find(name) != CodeGen::all_coms.end()) {
+	llvm::Constant* c = dyn_cast<llvm::Constant>(v);
 
-		int count = 0;
+	if(c != nullptr && c->isNullValue() && v->getType()->isAggregateType()) {
 
-		for(auto i : CodeGen::all_coms[name]->blockParents) {
+		const llvm::DataLayout& DL = TheModule->getDataLayout();
 
-			if(i == bb) {
-				return count;
-			}
+		CodeGen::Builder->CreateMemSet(ptr, CodeGen::Builder->getInt8(0), DL.getTypeAllocSize(v->getType()), DL.getPrefTypeAlign(v->getType()));
+		return;
+	}
+
+	CodeGen::Builder->CreateStore(v, ptr);
+}
+
+void CodeGen::KeepAlive(llvm::Value* origin) {
+
+	for(auto const& lmem : symbols.mems) {
+
+		if(lmem->origin == origin) {
+			KeepAlive(lmem.get());
+		}
+	}
+}
+
+void CodeGen::KeepAlive(LLVM_Mem* lmem) {
+
+	for(llvm::Instruction* end : lmem->lifetimeEnds) {
+		end->eraseFromParent();
+	}
+
+	lmem->lifetimeEnds.clear();
+	lmem->hasLifetime = false;
+}
+
+unsigned CodeGen::GetBlockId(llvm::BasicBlock* bb) {
+
+	auto inserted = symbols.blockIds.insert(std::make_pair(bb, (unsigned)symbols.blocks.size()));
+
+	if(inserted.second) {
+
+		symbols.blocks.emplace_back();
+		symbols.blocks.back().bb = bb;
+
+		// Entry blocks have no predecessors to wait for.
+		symbols.blocks.back().sealed = bb->getParent() != nullptr && bb->isEntryBlock();
+	}
+
+	return inserted.first->second;
+}
+
+static llvm::Value*& BlockDef(unsigned blockId, unsigned comId) {
+
+	std::vector<llvm::Value*>& defs = CodeGen::symbols.blocks[blockId].defs;
+
+	// Coms declared after the block was numbered.
+	if(defs.size() <= comId) {
+		defs.resize(CodeGen::symbols.coms.size(), nullptr);
+	}
+
+	return defs[comId];
+}
+
+static llvm::Value* ResolvePHI(llvm::Value* v) {
+
+	auto it = CodeGen::symbols.removedPHIs.find(v);
+
+	while(it != CodeGen::symbols.removedPHIs.end()) {
+		v = it->second;
+		it = CodeGen::symbols.removedPHIs.find(v);
+	}
+
+	return v;
+}
+
+static llvm::PHINode* CreateEmptyPHI(LLVM_Com* lcom, llvm::BasicBlock* bb) {
+
+	if(llvm::Instruction* firstNonPHI = bb->getFirstNonPHI()) {
+		return llvm::PHINode::Create(lcom->ty, 2, "phi", firstNonPHI);
+	}
+
+	return llvm::PHINode::Create(lcom->ty, 2, "phi", bb);
+}
+
+// PHIs still being filled (or waiting for their block to be sealed) can't be judged yet.
+static bool IsPHIComplete(llvm::PHINode* phi) {
+
+	return phi->getNumIncomingValues() == llvm::pred_size(phi->getParent());
+}
+
+static llvm::Value* TryRemoveTrivialPHI(llvm::PHINode* phi) {
+
+	llvm::Value* same = nullptr;
+
+	for(llvm::Value* op : phi->incoming_values()) {
+
+		if(op == same || op == phi) {
+			continue;
+		}
+
+		// Merges at least two different values.
+		if(same != nullptr) {
+			return phi;
+		}
+
+		same = op;
+	}
+
+	// Unreachable, or the com is read where it was never defined.
+	if(same == nullptr) {
+		same = llvm::Constant::getNullValue(phi->getType());
+	}
+
+	std::vector<llvm::PHINode*> phiUsers;
+
+	for(llvm::User* u : phi->users()) {
+
+		llvm::PHINode* userPHI = dyn_cast<llvm::PHINode>(u);
 
-			count += 1;
+		if(userPHI != nullptr && userPHI != phi) {
+			phiUsers.push_back(userPHI);
 		}
 	}
 
-	return -1;
+	phi->replaceAllUsesWith(same);
+	CodeGen::symbols.removedPHIs[phi] = same;
+
+	// Users may have become trivial too.
+	for(llvm::PHINode* userPHI : phiUsers) {
+
+		if(CodeGen::symbols.removedPHIs.count(userPHI) == 0 && IsPHIComplete(userPHI)) {
+			TryRemoveTrivialPHI(userPHI);
+		}
+	}
+
+	return same;
+}
+
+static llvm::Value* AddPHIOperands(LLVM_Com* lcom, llvm::PHINode* phi) {
+
+	llvm::BasicBlock* bb = phi->getParent();
+
+	for(llvm::BasicBlock* pred : llvm::predecessors(bb)) {
+		phi->addIncoming(CodeGen::ReadCom(lcom, pred), pred);
+	}
+
+	return TryRemoveTrivialPHI(phi);
 }
 
-void CodeGen::SetOriginBlock(std::string name) {
+void CodeGen::WriteCom(LLVM_Com* lcom, llvm::BasicBlock* bb, llvm::Value* v) {
+
+	BlockDef(GetBlockId(bb), lcom->id) = v;
+}
+
+llvm::Value* CodeGen::ReadCom(LLVM_Com* lcom, llvm::BasicBlock* bb) {
+
+	// Single predecessor chains are walked in a loop, every block of
+	// the chain remembers the value found so the walk happens once.
+	llvm::SmallVector<llvm::BasicBlock*, 8> chain;
+
+	llvm::Value* val = nullptr;
+
+	while(true) {
+
+		unsigned blockId = GetBlockId(bb);
+
+		if(llvm::Value* def = BlockDef(blockId, lcom->id)) {
+			val = ResolvePHI(def);
+			break;
+		}
+
+		chain.push_back(bb);
 
-	if(CodeGen::all_coms.find(name) != CodeGen::all_coms.end()) {
-		CodeGen::all_coms[name]->originBlock = CodeGen::Builder->GetInsertBlock();
+		if(!symbols.blocks[blockId].sealed) {
+
+			llvm::PHINode* phi = CreateEmptyPHI(lcom, bb);
+			symbols.blocks[blockId].incompletePHIs.push_back(std::make_pair(lcom->id, phi));
+
+			val = phi;
+			break;
+		}
+
+		if(llvm::BasicBlock* pred = bb->getSinglePredecessor()) {
+			bb = pred;
+			continue;
+		}
+
+		if(llvm::pred_empty(bb)) {
+			val = llvm::Constant::getNullValue(lcom->ty);
+			break;
+		}
+
+		llvm::PHINode* phi = CreateEmptyPHI(lcom, bb);
+
+		// Breaks cycles through loops.
+		WriteCom(lcom, bb, phi);
+
+		val = AddPHIOperands(lcom, phi);
+		break;
 	}
-	else if(CodeGen::all_mems.find(name) != CodeGen::all_mems.end()) {
-		CodeGen::all_mems[name]->originBlock = CodeGen::Builder->GetInsertBlock();
+
+	for(llvm::BasicBlock* b : chain) {
+		WriteCom(lcom, b, val);
 	}
+
+	return val;
+}
+
+void CodeGen::SealBlock(llvm::BasicBlock* bb) {
+
+	unsigned blockId = GetBlockId(bb);
+
+	// Completing a PHI can create new incomplete PHIs in this same block.
+	for(size_t i = 0; i < symbols.blocks[blockId].incompletePHIs.size(); i++) {
+
+		auto incomplete = symbols.blocks[blockId].incompletePHIs[i];
+
+		AddPHIOperands(symbols.coms[incomplete.first].get(), incomplete.second);
+	}
+
+	symbols.blocks[blockId].incompletePHIs.clear();
+	symbols.blocks[blockId].sealed = true;
+}
+
+void CodeGen::SealAllBlocks() {
+
+	Timing::Scope scope("codegen", "PHI finalization");
+
+	// Sealing can number new blocks, so this walks by index.
+	for(size_t i = 0; i < symbols.blocks.size(); i++) {
+
+		if(!symbols.blocks[i].sealed) {
+			SealBlock(symbols.blocks[i].bb);
+		}
+	}
+
+	for(auto const& i : symbols.removedPHIs) {
+		dyn_cast<llvm::PHINode>(i.first)->dropAllReferences();
+	}
+
+	for(auto const& i : symbols.removedPHIs) {
+		dyn_cast<llvm::PHINode>(i.first)->eraseFromParent();
+	}
+
+	symbols.removedPHIs.clear();
+}
+
+llvm::Value* CodeGen::Default(llvm::Value* v) {
+
+	return CodeGen::DefaultFromType(v->getType());
+}
+
+llvm::Constant* CodeGen::DefaultFromType(llvm::Type* t) {
+
+	if(dyn_cast<llvm::IntegerType>(t) != nullptr) {
+
+		auto intType = dyn_cast<llvm::IntegerType>(t);
+
+		return llvm::ConstantInt::get(*CodeGen::TheContext, llvm::APInt(intType->getBitWidth(), 0, true));
+	}
+
+	else if(t->isFloatingPointTy()) {
+		return llvm::ConstantFP::get(t, 0.0);
+	}
+
+	else if(dyn_cast<llvm::ArrayType>(t) != nullptr || dyn_cast<llvm::FixedVectorType>(t) != nullptr || dyn_cast<llvm::StructType>(t) != nullptr) {
+
+		// 'zeroinitializer', whatever the size of the array or record.
+		return llvm::ConstantAggregateZero::get(t);
+	}
+
+	CompilationSession::Out() << "Error: Type not found.\n";
+	CompilationSession::Fail();
+
+	return nullptr;
 }
 
 void CodeGen::EndScope(llvm::BasicBlock* bb) {
 
-	UNORDERED_MAP_FOREACH(std::string, std::unique_ptr<LLVM_Com>, CodeGen::all_coms, it) {
+	for(auto const& lcom : CodeGen::symbols.coms) {
 
-		if(it->second->originBlock == bb) {
-			it->second->isOutOfScope = true;
+		if(lcom->originBlock == bb) {
+			lcom->isOutOfScope = true;
 		}
 	}
 
-	UNORDERED_MAP_FOREACH(std::string, std::unique_ptr<LLVM_Mem>, CodeGen::all_mems, it) {
+	for(auto const& lmem : CodeGen::symbols.mems) {
+
+		if(lmem->originBlock != bb || lmem->isOutOfScope) {
+			continue;
+		}
+
+		lmem->isOutOfScope = true;
 
-		if(it->second->originBlock == bb) {
-			it->second->isOutOfScope = true;
+		if(!lmem->hasLifetime) {
+			continue;
 		}
+
+		// The scope may already be closed by a 'goto' or a return.
+		llvm::BasicBlock* current = CodeGen::Builder->GetInsertBlock();
+		uint64_t size = TheModule->getDataLayout().getTypeAllocSize(lmem->ty);
+
+		llvm::IRBuilder<> EndBuilder(current);
+
+		if(llvm::Instruction* term = current->getTerminator()) {
+			EndBuilder.SetInsertPoint(term);
+		}
+
+		lmem->lifetimeEnds.push_back(EndBuilder.CreateLifetimeEnd(lmem->origin, EndBuilder.getInt64(size)));
 	}
 }
\ No newline at end of file
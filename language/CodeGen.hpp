@@ -7,12 +7,14 @@
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Verifier.h"
@@ -35,6 +37,7 @@
 #include "llvm/Analysis/RegionPass.h"
 #include "llvm/Analysis/RegionPrinter.h"
 #include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/CodeGen/Passes.h"
 
 #include "llvm/Transforms/Utils.h"
@@ -43,64 +46,214 @@
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/AlwaysInliner.h"
 #include "llvm/IR/CFG.h"
+#include "llvm/ADT/DenseMap.h"
 #include <unordered_map>
+#include <optional>
 
 struct LLVM_Com {
 
-	llvm::Value* origin;
-	llvm::Value* current;
+	std::string_view name;
+	unsigned id = 0;
 
-	std::unordered_map<std::string, llvm::Value*> states;
+	llvm::Value* origin;
+	llvm::Type* ty;
 
 	llvm::BasicBlock* originBlock;
 
 	bool isOutOfScope = false;
-
-	std::vector<llvm::BasicBlock*> blockParents;
 };
 
 struct LLVM_Mem {
 
+	std::string_view name;
+	unsigned id = 0;
+
 	llvm::Value* origin;
 	llvm::Value* current;
 
 	llvm::Type* ty;
 
+	// Alignment of the loads and stores through the mem. Unset for the ABI alignment of 'ty'.
+	llvm::MaybeAlign align;
+
+	// Alias scope of a 'restrict' reference, also given to the references taken from it.
+	// nullptr for everything else.
+	llvm::MDNode* aliasScope = nullptr;
+
 	llvm::BasicBlock* originBlock;
 
 	bool isOutOfScope = false;
 
-	std::unordered_map<std::string, llvm::Value*> states;
+	// 'llvm.lifetime.end' calls placed when the scope of the mem ended.
+	// They are dropped if the mem is used after that, or something still points to it.
+	std::vector<llvm::Instruction*> lifetimeEnds;
+	bool hasLifetime = false;
+};
+
+struct LLVM_Block {
+
+	llvm::BasicBlock* bb = nullptr;
+
+	// Definition of every com at the end of the block, indexed by com id.
+	// nullptr when the block doesn't define or hasn't looked up that com yet.
+	std::vector<llvm::Value*> defs;
+
+	// A block is sealed once all of its predecessors are known.
+	bool sealed = false;
+
+	// PHIs created while the block wasn't sealed, completed by 'SealBlock'.
+	std::vector<std::pair<unsigned, llvm::PHINode*>> incompletePHIs;
+};
+
+// Coms and mems of the function being generated. Both are numbered densely in
+// declaration order, and blocks are numbered the first time they are used.
+struct LLVM_Symbols {
+
+	std::vector<std::unique_ptr<LLVM_Com>> coms;
+	std::vector<std::unique_ptr<LLVM_Mem>> mems;
+
+	std::unordered_map<std::string_view, unsigned> comIds;
+	std::unordered_map<std::string_view, unsigned> memIds;
+
+	llvm::DenseMap<llvm::BasicBlock*, unsigned> blockIds;
+	std::vector<LLVM_Block> blocks;
+
+	// Trivial PHIs already replaced, erased by 'SealAllBlocks'.
+	llvm::DenseMap<llvm::Value*, llvm::Value*> removedPHIs;
+
+	// Domain of the alias scopes created in the function, and every load or store
+	// through a 'restrict' mem with its scope. See 'CodeGen::FinishAliasScopes'.
+	llvm::MDNode* aliasDomain = nullptr;
+	std::vector<std::pair<llvm::Instruction*, llvm::MDNode*>> scopedAccesses;
+};
+
+// Set while the body of a 'parfor' is generated into its own function.
+// Coms and mems of the enclosing function used by the body are copied in
+// through the context argument, the first time they are looked up.
+struct LLVM_Captures {
+
+	LLVM_Symbols* outer = nullptr;
+
+	// Captures of the enclosing 'parfor', when they are nested.
+	LLVM_Captures* parent = nullptr;
+
+	llvm::BasicBlock* entry = nullptr;
+
+	// Array of pointers, one per reduction and then one per capture.
+	llvm::Value* ctx = nullptr;
+	unsigned firstCapture = 0;
+
+	std::vector<LLVM_Com*> coms;
+	std::vector<LLVM_Mem*> mems;
+
+	// Order of the captures in 'ctx': true for mems, with an index into 'coms' or 'mems'.
+	std::vector<std::pair<bool, unsigned>> order;
 };
 
 struct CodeGen {
 
 	static bool releaseMode;
 
-	static std::unordered_map<std::string, std::unique_ptr<LLVM_Com>> all_coms;
-	static std::unordered_map<std::string, std::unique_ptr<LLVM_Mem>> all_mems;
+	// '--backend-threads=N': the module is split into partitions, compiled to objects
+	// on N threads (0: one per hardware thread), each with its own context and target machine.
+	static bool splitBackend;
+	static unsigned backendThreads;
+
+	// At most one partition per function, so small modules aren't split for nothing.
+	static const unsigned maxBackendPartitions = 32;
+
+	// Consumes '--backend-threads=N'. Returns false if the argument is not a backend argument.
+	static bool ParseArgument(std::string arg);
+
+	// Set when the module calls into libmascalrt ('parfor'), so the build links it.
+	static thread_local bool usesRuntime;
+
+	// Directory of the compiler, where libmascalrt is built.
+	static std::string runtimeDir;
+
+	static thread_local LLVM_Captures* captures;
+
+	static llvm::FunctionCallee GetParforRuntime();
+
+	// Procedures swap in their own symbols while they are generated.
+	static thread_local LLVM_Symbols symbols;
+
+	static LLVM_Com* FindCom(std::string_view name);
+	static LLVM_Mem* FindMem(std::string_view name);
+
+	// Declaring a name again reuses its id, so it is just a new definition of it.
+	static LLVM_Com* AddCom(std::string_view name, llvm::Value* v);
+	static LLVM_Mem* AddMem(std::string_view name, llvm::Value* v, llvm::Type* ty);
 
-	static std::vector<std::pair<std::string, llvm::PHINode*>> all_phi_nodes;
+	static unsigned GetBlockId(llvm::BasicBlock* bb);
 
-	static std::vector<llvm::BasicBlock*> pureBlocks;
+	// Mem storage always goes in the entry block, so it is allocated once per call
+	// and SROA / mem2reg can promote it. Mems declared inside a nested scope get
+	// lifetime markers instead, so stack coloring can share their slots.
+	static llvm::AllocaInst* CreateEntryAlloca(llvm::Type* ty, std::string_view name);
+	static void StartLifetime(LLVM_Mem* lmem);
 
-	static void AddPHINodeToVec(std::string name, llvm::PHINode* p);
-	static void UpdateAllPHIPreds();
+	// Arrays of 'main' at least this big (in bytes) are placed in a global instead of the stack.
+	static const uint64_t staticMemThreshold = 64 * 1024;
 
-	static int GetParentId(std::string name, llvm::BasicBlock* bb);
+	static llvm::GlobalVariable* CreateStaticMem(llvm::Type* ty, std::string_view name, llvm::Constant* init);
 
-	static void SetOriginBlock(std::string name);
+	// Zero values of arrays are cleared with a memset instead of a giant store.
+	static void StoreInitializer(llvm::Value* ptr, llvm::Value* v);
+
+	static llvm::MDNode* CreateAliasScope(std::string_view name);
+
+	// Records 'I' as a load or store through 'lmem', when it is a 'restrict' mem.
+	static void AddScopedAccess(llvm::Instruction* I, LLVM_Mem* lmem);
+
+	// Once the whole function is generated: every scoped access gets its scope and
+	// is 'noalias' with the scopes of every other 'restrict' mem of the function.
+	static void FinishAliasScopes();
+
+	// Drops the lifetime end of the mem that owns 'origin', if any.
+	static void KeepAlive(llvm::Value* origin);
+	static void KeepAlive(LLVM_Mem* lmem);
+
+	// SSA construction from "Simple and Efficient Construction of Static Single
+	// Assignment Form" (Braun et al.): coms are written and read per block, and
+	// PHIs are only created where a read reaches a join, trivial ones are removed right away.
+	static void WriteCom(LLVM_Com* lcom, llvm::BasicBlock* bb, llvm::Value* v);
+	static llvm::Value* ReadCom(LLVM_Com* lcom, llvm::BasicBlock* bb);
+
+	static void SealBlock(llvm::BasicBlock* bb);
+
+	// Seals whatever is left (blocks targeted by 'goto') and erases the removed PHIs.
+	static void SealAllBlocks();
+
+	static thread_local std::vector<llvm::BasicBlock*> pureBlocks;
 
 	static void EndScope(llvm::BasicBlock* bb);
 
-	static std::unique_ptr<llvm::LLVMContext> TheContext;
-	static std::unique_ptr<llvm::IRBuilder<>> Builder;
-	static std::unique_ptr<llvm::Module> TheModule;
+	// Owned by the 'CompilationSession' being compiled on this thread, swapped in for its duration.
+	static thread_local std::unique_ptr<llvm::LLVMContext> TheContext;
+	static thread_local std::unique_ptr<llvm::IRBuilder<>> Builder;
+	static thread_local std::unique_ptr<llvm::Module> TheModule;
+
+	static thread_local std::unique_ptr<llvm::TargetMachine> TheTargetMachine;
+
+	// Target machine for the host. Sets the triple and data layout of 'M' to match it.
+	static std::unique_ptr<llvm::TargetMachine> InitializeTarget(llvm::Module* M);
+
+	// Drops what is left of the function being generated, once a session ends.
+	static void Reset();
+
+	static void AddGCCMainStub();
+	static void EmitObjectFile(std::string fileName);
+
+	// 'fileName', or with '--backend-threads' one object per partition ('name.0.o', 'name.1.o', ...).
+	// Returns the objects to link, in partition order.
+	static std::vector<std::string> EmitObjectFiles(std::string fileName);
 
-	static void Initialize();
+	// Objects 'EmitObjectFiles' writes for a module split into 'count' partitions.
+	static std::vector<std::string> ObjectFileNames(std::string fileName, size_t count);
 
 	static llvm::Value* Default(llvm::Value* v);
-	static llvm::Constant* DefaultFromType(llvm::Type* t, llvm::Type* arrayElementT = nullptr);
+	static llvm::Constant* DefaultFromType(llvm::Type* t);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "Driver.hpp"
+#include "Parser.hpp"
+#include "Session.hpp"
+#include "Cache.hpp"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Path.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <thread>
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+Driver::Result Driver::CompileFile(const std::string& input, const std::string& outDir, bool build) {
+
+	auto start = std::chrono::steady_clock::now();
+
+	Result result;
+	result.input = input;
+
+	llvm::SmallString<256> basePath(outDir);
+	llvm::sys::path::append(basePath, llvm::sys::path::stem(input));
+
+	std::string base = basePath.str().str();
+
+	// Errors of this file end this file only, and are kept for the summary.
+	std::ostringstream messages;
+
+	CompilationSession::output = &messages;
+	CompilationSession::throwOnError = true;
+
+	try {
+
+		CompilationSession session(Lexer::FromFile(input), input);
+
+		session.llmPath = base + ".llm.mascal";
+		session.objectPath = base + ".o";
+		session.executablePath = base;
+		session.irPath = base + ".ll";
+
+		session.lexer->Start();
+
+		Parser::MainLoop(session, build, false);
+
+		if(!session.cacheKey.empty()) {
+			result.cache = session.cacheHit ? "hit" : "miss";
+		}
+
+		if(build) {
+			result.outputs = session.objects;
+			result.outputs.push_back(session.executablePath);
+		}
+		else {
+			result.outputs = { session.irPath };
+		}
+
+		result.succeeded = true;
+	}
+	catch(const CompileError&) {
+		result.succeeded = false;
+	}
+	// Anything else thrown on a worker thread would terminate the whole batch.
+	catch(const std::exception& e) {
+
+		messages << "Error: " << e.what() << "\n";
+		result.succeeded = false;
+	}
+
+	CompilationSession::output = &std::cout;
+	CompilationSession::throwOnError = false;
+
+	result.messages = messages.str();
+	result.seconds = SecondsSince(start);
+
+	return result;
+}
+
+int Driver::Build(const std::vector<std::string>& inputs, const std::string& outDir, unsigned jobs, bool build) {
+
+	auto start = std::chrono::steady_clock::now();
+
+	// Artifacts are named after the input, two inputs with the same name would overwrite each other.
+	std::map<std::string, std::string> stems;
+
+	for(auto const& i : inputs) {
+
+		auto inserted = stems.emplace(llvm::sys::path::stem(i).str(), i);
+
+		if(!inserted.second) {
+			std::cout << "Error: '" << inserted.first->second << "' and '" << i << "' would both be built to '" << inserted.first->first << "' in '" << outDir << "'.\n";
+			return 1;
+		}
+	}
+
+	if(std::error_code EC = llvm::sys::fs::create_directories(outDir)) {
+		std::cout << "Error: Could not create directory '" << outDir << "': " << EC.message() << "\n";
+		return 1;
+	}
+
+	if(jobs == 0) jobs = 1;
+	if(jobs > inputs.size()) jobs = inputs.size();
+
+	std::vector<Result> results(inputs.size());
+
+	// Files are taken in order by whichever thread is free. Each result has its own slot.
+	std::atomic<size_t> next = 0;
+
+	auto worker = [&]() {
+
+		for(size_t i = next++; i < inputs.size(); i = next++) {
+			results[i] = CompileFile(inputs[i], outDir, build);
+		}
+	};
+
+	std::vector<std::thread> pool;
+
+	for(unsigned j = 1; j < jobs; j++) {
+		pool.emplace_back(worker);
+	}
+
+	worker();
+
+	for(auto& t : pool) {
+		t.join();
+	}
+
+	CompilationCache::Prune();
+
+	PrintSummary(results, build, jobs, SecondsSince(start));
+
+	for(auto const& r : results) {
+
+		if(!r.succeeded) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+void Driver::PrintSummary(const std::vector<Result>& results, bool build, unsigned jobs, double seconds) {
+
+	int64_t failed = 0;
+
+	for(auto const& r : results) {
+		if(!r.succeeded) failed++;
+	}
+
+	llvm::json::OStream J(llvm::outs(), 2);
+
+	J.object([&] {
+
+		J.attribute("command", build ? "build" : "emit");
+		J.attribute("jobs", (int64_t)jobs);
+
+		J.attribute("succeeded", (int64_t)results.size() - failed);
+		J.attribute("failed", failed);
+
+		J.attribute("seconds", seconds);
+		J.attribute("filesPerSecond", seconds > 0 ? results.size() / seconds : 0.0);
+
+		if(!CompilationCache::dir.empty()) {
+
+			J.attributeObject("cache", [&] {
+				J.attribute("hits", (int64_t)CompilationCache::hits);
+				J.attribute("misses", (int64_t)CompilationCache::misses);
+				J.attribute("evictions", (int64_t)CompilationCache::evictions);
+			});
+		}
+
+		J.attributeArray("files", [&] {
+
+			for(auto const& r : results) {
+
+				J.object([&] {
+
+					J.attribute("input", r.input);
+					J.attribute("status", r.succeeded ? "ok" : "error");
+					J.attribute("seconds", r.seconds);
+					J.attribute("cache", r.cache);
+
+					J.attributeArray("outputs", [&] {
+						for(auto const& o : r.outputs) J.value(o);
+					});
+
+					// Error messages quote the source, which isn't always UTF-8.
+					J.attribute("messages", llvm::json::isUTF8(r.messages) ? r.messages : llvm::json::fixUTF8(r.messages));
+				});
+			}
+		});
+	});
+
+	llvm::outs() << "\n";
+	llvm::outs().flush();
+}
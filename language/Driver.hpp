@@ -0,0 +1,36 @@
+#ifndef DRIVER_HPP
+#define DRIVER_HPP
+
+#include <string>
+#include <vector>
+
+// 'mascal build -j N -o outdir a.mascal b.mascal ...'. Every input is compiled in its
+// own session, on a pool of N threads, into '<outdir>/<name>' ('build') or
+// '<outdir>/<name>.ll' ('emit'). Once all are done, a JSON summary is printed.
+struct Driver {
+
+	struct Result {
+
+		std::string input;
+		bool succeeded = false;
+
+		// What the compiler printed for the file: its error, or the steps of the build.
+		std::string messages;
+
+		std::vector<std::string> outputs;
+
+		// "hit" or "miss" with '--cache-dir', "off" otherwise.
+		std::string cache = "off";
+
+		double seconds = 0;
+	};
+
+	static Result CompileFile(const std::string& input, const std::string& outDir, bool build);
+
+	// Returns the exit code of the process, 1 when any input failed.
+	static int Build(const std::vector<std::string>& inputs, const std::string& outDir, unsigned jobs, bool build);
+
+	static void PrintSummary(const std::vector<Result>& results, bool build, unsigned jobs, double seconds);
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "JIT.hpp"
+#include "Session.hpp"
+#include "../runtime/MascalRT.hpp"
+#include <iostream>
+
+// 'main' uses the GHC calling convention, which can't be called from C++,
+// so the JIT enters the program through a C calling convention wrapper.
+static const char* JITEntryName = "__mascal_jit_main";
+
+void MascalJIT::ExitOnError(llvm::Error Err) {
+
+	if(Err) {
+		CompilationSession::Out() << "JIT Error: " << llvm::toString(std::move(Err)) << "\n";
+		CompilationSession::Fail();
+	}
+}
+
+void MascalJIT::AddEntryWrapper(llvm::Module* M) {
+
+	llvm::Function* MainF = M->getFunction("main");
+
+	if(MainF == nullptr) {
+		CompilationSession::Out() << "JIT Error: 'main' not found, there's no program to run.\n";
+		CompilationSession::Fail();
+	}
+
+	llvm::LLVMContext& Ctx = M->getContext();
+
+	llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getInt32Ty(Ctx), false);
+	llvm::Function* F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, JITEntryName, M);
+
+	llvm::IRBuilder<> EntryBuilder(llvm::BasicBlock::Create(Ctx, "entry", F));
+
+	llvm::CallInst* Call = EntryBuilder.CreateCall(MainF, {});
+	Call->setCallingConv(MainF->getCallingConv());
+
+	llvm::Value* Result = Call;
+
+	if(MainF->getReturnType() != FT->getReturnType()) {
+		Result = EntryBuilder.CreateIntCast(Call, FT->getReturnType(), true);
+	}
+
+	EntryBuilder.CreateRet(Result);
+}
+
+int MascalJIT::Run() {
+
+	auto JTMB = llvm::orc::JITTargetMachineBuilder::detectHost();
+
+	if(!JTMB) {
+		ExitOnError(JTMB.takeError());
+	}
+
+	auto J = llvm::orc::LLLazyJITBuilder().setJITTargetMachineBuilder(std::move(*JTMB)).create();
+
+	if(!J) {
+		ExitOnError(J.takeError());
+	}
+
+	// Let the program resolve symbols of the compiler process (memset, memcpy, ...).
+	auto ProcessSymbols = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess((*J)->getDataLayout().getGlobalPrefix());
+
+	if(!ProcessSymbols) {
+		ExitOnError(ProcessSymbols.takeError());
+	}
+
+	(*J)->getMainJITDylib().addGenerator(std::move(*ProcessSymbols));
+
+	// The compiler links libmascalrt in, 'parfor' loops use that copy.
+	llvm::orc::SymbolMap RuntimeSymbols;
+
+	RuntimeSymbols[(*J)->mangleAndIntern("__mascal_parfor")] = llvm::orc::ExecutorSymbolDef(
+		llvm::orc::ExecutorAddr::fromPtr(&__mascal_parfor), llvm::JITSymbolFlags::Exported);
+
+	ExitOnError((*J)->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(RuntimeSymbols))));
+
+	CodeGen::TheModule->setDataLayout((*J)->getDataLayout());
+
+	AddEntryWrapper(CodeGen::TheModule.get());
+
+	CodeGen::Builder.reset();
+
+	llvm::orc::ThreadSafeModule TSM(std::move(CodeGen::TheModule), std::move(CodeGen::TheContext));
+
+	ExitOnError((*J)->addLazyIRModule(std::move(TSM)));
+
+	auto EntrySym = (*J)->lookup(JITEntryName);
+
+	if(!EntrySym) {
+		ExitOnError(EntrySym.takeError());
+	}
+
+	auto Entry = EntrySym->toPtr<int(*)()>();
+
+	return Entry();
+}
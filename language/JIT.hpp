@@ -0,0 +1,21 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include "CodeGen.hpp"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+
+struct MascalJIT {
+
+	// Moves 'CodeGen::TheModule' and 'CodeGen::TheContext' into an LLLazyJIT,
+	// calls 'main' in-process and returns its exit code.
+	// Functions are compiled lazily, the first time they are called.
+	static int Run();
+
+	static void AddEntryWrapper(llvm::Module* M);
+
+	static void ExitOnError(llvm::Error Err);
+};
+
+#endif
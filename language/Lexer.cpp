@@ -1,18 +1,67 @@
 #include "Lexer.hpp"
+#include "Session.hpp"
+#include <algorithm>
+#include <cstring>
 
-std::string Lexer::Content;
-std::string Lexer::NumValString;
-std::string Lexer::StringString;
-std::string Lexer::IdentifierStr;
+std::unique_ptr<Lexer> Lexer::FromFile(std::string path) {
 
-int Lexer::Line;
-int Lexer::Column;
-int Lexer::LastChar;
-int Lexer::Position;
-int Lexer::CurrentToken;
+	// No null terminator is needed (the lexer checks the size), which lets
+	// LLVM mmap the file instead of copying it.
+	auto bufferOrErr = llvm::MemoryBuffer::getFile(path, /*IsText=*/false, /*RequiresNullTerminator=*/false);
 
-std::string Lexer::line_as_string;
+	if(!bufferOrErr) {
+		CompilationSession::Out() << "Error: Can't open '" << path << "': " << bufferOrErr.getError().message() << "\n";
+		CompilationSession::Fail();
+	}
 
-std::vector<std::string> Lexer::all_lines_vector;
+	return std::make_unique<Lexer>(std::move(bufferOrErr.get()));
+}
 
-LexerIsInside Lexer::isInside;
+void Lexer::BuildLineOffsets() {
+
+	lineOffsets.push_back(0);
+
+	const char* begin = Content.data();
+	const char* end = begin + Content.size();
+
+	for(const char* c = begin; c < end; c++) {
+
+		c = (const char*)memchr(c, '\n', end - c);
+
+		if(c == nullptr) break;
+
+		lineOffsets.push_back((c - begin) + 1);
+	}
+}
+
+int Lexer::GetLine(int64_t offset) {
+
+	if(lineOffsets.empty()) BuildLineOffsets();
+
+	auto it = std::upper_bound(lineOffsets.begin(), lineOffsets.end(), offset);
+
+	return it - lineOffsets.begin();
+}
+
+int Lexer::GetColumn(int64_t offset) {
+
+	int line = GetLine(offset);
+
+	return (offset - lineOffsets[line - 1]) + 1;
+}
+
+std::string_view Lexer::GetLineText(int line) {
+
+	if(lineOffsets.empty()) BuildLineOffsets();
+
+	if(line < 1 || line > (int)lineOffsets.size()) return "";
+
+	int64_t start = lineOffsets[line - 1];
+	int64_t end = line < (int)lineOffsets.size() ? lineOffsets[line] - 1 : Content.size();
+
+	std::string_view text = Content.substr(start, end - start);
+
+	if(!text.empty() && text.back() == '\r') text.remove_suffix(1);
+
+	return text;
+}
@@ -2,8 +2,13 @@
 #define LEXER_HPP
 
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <vector>
+#include <memory>
+#include "llvm/Support/MemoryBuffer.h"
+#include "PerfectHash.hpp"
+#include "Timing.hpp"
 //#include "ErrorHandler.hpp"
 
 enum Token
@@ -58,8 +63,122 @@ enum Token
 	SEL = -32,
 
 	As = -33,
+
+	Splat = -34,
+	Extract = -35,
+	Insert = -36,
+	VLoad = -37,
+	VStore = -38,
+
+	Parfor = -39,
+	In = -40,
+	Reduce = -41,
+	Into = -42,
+
+	For = -43,
+	Step = -44,
+
+	Mul = -45,
+	UMul = -46,
+	Div = -47,
+	UDiv = -48,
+	Rem = -49,
+	URem = -50,
+	Shl = -51,
+	Shr = -52,
+	UShr = -53,
+
+	Record = -54,
+	GEF = -55,
+
+	Restrict = -56,
+	NTStore = -57,
+	Prefetch = -58,
 };
 
+// Keyword spellings. 'Lexer::GetIdentifier' finds them with a single probe
+// into a perfect hash built at compile time.
+constexpr PerfectHash::Entry MascalKeywords[] = {
+	{ "program", Token::Program },
+	{ "begin", Token::Begin },
+	{ "end", Token::End },
+
+	{ "com", Token::Com },
+
+	{ "llreturn", Token::LLReturn },
+
+	{ "add", Token::Add },
+	{ "sub", Token::Sub },
+
+	{ "and", Token::And },
+	{ "or", Token::Or },
+	{ "xor", Token::Xor },
+
+	{ "COMPARE", Token::Compare },
+
+	{ "if", Token::If },
+	{ "then", Token::Then },
+	{ "else", Token::Else },
+
+	{ "return", Token::Return },
+
+	{ "proc", Token::Procedure },
+
+	{ "comstore", Token::ComStore },
+
+	{ "mem", Token::Mem },
+	{ "loadmem", Token::LoadMem },
+	{ "memstore", Token::MemStore },
+
+	{ "intcast", Token::IntCast },
+	{ "to", Token::To },
+
+	{ "while", Token::While },
+	{ "do", Token::Do },
+
+	{ "block", Token::Block },
+	{ "goto", Token::Goto },
+
+	{ "GEL", Token::GEL },
+	{ "SEL", Token::SEL },
+
+	{ "as", Token::As },
+
+	{ "SPLAT", Token::Splat },
+	{ "EXTRACT", Token::Extract },
+	{ "INSERT", Token::Insert },
+	{ "VLOAD", Token::VLoad },
+	{ "VSTORE", Token::VStore },
+
+	{ "parfor", Token::Parfor },
+	{ "in", Token::In },
+	{ "reduce", Token::Reduce },
+	{ "into", Token::Into },
+
+	{ "for", Token::For },
+	{ "step", Token::Step },
+
+	{ "mul", Token::Mul },
+	{ "umul", Token::UMul },
+	{ "div", Token::Div },
+	{ "udiv", Token::UDiv },
+	{ "rem", Token::Rem },
+	{ "urem", Token::URem },
+	{ "shl", Token::Shl },
+	{ "shr", Token::Shr },
+	{ "ushr", Token::UShr },
+
+	{ "record", Token::Record },
+	{ "GEF", Token::GEF },
+
+	{ "restrict", Token::Restrict },
+	{ "NTSTORE", Token::NTStore },
+	{ "PREFETCH", Token::Prefetch }
+};
+
+constexpr PerfectHash::Table<256> MascalKeywordTable(MascalKeywords);
+static_assert(MascalKeywordTable.found, "No perfect hash seed found for the Mascal keywords.");
+
 enum LexerIsInside {
 	AProgram,
 	AProcedure
@@ -67,69 +186,102 @@ enum LexerIsInside {
 
 struct Lexer
 {
-	static std::string Content;
+	// Owns the source when it was loaded with 'FromFile'. Large files are mmapped.
+	std::unique_ptr<llvm::MemoryBuffer> Buffer;
 
-	static std::string IdentifierStr;
-	static std::string NumValString;
-	static std::string StringString;
+	std::string_view Content;
 
-	static void AddContent(std::string c)
-	{
-		Content += c;
-	}
+	// Token text. These are slices of 'Content', unless the token had to be
+	// rewritten (escapes, '_' separators, chars), in which case they point into
+	// the scratch strings below and stay valid until the next token of that kind.
+	std::string_view IdentifierStr;
+	std::string_view NumValString;
+	std::string_view StringString;
+
+	std::string NumScratch;
+	std::string StringScratch;
+
+	int CurrentToken = 0;
+	int64_t Position = -1;
 
-	static int CurrentToken;
-	static int Position;
+	// Offset of the first character of the current token.
+	int64_t TokenStart = 0;
 
-	static int Line;
-	static int Column;
+	int LastChar = ' ';
 
-	static std::string line_as_string;
+	LexerIsInside isInside = LexerIsInside::AProgram;
 
-	static std::vector<std::string> all_lines_vector;
+	// Set while parsing with timing on. Each token is added to the open parse scope.
+	bool isTimed = false;
 
-	static LexerIsInside isInside;
+	Lexer(std::string_view content) : Content(content) {}
 
-	static void Start()
+	Lexer(std::unique_ptr<llvm::MemoryBuffer> buffer) : Buffer(std::move(buffer)) {
+
+		Content = std::string_view(Buffer->getBufferStart(), Buffer->getBufferSize());
+	}
+
+	static std::unique_ptr<Lexer> FromFile(std::string path);
+
+	void Start()
 	{
 		Position = -1;
-		Line = 1;
-		Column = 1;
+		TokenStart = 0;
 		LastChar = ' ';
+		CurrentToken = 0;
 	}
 
-	static int Advance()
+	int Advance()
 	{
 		Position += 1;
 
-		Column += 1;
-
-		line_as_string += Content[Position];
-
-		if (Content[Position] == '\n')
+		if (Position >= (int64_t)Content.size())
 		{
-			Line += 1;
-			Column = 1;
+			Position = Content.size();
+			return EOF;
+		}
 
-			all_lines_vector.push_back(line_as_string);
+		return (unsigned char)Content[Position];
+	}
 
-			line_as_string.clear();
-		}
+	// Character after the current one, without consuming it.
+	int Peek()
+	{
+		if (Position + 1 >= (int64_t)Content.size()) return EOF;
 
-		return Content[Position];
+		return (unsigned char)Content[Position + 1];
 	}
 
-	static void GetNextToken()
+	// Line and column (both starting at 1) of an offset in 'Content'.
+	// The line-offset index is only built the first time this is called.
+	int GetLine(int64_t offset);
+	int GetColumn(int64_t offset);
+	std::string_view GetLineText(int line);
+
+	int GetLine() { return GetLine(TokenStart); }
+	int GetColumn() { return GetColumn(TokenStart); }
+
+	void GetNextToken()
 	{
+		if (!isTimed)
+		{
+			CurrentToken = GetToken();
+			return;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
 		CurrentToken = GetToken();
-	}
 
-	static int LastChar;
+		Timing::Add("lex", "Lex", std::chrono::steady_clock::now() - start);
+	}
 
-	static int GetToken()
+	int GetToken()
 	{
 		while (isspace(LastChar)) LastChar = Advance();
 
+		TokenStart = Position;
+
 		if (isalpha(LastChar) || LastChar == '@') return GetIdentifier();
 
 		if (isdigit(LastChar)) return GetNumber();
@@ -165,31 +317,25 @@ struct Lexer
 		return ThisChar;
 	}
 
-	static bool IsIdentifier(std::string s)
+	bool IsIdentifier(std::string_view s)
 	{
 		return IdentifierStr == s;
 	}
 
-	static bool is_still_identifier(char c)
+	static bool is_still_identifier(int c)
 	{
 		return isalnum(c) || c == '_';
 	}
 
-	//static void throw_identifier_syntax_warning(std::string message, std::string recommendation)
-	//{
-	//	ErrorHandler::print(message, Lexer::Line, Lexer::Column, Lexer::line_as_string, 1, recommendation);
-	//}
-
-	static int GetChar()
+	int GetChar()
 	{
 		LastChar = Advance();
 
-		NumValString = "";
-
 		if(LastChar == '\\')
 			StringSlash();
 
-		NumValString += std::to_string(LastChar);
+		NumScratch = std::to_string(LastChar);
+		NumValString = NumScratch;
 
 		LastChar = Advance();
 
@@ -198,26 +344,46 @@ struct Lexer
 		return Token::Number;
 	}
 
-	static int GetString()
+	int GetString()
 	{
-		StringString = "";
 		LastChar = Advance();
 
-		do
-		{
-			if(LastChar == '\\')
-				StringSlash();
+		int64_t start = Position;
+		bool needsScratch = false;
 
-			StringString += LastChar;
+		// Strings without escapes are returned as a slice of the source.
+		while(LastChar != '\"' && LastChar != EOF && LastChar >= 32)
+		{
+			if(LastChar == '\\') { needsScratch = true; break; }
 			LastChar = Advance();
-		} while(LastChar != '\"' && LastChar != Token::EndOfFile && LastChar >= 32);
+		}
+
+		if(needsScratch)
+		{
+			StringScratch.assign(Content.substr(start, Position - start));
+
+			while(LastChar != '\"' && LastChar != EOF && LastChar >= 32)
+			{
+				if(LastChar == '\\')
+					StringSlash();
+
+				StringScratch += (char)LastChar;
+				LastChar = Advance();
+			}
+
+			StringString = StringScratch;
+		}
+		else
+		{
+			StringString = Content.substr(start, Position - start);
+		}
 
 		if(LastChar == '\"') { LastChar = Advance(); }
 
 		return Token::String;
 	}
 
-	static void StringSlash()
+	void StringSlash()
 	{
 		LastChar = Advance();
 
@@ -229,76 +395,48 @@ struct Lexer
 		else if(LastChar == '\\') LastChar = '\\';
 	}
 
-	static int GetIdentifier()
+	int GetIdentifier()
 	{
-		IdentifierStr = LastChar;
-
-		while (is_still_identifier((LastChar = Advance())))
-		{
-			IdentifierStr += LastChar;
-		}
+		int64_t start = Position;
 
-		if (IsIdentifier("program")) return Token::Program;
-		else if(IsIdentifier("begin")) return Token::Begin;
-		else if(IsIdentifier("end")) return Token::End;
+		while (is_still_identifier((LastChar = Advance()))) {}
 
-		else if(IsIdentifier("com")) return Token::Com;
+		IdentifierStr = Content.substr(start, Position - start);
 
-		else if(IsIdentifier("llreturn")) return Token::LLReturn;
-
-		else if(IsIdentifier("add")) return Token::Add;
-		else if(IsIdentifier("sub")) return Token::Sub;
-
-		else if(IsIdentifier("and")) return Token::And;
-		else if(IsIdentifier("or")) return Token::Or;
-		else if(IsIdentifier("xor")) return Token::Xor;
-
-		else if(IsIdentifier("COMPARE")) return Token::Compare;
-
-		else if(IsIdentifier("if")) return Token::If;
-		else if(IsIdentifier("then")) return Token::Then;
-		else if(IsIdentifier("else")) return Token::Else;
-
-		else if(IsIdentifier("return")) return Token::Return;
-
-		else if(IsIdentifier("proc")) return Token::Procedure;
-
-		else if(IsIdentifier("comstore")) return Token::ComStore;
-
-		else if(IsIdentifier("mem")) return Token::Mem;
-		else if(IsIdentifier("loadmem")) return Token::LoadMem;
-		else if(IsIdentifier("memstore")) return Token::MemStore;
-
-		else if(IsIdentifier("intcast")) return Token::IntCast;
-		else if(IsIdentifier("to")) return Token::To;
-
-		else if(IsIdentifier("while")) return Token::While;
-		else if(IsIdentifier("do")) return Token::Do;
-
-		else if(IsIdentifier("block")) return Token::Block;
-		else if(IsIdentifier("goto")) return Token::Goto;
-
-		else if(IsIdentifier("GEL")) return Token::GEL;
-		else if(IsIdentifier("SEL")) return Token::SEL;
-
-		else if(IsIdentifier("as")) return Token::As;
-
-		return Token::Identifier;
+		return MascalKeywordTable.Lookup(IdentifierStr, Token::Identifier);
 	}
 
-	static int GetNumber()
+	int GetNumber()
 	{
-		std::string NumStr;
+		int64_t start = Position;
+		bool hasSeparators = false;
 
 		do
 		{
-			if(LastChar != '_') NumStr += LastChar;
+			if(LastChar == '_') hasSeparators = true;
 			LastChar = Advance();
-		} while (isdigit(LastChar) || LastChar == '.' || LastChar == 'f' || LastChar == '_');
+		} while (isdigit(LastChar) || (LastChar == '.' && Peek() != '.') || LastChar == 'f' || LastChar == '_');
+
+		NumValString = Content.substr(start, Position - start);
+
+		// '1_000_000' is the only case where the number isn't a slice of the source.
+		if(hasSeparators)
+		{
+			NumScratch.clear();
+
+			for(char c : NumValString)
+				if(c != '_') NumScratch += c;
+
+			NumValString = NumScratch;
+		}
 
-		NumValString = NumStr;
 		return Token::Number;
 	}
+
+private:
+	std::vector<int64_t> lineOffsets;
+
+	void BuildLineOffsets();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "Optimizer.hpp"
+#include "Session.hpp"
+#include "Timing.hpp"
+#include "llvm/IR/PassInstrumentation.h"
+#include "llvm/Support/raw_os_ostream.h"
+#include <iostream>
+
+OptimizerLevel Optimizer::level = OptimizerLevel::OptUnset;
+std::string Optimizer::customPasses;
+
+bool Optimizer::ParseArgument(std::string arg) {
+
+	if(arg == "-O0") { level = OptimizerLevel::OptO0; return true; }
+	else if(arg == "-O1") { level = OptimizerLevel::OptO1; return true; }
+	else if(arg == "-O2") { level = OptimizerLevel::OptO2; return true; }
+	else if(arg == "-O3") { level = OptimizerLevel::OptO3; return true; }
+	else if(arg == "-Os") { level = OptimizerLevel::OptOs; return true; }
+
+	std::string passesArg = "--passes=";
+
+	if(arg.rfind(passesArg, 0) == 0) {
+
+		customPasses = arg.substr(passesArg.size());
+		return true;
+	}
+
+	return false;
+}
+
+OptimizerLevel Optimizer::GetLevel() {
+
+	if(level != OptimizerLevel::OptUnset) {
+		return level;
+	}
+
+	return CodeGen::releaseMode ? OptimizerLevel::OptO3 : OptimizerLevel::OptO0;
+}
+
+std::string Optimizer::LevelToString(OptimizerLevel l) {
+
+	if(l == OptimizerLevel::OptO1) { return "O1"; }
+	else if(l == OptimizerLevel::OptO2) { return "O2"; }
+	else if(l == OptimizerLevel::OptO3) { return "O3"; }
+	else if(l == OptimizerLevel::OptOs) { return "Os"; }
+
+	return "O0";
+}
+
+static llvm::OptimizationLevel ToLLVMLevel(OptimizerLevel l) {
+
+	if(l == OptimizerLevel::OptO1) { return llvm::OptimizationLevel::O1; }
+	else if(l == OptimizerLevel::OptO2) { return llvm::OptimizationLevel::O2; }
+	else if(l == OptimizerLevel::OptO3) { return llvm::OptimizationLevel::O3; }
+	else if(l == OptimizerLevel::OptOs) { return llvm::OptimizationLevel::Os; }
+
+	return llvm::OptimizationLevel::O0;
+}
+
+// The function, loop or module a pass runs on, for the trace.
+static std::string IRUnitName(llvm::Any IR) {
+
+	if(auto F = llvm::any_cast<const llvm::Function*>(&IR)) return (*F)->getName().str();
+	if(auto L = llvm::any_cast<const llvm::Loop*>(&IR)) return (*L)->getHeader()->getParent()->getName().str() + " " + (*L)->getName().str();
+	if(auto M = llvm::any_cast<const llvm::Module*>(&IR)) return (*M)->getModuleIdentifier();
+
+	return "";
+}
+
+// Every pass and analysis the pipeline runs is a scope of its own. Inlining is the
+// inliner passes, 'AlwaysInlinerPass' at -O0.
+static void AddTimingCallbacks(llvm::PassInstrumentationCallbacks& PIC) {
+
+	PIC.registerBeforeNonSkippedPassCallback([](llvm::StringRef pass, llvm::Any IR) {
+		Timing::Begin("pass", pass, IRUnitName(IR));
+	});
+
+	PIC.registerAfterPassCallback([](llvm::StringRef, llvm::Any, const llvm::PreservedAnalyses&) {
+		Timing::End();
+	});
+
+	PIC.registerAfterPassInvalidatedCallback([](llvm::StringRef, const llvm::PreservedAnalyses&) {
+		Timing::End();
+	});
+
+	PIC.registerBeforeAnalysisCallback([](llvm::StringRef analysis, llvm::Any IR) {
+		Timing::Begin("analysis", analysis, IRUnitName(IR));
+	});
+
+	PIC.registerAfterAnalysisCallback([](llvm::StringRef, llvm::Any) {
+		Timing::End();
+	});
+}
+
+void Optimizer::Run(llvm::Module* M, llvm::TargetMachine* TM) {
+
+	llvm::raw_os_ostream verifierOut(CompilationSession::Out());
+
+	{
+		Timing::Scope verify("optimize", "Verify");
+
+		if(llvm::verifyModule(*M, &verifierOut)) {
+			verifierOut.flush();
+
+			CompilationSession::Out() << "Error: Generated module is not valid, the optimizer can't run.\n";
+			CompilationSession::Fail();
+		}
+	}
+
+	OptimizerLevel finalLevel = GetLevel();
+
+	llvm::LoopAnalysisManager LAM;
+	llvm::FunctionAnalysisManager FAM;
+	llvm::CGSCCAnalysisManager CGAM;
+	llvm::ModuleAnalysisManager MAM;
+
+	llvm::PipelineTuningOptions PTO;
+	PTO.LoopVectorization = finalLevel == OptimizerLevel::OptO2 || finalLevel == OptimizerLevel::OptO3;
+	PTO.SLPVectorization = finalLevel == OptimizerLevel::OptO2 || finalLevel == OptimizerLevel::OptO3;
+	PTO.LoopUnrolling = finalLevel != OptimizerLevel::OptOs;
+
+	llvm::PassInstrumentationCallbacks PIC;
+
+	if(Timing::enabled) {
+		AddTimingCallbacks(PIC);
+	}
+
+	llvm::PassBuilder PB(TM, PTO, std::nullopt, &PIC);
+
+	PB.registerModuleAnalyses(MAM);
+	PB.registerCGSCCAnalyses(CGAM);
+	PB.registerFunctionAnalyses(FAM);
+	PB.registerLoopAnalyses(LAM);
+	PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+	llvm::ModulePassManager MPM;
+
+	if(!customPasses.empty()) {
+
+		if(auto Err = PB.parsePassPipeline(MPM, customPasses)) {
+			CompilationSession::Out() << "Error: Invalid pass pipeline '" << customPasses << "': " << llvm::toString(std::move(Err)) << "\n";
+			CompilationSession::Fail();
+		}
+	}
+	else if(finalLevel == OptimizerLevel::OptO0) {
+		// Still needed at O0 to honor '[Inline]' procedures.
+		MPM = PB.buildO0DefaultPipeline(llvm::OptimizationLevel::O0);
+
+		// Mems are stack slots. Promote the ones whose address never escapes
+		// (scalars and small arrays) so loops don't load and store them every iteration.
+		MPM.addPass(llvm::createModuleToFunctionPassAdaptor(llvm::SROAPass(llvm::SROAOptions::PreserveCFG)));
+	}
+	else {
+		MPM = PB.buildPerModuleDefaultPipeline(ToLLVMLevel(finalLevel));
+	}
+
+	Timing::Scope optimize("optimize", "Optimize", Optimizer::LevelToString(finalLevel));
+
+	MPM.run(*M, MAM);
+}
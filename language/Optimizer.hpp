@@ -0,0 +1,42 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "CodeGen.hpp"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/OptimizationLevel.h"
+#include "llvm/Analysis/CGSCCPassManager.h"
+#include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Transforms/Scalar/SROA.h"
+#include <string>
+
+enum OptimizerLevel {
+	OptUnset = -1,
+	OptO0,
+	OptO1,
+	OptO2,
+	OptO3,
+	OptOs
+};
+
+struct Optimizer {
+
+	static OptimizerLevel level;
+
+	// Textual pipeline ('--passes=...'). When set, it replaces the default pipeline
+	// of the selected level, the same way 'opt -passes=' does.
+	static std::string customPasses;
+
+	// Consumes '-O0', '-O1', '-O2', '-O3', '-Os' and '--passes=...'.
+	// Returns false if the argument is not an optimizer argument.
+	static bool ParseArgument(std::string arg);
+
+	static OptimizerLevel GetLevel();
+
+	static std::string LevelToString(OptimizerLevel l);
+
+	// Runs between 'MainProgram->codegen()' and emission.
+	static void Run(llvm::Module* M, llvm::TargetMachine* TM = nullptr);
+};
+
+#endif
\ No newline at end of file
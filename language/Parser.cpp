@@ -1,19 +1,23 @@
 #include "Parser.hpp"
 
-std::string Parser::main_target;
-bool Parser::can_main_target_be_modified;
+thread_local Lexer* Parser::lexer = nullptr;
 
-std::unordered_map<std::string, AST::Type*> Parser::all_parser_coms;
-std::unordered_map<std::string, std::unique_ptr<Parser_Mem>> Parser::all_parser_mems;
+thread_local std::string Parser::main_target;
+thread_local bool Parser::can_main_target_be_modified;
 
-std::vector<std::unique_ptr<AST::Procedure>> Parser::all_procedures;
+thread_local std::unordered_map<std::string_view, AST::Type*> Parser::all_parser_coms;
+thread_local std::unordered_map<std::string_view, std::unique_ptr<Parser_Mem>> Parser::all_parser_mems;
 
-std::string Parser::current_procedure_name;
+thread_local std::vector<AST::Procedure*> Parser::all_procedures;
 
-AST::Attributes Parser::currentAttributes;
+thread_local std::string Parser::current_procedure_name;
 
-std::unique_ptr<AST::Expression> Parser::lastCompareOne;
-std::unique_ptr<AST::Expression> Parser::lastCompareTwo;
-int Parser::lastCmpType;
+thread_local AST::Attributes Parser::currentAttributes;
 
-std::vector<std::string> Parser::allBlockNames;
\ No newline at end of file
+thread_local AST::Expression* Parser::lastCompareOne = nullptr;
+thread_local AST::Expression* Parser::lastCompareTwo = nullptr;
+thread_local int Parser::lastCmpType;
+
+thread_local std::vector<std::string> Parser::allBlockNames;
+
+thread_local int Parser::parforDepth = 0;
\ No newline at end of file
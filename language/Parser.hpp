@@ -6,7 +6,11 @@
 #include <cstdlib>
 #include "Lexer.hpp"
 #include "AST.hpp"
-#include "../utils/DeleteGCCMainCall.hpp"
+#include "Optimizer.hpp"
+#include "JIT.hpp"
+#include "Session.hpp"
+#include "Cache.hpp"
+#include "Timing.hpp"
 
 struct Parser_Mem {
 
@@ -17,32 +21,39 @@ struct Parser_Mem {
 	std::string loadVariableName = "";
 };
 
+// The state of the parse is per thread, and belongs to the session being compiled on it.
 struct Parser {
 
-	static std::string main_target;
-	static bool can_main_target_be_modified;
+	// Lexer of the session being parsed. Set by 'MainLoop'.
+	static thread_local Lexer* lexer;
 
-	static std::string current_procedure_name;
+	static thread_local std::string main_target;
+	static thread_local bool can_main_target_be_modified;
 
-	static std::vector<std::unique_ptr<AST::Procedure>> all_procedures;
+	static thread_local std::string current_procedure_name;
 
-	static std::unordered_map<std::string, AST::Type*> all_parser_coms;
-	static std::unordered_map<std::string, std::unique_ptr<Parser_Mem>> all_parser_mems;
+	static thread_local std::vector<AST::Procedure*> all_procedures;
 
-	static AST::Attributes currentAttributes;
+	static thread_local std::unordered_map<std::string_view, AST::Type*> all_parser_coms;
+	static thread_local std::unordered_map<std::string_view, std::unique_ptr<Parser_Mem>> all_parser_mems;
 
-	static std::unique_ptr<AST::Expression> lastCompareOne;
-	static std::unique_ptr<AST::Expression> lastCompareTwo;
-	static int lastCmpType;
+	static thread_local AST::Attributes currentAttributes;
 
-	static std::vector<std::string> allBlockNames;
+	static thread_local AST::Expression* lastCompareOne;
+	static thread_local AST::Expression* lastCompareTwo;
+	static thread_local int lastCmpType;
 
-	static void AddParserCom(std::string name, AST::Type* t) {
+	static thread_local std::vector<std::string> allBlockNames;
 
-		all_parser_coms[name] = t;
+	// How many 'parfor' bodies are being parsed.
+	static thread_local int parforDepth;
+
+	static void AddParserCom(std::string_view name, AST::Type* t) {
+
+		all_parser_coms[Arena::Intern(name)] = t;
 	}
 
-	static void AddParserMem(std::string name, AST::Type* t) {
+	static void AddParserMem(std::string_view name, AST::Type* t) {
 
 		auto pMem = std::make_unique<Parser_Mem>();
 
@@ -52,10 +63,10 @@ struct Parser {
 		pMem->loadCount = 0;
 		pMem->loadVariableName = "";
 
-		all_parser_mems[name] = std::move(pMem);
+		all_parser_mems[Arena::Intern(name)] = std::move(pMem);
 	}
 
-	static AST::Type* FindType(std::string name) {
+	static AST::Type* FindType(std::string_view name) {
 
 		if(all_parser_coms.find(name) != all_parser_coms.end()) {
 			return all_parser_coms[name];
@@ -81,7 +92,7 @@ struct Parser {
 						//std::cout << "Checking " << args->name << "...\n";
 						if(args->name == name) {
 
-							return i->all_argument_types[Idx].get();
+							return i->all_argument_types[Idx];
 						}
 
 						Idx++;
@@ -90,7 +101,7 @@ struct Parser {
 			}
 		}
 
-		ExprError("Variable type of '" + name + "' not found.");
+		ExprError("Variable type of '" + std::string(name) + "' not found.");
 		return nullptr;
 	}
 
@@ -115,55 +126,74 @@ struct Parser {
 	}
 
 	static void ExprError(std::string str) {
-		std::cout << "Parser Error: " << str << "\n";
-		exit(1);
+		CompilationSession::Out() << "Parser Error: " << str << "\n";
+		CompilationSession::Fail();
 	}
 
-	static std::unique_ptr<AST::Procedure> CloneProcedure(std::string name) {
+	// Number tokens hold digits, '.' and 'f' in any order, so they can still be malformed or too big.
+	template<typename T>
+	static T ToInteger(std::string_view numStr) {
 
-		for(auto const& i: all_procedures) {
+		T n = 0;
 
-			if(i->procName == name) {
-				return i->Clone();
-			}
+		if(llvm::StringRef(numStr.data(), numStr.size()).getAsInteger(10, n)) {
+			ExprError("'" + std::string(numStr) + "' is not a valid integer or is too big.");
 		}
 
-		ExprError("Procedure '" + name + "' not found.");
-		return nullptr;
+		return n;
+	}
+
+	static double ToDouble(std::string_view numStr) {
+
+		double d = 0;
+
+		if(llvm::StringRef(numStr.data(), numStr.size()).getAsDouble(d)) {
+			ExprError("'" + std::string(numStr) + "' is not a valid number.");
+		}
+
+		return d;
 	}
 
-	static void AddCallCountToProcedure(std::string name) {
+	static AST::Procedure* FindProcedure(std::string name) {
 
 		for(auto const& i: all_procedures) {
 
 			if(i->procName == name) {
-				i->call_count += 1;
-				return;
+				return i;
 			}
 		}
 
 		ExprError("Procedure '" + name + "' not found.");
+		return nullptr;
 	}
 
-	static std::unique_ptr<AST::Expression> ParseCall(std::string name) {
+	static AST::Expression* ParseCall(std::string name) {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::vector<std::unique_ptr<AST::Expression>> call_arguments;
+		AST::Procedure* proc = FindProcedure(name);
 
-		AddCallCountToProcedure(name);
+		std::vector<bool> isMemArgument;
+
+		for(size_t i = 0; i < proc->all_arguments.size(); i++) {
+			isMemArgument.push_back(proc->IsMemArgument(i));
+		}
 
-		std::unique_ptr<AST::Procedure> proc_copy = CloneProcedure(name);
-		CLONE_EXPR_VECTOR(proc_copy->body, body_clone);
+		std::vector<AST::Expression*> call_arguments;
 
-		while(Lexer::CurrentToken != ')') {
+		while(lexer->CurrentToken != ')') {
 
 			auto I = ParseIdentifier();
 
-			call_arguments.push_back(std::move(I));
+			// 'mem' arguments take the mem itself, everything else takes its value.
+			if(call_arguments.size() < isMemArgument.size() && !isMemArgument[call_arguments.size()]) {
+				I = MemTreatment(I);
+			}
+
+			call_arguments.push_back(I);
 
-			if(Lexer::CurrentToken != ',') {
-				if(Lexer::CurrentToken != ')') {
+			if(lexer->CurrentToken != ',') {
+				if(lexer->CurrentToken != ')') {
 					ExprError("Expected ',' to split arguments or ')' to end call.");
 				}
 				else {
@@ -171,350 +201,445 @@ struct Parser {
 				}
 			}
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 		}
 
-		if(Lexer::CurrentToken == ')') {
-			Lexer::GetNextToken();
+		if(lexer->CurrentToken == ')') {
+			lexer->GetNextToken();
 		}
 
-		bool isVoid = dynamic_cast<AST::Void*>(proc_copy->proc_type.get()) != nullptr;
-
-		if(!isVoid) {
-
-			for(auto const& i: body_clone) {
-
-				if(i->ContainsName(name + "_return")) {
-					i->ReplaceTargetNameTo(name + "_return", name + "_return" + std::to_string(proc_copy->call_count));
-				}
-			}
+		if(call_arguments.size() != isMemArgument.size()) {
+			ExprError("Procedure '" + name + "' expects " + std::to_string(isMemArgument.size()) + " arguments, found " + std::to_string(call_arguments.size()) + ".");
 		}
 
-		for(auto const& i: body_clone) {
+		return Arena::New<AST::ProcedureCall>(name, isMemArgument, std::move(call_arguments));
+	}
 
-			int Idx = 0;
-			for(auto const& p: proc_copy->all_arguments) {
+	static AST::Expression* ParseIdentifier() {
 
-				if(i->ContainsName(p->name)) {
+		std::string idName(lexer->IdentifierStr);
 
-					i->ReplaceTargetNameTo(p->name, call_arguments[Idx]->name);
-				}
+		lexer->GetNextToken();
 
-				Idx++;
-			}
+		if(lexer->CurrentToken == '(') {
+			return ParseCall(idName);
 		}
 
-		std::unique_ptr<AST::Expression> returnObj;
-
-		if(!isVoid) {
-			returnObj = std::make_unique<AST::Variable>(name + "_return" + std::to_string(proc_copy->call_count));
-		}
-		else {
-			returnObj = std::make_unique<AST::RetVoid>();
-		}
+		SetMainTarget(idName);
 
-		return std::make_unique<AST::ProcedureCall>(std::move(body_clone), std::move(returnObj));
+		return Arena::New<AST::Variable>(idName);
 	}
 
-	static std::unique_ptr<AST::Expression> ParseIdentifier() {
+	static AST::Expression* ParseNumber() {
 
-		std::string idName = Lexer::IdentifierStr;
+		std::string numStr(lexer->NumValString);
 
-		Lexer::GetNextToken();
+		// '1.5' is an 'f64', '1.5f' an 'f32'. Whole numbers become floats when the main target is one (or a 'Ref' to one).
+		bool isFloatLiteral = numStr.find_first_of(".f") != std::string::npos;
 
-		if(Lexer::CurrentToken == '(') {
-			return ParseCall(idName);
+		bool isF32Literal = numStr.back() == 'f';
+
+		if(isF32Literal) {
+			numStr.pop_back();
 		}
 
-		SetMainTarget(idName);
+		lexer->GetNextToken();
 
-		return std::make_unique<AST::Variable>(idName);
-	}
+		AST::Type* targetTy = Parser::main_target == "" ? nullptr : FindType(Parser::main_target);
+
+		bool isFloatTarget = targetTy != nullptr && (AST::IsFloatType(targetTy) || AST::IsFloatType(targetTy->childTy));
+
+		if(isFloatLiteral || isFloatTarget) {
 
-	static std::unique_ptr<AST::Expression> ParseNumber() {
+			AST::Type* floatTy = isF32Literal ? AST::GetType<AST::Float32>() : AST::GetType<AST::Float64>();
 
-		int64_t n = std::stoi(Lexer::NumValString);
+			// Like whole numbers, float literals take the type of the main target.
+			// An integer one is reported by 'AST::FloatNumber::codegen'.
+			if(targetTy != nullptr) {
+				floatTy = targetTy;
+			}
+
+			return Arena::New<AST::FloatNumber>(ToDouble(numStr), floatTy);
+		}
 
-		Lexer::GetNextToken();
+		int64_t n = ToInteger<int64_t>(numStr);
 
 		if(Parser::main_target == "") {
-			return std::make_unique<AST::IntNumber>(n, std::make_unique<AST::Integer32>());
+			return Arena::New<AST::IntNumber>(n, AST::GetType<AST::Integer32>());
 		}
 
-		return std::make_unique<AST::IntNumber>(n, FindType(Parser::main_target)->Clone());
+		return Arena::New<AST::IntNumber>(n, FindType(Parser::main_target));
 	}
 
-	static std::unique_ptr<AST::Type> IdentStrToType() {
+	static AST::Type* IdentStrToType() {
+
+		std::string curr_ident(lexer->IdentifierStr);
 
-		std::string curr_ident = Lexer::IdentifierStr;
+		if(curr_ident == "i128") { return AST::GetType<AST::Integer128>(); }
+		else if(curr_ident == "i64") { return AST::GetType<AST::Integer64>(); }
+		else if(curr_ident == "i32") { return AST::GetType<AST::Integer32>(); }
+		else if(curr_ident == "i16") { return AST::GetType<AST::Integer16>(); }
+		else if(curr_ident == "i8") { return AST::GetType<AST::Integer8>(); }
+		else if(curr_ident == "i1" || curr_ident == "bool") { return AST::GetType<AST::Integer1>(); }
 
-		if(curr_ident == "i128") { return std::make_unique<AST::Integer128>(); }
-		else if(curr_ident == "i64") { return std::make_unique<AST::Integer64>(); }
-		else if(curr_ident == "i32") { return std::make_unique<AST::Integer32>(); }
-		else if(curr_ident == "i16") { return std::make_unique<AST::Integer16>(); }
-		else if(curr_ident == "i8") { return std::make_unique<AST::Integer8>(); }
-		else if(curr_ident == "i1" || curr_ident == "bool") { return std::make_unique<AST::Integer1>(); }
+		else if(curr_ident == "f64") { return AST::GetType<AST::Float64>(); }
+		else if(curr_ident == "f32") { return AST::GetType<AST::Float32>(); }
 
-		else if(curr_ident == "void") { return std::make_unique<AST::Void>(); }
+		else if(curr_ident == "void") { return AST::GetType<AST::Void>(); }
 
-		else if(curr_ident == "Array" || Lexer::CurrentToken == '[') {
+		else if(curr_ident == "Array" || lexer->CurrentToken == '[') {
 
-			bool square_brackets = Lexer::CurrentToken == '[';
+			bool square_brackets = lexer->CurrentToken == '[';
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 
 			if(!square_brackets) {
 
-				if(Lexer::CurrentToken != '<') {
+				if(lexer->CurrentToken != '<') {
 					ExprError("Expected '<' to add array type.");
 				}
 
-				Lexer::GetNextToken();
+				lexer->GetNextToken();
 			}
 
 			auto T = IdentStrToType();
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 
 			uint64_t numElements = 0;
 
-			if(Lexer::CurrentToken == ',') {
-				Lexer::GetNextToken();
+			if(lexer->CurrentToken == ',') {
+				lexer->GetNextToken();
 
-				if(Lexer::CurrentToken != Token::Number) {
+				if(lexer->CurrentToken != Token::Number) {
 					ExprError("Expected number to set amount of elements in array.");
 				}
 
-				numElements = std::stoi(Lexer::NumValString);
+				numElements = ToInteger<uint64_t>(lexer->NumValString);
 
-				Lexer::GetNextToken();
+				lexer->GetNextToken();
 			}
 
 			if(!square_brackets) {
-				if(Lexer::CurrentToken != '>') {
+				if(lexer->CurrentToken != '>') {
 					ExprError("Expected '>' to close array.");
 				}
 			}
 			else {
-				if(Lexer::CurrentToken != ']') {
+				if(lexer->CurrentToken != ']') {
 					ExprError("Expected ']' to close array.");
 				}
 			}
 
-			return std::make_unique<AST::Array>(std::move(T), numElements);
+			return AST::GetArrayType(T, numElements);
+		}
+
+		else if(curr_ident == "Vector" || curr_ident == "vec") {
+
+			lexer->GetNextToken();
+
+			if(lexer->CurrentToken != '<') {
+				ExprError("Expected '<' to add vector type.");
+			}
+
+			lexer->GetNextToken();
+
+			auto T = IdentStrToType();
+
+			if(T->childTy != nullptr || dynamic_cast<AST::Void*>(T) != nullptr || dynamic_cast<AST::Record*>(T) != nullptr) {
+				ExprError("Vector lanes must be numbers.");
+			}
+
+			lexer->GetNextToken();
+
+			if(lexer->CurrentToken != ',') {
+				ExprError("Expected ',' to set amount of lanes in vector.");
+			}
+
+			lexer->GetNextToken();
+
+			if(lexer->CurrentToken != Token::Number) {
+				ExprError("Expected number to set amount of lanes in vector.");
+			}
+
+			uint64_t numLanes = ToInteger<uint64_t>(lexer->NumValString);
+
+			lexer->GetNextToken();
+
+			if(lexer->CurrentToken != '>') {
+				ExprError("Expected '>' to close vector.");
+			}
+
+			return AST::GetVectorType(T, numLanes);
 		}
 
 		else if(curr_ident == "Ref") {
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 
-			if(Lexer::CurrentToken != '<') {
+			if(lexer->CurrentToken != '<') {
 				ExprError("Expected '<' to add reference type.");
 			}
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 
 			auto T = IdentStrToType();
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 
-			if(Lexer::CurrentToken != '>') {
+			if(lexer->CurrentToken != '>') {
 				ExprError("Expected '>' to close array.");
 			}
 
-			return std::make_unique<AST::Ref>(std::move(T));
+			return AST::GetRefType(T);
+		}
+
+		else if(lexer->CurrentToken == '&') {
+
+			lexer->GetNextToken();
+
+			auto T = IdentStrToType();
+
+			return AST::GetRefType(T);
 		}
 
-		else if(Lexer::CurrentToken == '&') {
+		else if(lexer->CurrentToken == Token::Restrict) {
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 
 			auto T = IdentStrToType();
 
-			return std::make_unique<AST::Ref>(std::move(T));
+			if(dynamic_cast<AST::Ref*>(T) == nullptr) {
+				ExprError("'restrict' only applies to references.");
+			}
+
+			return AST::GetRefType(T->childTy, true);
+		}
+
+		else if(lexer->CurrentToken == Token::Identifier && AST::FindRecordType(curr_ident) != nullptr) {
+			return AST::FindRecordType(curr_ident);
 		}
 
 		ExprError("Unknown type '" + curr_ident + "' found.");
 		return nullptr;
 	}
 
-	static std::unique_ptr<AST::Expression> ParseCom() {
+	static AST::Expression* ParseCom() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::string idName = Lexer::IdentifierStr;
+		std::string idName(lexer->IdentifierStr);
 
 		SetMainTarget(idName);
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		if(Lexer::CurrentToken != ':') { ExprError("Expected ':'."); }
+		if(lexer->CurrentToken != ':') { ExprError("Expected ':'."); }
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::unique_ptr<AST::Type> ty = IdentStrToType();
+		AST::Type* ty = IdentStrToType();
 
-		AddParserCom(idName, ty.get());
+		AddParserCom(idName, ty);
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::unique_ptr<AST::Expression> expr;
+		AST::Expression* expr;
 
-		if(Lexer::CurrentToken == '=') {
+		if(lexer->CurrentToken == '=') {
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 
 			expr = ParseExpression();
 
-			return std::make_unique<AST::Com>(idName, std::move(ty), std::move(expr));
+			return Arena::New<AST::Com>(idName, ty, expr);
 		}
 
-		return std::make_unique<AST::Com>(idName, std::move(ty), nullptr);
+		return Arena::New<AST::Com>(idName, ty, nullptr);
 	}
 
-	static std::unique_ptr<AST::Expression> ParseMem() {
+	static AST::Expression* ParseMem() {
+
+		lexer->GetNextToken();
 
-		Lexer::GetNextToken();
+		AST::Attributes attrs;
+
+		if(lexer->CurrentToken == '[') {
+			attrs = ParseAttributes();
+		}
 
-		std::string idName = Lexer::IdentifierStr;
+		std::string idName(lexer->IdentifierStr);
 
 		SetMainTarget(idName);
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != ':') { ExprError("Expected ':'."); }
 
-		if(Lexer::CurrentToken != ':') { ExprError("Expected ':'."); }
+		lexer->GetNextToken();
 
-		Lexer::GetNextToken();
+		AST::Type* ty = IdentStrToType();
 
-		std::unique_ptr<AST::Type> ty = IdentStrToType();
+		if(attrs.isSoA) {
 
-		AddParserMem(idName, ty.get());
+			AST::Array* arrayTy = dynamic_cast<AST::Array*>(ty);
 
-		Lexer::GetNextToken();
+			if(arrayTy == nullptr || dynamic_cast<AST::Record*>(arrayTy->childTy) == nullptr || arrayTy->elements == 0) {
+				ExprError("'SoA' mem '" + idName + "' must be an array of records with a number of elements.");
+			}
+
+			ty = AST::GetSoAType(arrayTy->childTy, arrayTy->elements);
+		}
+
+		AddParserMem(idName, ty);
 
-		std::unique_ptr<AST::Expression> expr;
+		lexer->GetNextToken();
 
-		if(Lexer::CurrentToken == '=') {
+		AST::Expression* expr;
 
-			Lexer::GetNextToken();
+		if(lexer->CurrentToken == '=') {
+
+			lexer->GetNextToken();
 
 			expr = ParseExpression();
 
-			return std::make_unique<AST::Mem>(idName, std::move(ty), std::move(expr));
+			return Arena::New<AST::Mem>(idName, ty, expr, attrs);
 		}
 
-		return std::make_unique<AST::Mem>(idName, std::move(ty), nullptr);
+		return Arena::New<AST::Mem>(idName, ty, nullptr, attrs);
 	}
 
-	static std::unique_ptr<AST::Expression> ParseLLReturn() {
+	static AST::Expression* ParseLLReturn() {
+
+		if(parforDepth > 0) { ExprError("Can't return from inside of a 'parfor' loop."); }
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::unique_ptr<AST::Expression> expr = ParseExpression();
+		AST::Expression* expr = ParseExpression();
 
-		return std::make_unique<AST::LLReturn>(MemTreatment(std::move(expr)));
+		return Arena::New<AST::LLReturn>(MemTreatment(expr));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseReturn() {
+	static AST::Expression* ParseReturn() {
 
-		if(Lexer::isInside == LexerIsInside::AProgram) {
+		if(lexer->isInside == LexerIsInside::AProgram) {
 			return ParseLLReturn();
 		}
 
-		Lexer::GetNextToken();
+		if(parforDepth > 0) { ExprError("Can't return from inside of a 'parfor' loop."); }
+
+		lexer->GetNextToken();
 
 		ResetMainTarget();
 
 		SetMainTarget(Parser::current_procedure_name + "_return");
 
-		std::unique_ptr<AST::Expression> expr = ParseExpression();
+		AST::Expression* expr = ParseExpression();
+
+		return Arena::New<AST::ComStore>(Arena::New<AST::Variable>(Parser::current_procedure_name + "_return"), expr);
+	}
+
+	static AST::Expression* ParseAdd() {
+
+		lexer->GetNextToken();
+
+		ResetMainTarget();
+
+		AST::Expression* target = ParseExpression();
+
+		if(lexer->CurrentToken != ',') { ExprError("Expected ','."); }
+
+		lexer->GetNextToken();
 
-		return std::make_unique<AST::ComStore>(std::make_unique<AST::Variable>(Parser::current_procedure_name + "_return"), std::move(expr));
+		AST::Expression* value = ParseExpression();
+
+		return Arena::New<AST::Add>(UnverifyMem(target), MemTreatment(value));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseAdd() {
+	static AST::Expression* ParseSub() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
 		ResetMainTarget();
 
-		std::unique_ptr<AST::Expression> target = ParseExpression();
+		AST::Expression* target = ParseExpression();
 
-		if(Lexer::CurrentToken != ',') { ExprError("Expected ','."); }
+		if(lexer->CurrentToken != ',') { ExprError("Expected ','."); }
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::unique_ptr<AST::Expression> value = ParseExpression();
+		AST::Expression* value = ParseExpression();
 
-		return std::make_unique<AST::Add>(UnverifyMem(std::move(target)), MemTreatment(std::move(value)));
+		return Arena::New<AST::Sub>(UnverifyMem(target), MemTreatment(value));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseSub() {
+	static AST::Expression* ParseAnd() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
 		ResetMainTarget();
 
-		std::unique_ptr<AST::Expression> target = ParseExpression();
+		AST::Expression* target = ParseExpression();
 
-		if(Lexer::CurrentToken != ',') { ExprError("Expected ','."); }
+		if(lexer->CurrentToken != ',') { ExprError("Expected ','."); }
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::unique_ptr<AST::Expression> value = ParseExpression();
+		AST::Expression* value = ParseExpression();
 
-		return std::make_unique<AST::Sub>(UnverifyMem(std::move(target)), MemTreatment(std::move(value)));
+		return Arena::New<AST::And>(UnverifyMem(target), MemTreatment(value));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseAnd() {
+	static AST::Expression* ParseOr() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
 		ResetMainTarget();
 
-		std::unique_ptr<AST::Expression> target = ParseExpression();
+		AST::Expression* target = ParseExpression();
 
-		if(Lexer::CurrentToken != ',') { ExprError("Expected ','."); }
+		if(lexer->CurrentToken != ',') { ExprError("Expected ','."); }
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::unique_ptr<AST::Expression> value = ParseExpression();
+		AST::Expression* value = ParseExpression();
 
-		return std::make_unique<AST::And>(UnverifyMem(std::move(target)), MemTreatment(std::move(value)));
+		return Arena::New<AST::Or>(UnverifyMem(target), MemTreatment(value));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseOr() {
+	static AST::Expression* ParseXor() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
 		ResetMainTarget();
 
-		std::unique_ptr<AST::Expression> target = ParseExpression();
+		AST::Expression* target = ParseExpression();
 
-		if(Lexer::CurrentToken != ',') { ExprError("Expected ','."); }
+		if(lexer->CurrentToken != ',') { ExprError("Expected ','."); }
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::unique_ptr<AST::Expression> value = ParseExpression();
+		AST::Expression* value = ParseExpression();
 
-		return std::make_unique<AST::Or>(UnverifyMem(std::move(target)), MemTreatment(std::move(value)));
+		return Arena::New<AST::Xor>(UnverifyMem(target), MemTreatment(value));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseXor() {
+	// 'mul', 'div', 'rem', 'shl', 'shr' and their unsigned forms.
+	static AST::Expression* ParseArithmetic(int arith_type) {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
 		ResetMainTarget();
 
-		std::unique_ptr<AST::Expression> target = ParseExpression();
+		AST::Expression* target = ParseExpression();
 
-		if(Lexer::CurrentToken != ',') { ExprError("Expected ','."); }
+		if(lexer->CurrentToken != ',') { ExprError("Expected ','."); }
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::unique_ptr<AST::Expression> value = ParseExpression();
+		AST::Expression* value = ParseExpression();
 
-		return std::make_unique<AST::Xor>(UnverifyMem(std::move(target)), MemTreatment(std::move(value)));
+		return Arena::New<AST::Arithmetic>(UnverifyMem(target), MemTreatment(value), arith_type);
 	}
 
 	static int TextToCompareType(std::string t) {
@@ -534,46 +659,50 @@ struct Parser {
 		else if(t == "IsNotEquals") { return AST::CompareType::IsNotEquals; }
 		else if(t == "IsLessThanOrEquals") { return AST::CompareType::IsLessThanOrEquals; }
 		else if(t == "IsMoreThanOrEquals") { return AST::CompareType::IsMoreThanOrEquals; }
+		else if(t == "IsBelow") { return AST::CompareType::IsBelow; }
+		else if(t == "IsAbove") { return AST::CompareType::IsAbove; }
+		else if(t == "IsBelowOrEquals") { return AST::CompareType::IsBelowOrEquals; }
+		else if(t == "IsAboveOrEquals") { return AST::CompareType::IsAboveOrEquals; }
 
 		ExprError("Uknown compare type '" + t + "'");
 		return 0;
 	}
 
-	static std::unique_ptr<AST::Expression> ParseCompare() {
+	static AST::Expression* ParseCompare() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		if(Lexer::CurrentToken != '.') {
+		if(lexer->CurrentToken != '.') {
 			ExprError("Expected '.'");
 		}
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::string compareType = Lexer::IdentifierStr;
+		std::string compareType(lexer->IdentifierStr);
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		if(Lexer::CurrentToken != '(') {
+		if(lexer->CurrentToken != '(') {
 			ExprError("Expected '(' to add arguments.");
 		}
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
 		auto CompareOne = ParseExpression();
 
-		if(Lexer::CurrentToken != ',') {
+		if(lexer->CurrentToken != ',') {
 			ExprError("Expected ',' to split arguments.");
 		}
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
 		auto CompareTwo = ParseExpression();
 
-		if(Lexer::CurrentToken != ')') {
+		if(lexer->CurrentToken != ')') {
 			ExprError("Expected ')' to close arguments.");
 		}
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
 		int finalCompare = TextToCompareType(compareType);
 
@@ -581,65 +710,73 @@ struct Parser {
 		lastCompareTwo = CompareTwo->Clone();
 		lastCmpType = finalCompare;
 
-		return std::make_unique<AST::Compare>(MemTreatment(std::move(CompareOne)), MemTreatment(std::move(CompareTwo)), finalCompare);
+		return Arena::New<AST::Compare>(MemTreatment(CompareOne), MemTreatment(CompareTwo), finalCompare);
 	}
 
-	static std::unique_ptr<AST::Expression> ParseIf(bool check_comma = true) {
+	static AST::Expression* ParseIf(bool check_comma = true) {
+
+		lexer->GetNextToken();
+
+		AST::Attributes attrs;
+
+		if(lexer->CurrentToken == '[') {
+			attrs = ParseAttributes();
+		}
 
-		Lexer::GetNextToken();
+		if(attrs.isLikely && attrs.isCold) { ExprError("An if can't be both 'Likely' and 'Cold'."); }
 
 		auto condition = ParseExpression();
 
-		if(Lexer::CurrentToken != Token::Then) {
+		if(lexer->CurrentToken != Token::Then) {
 			ExprError("Expected 'then' in if block.");
 		}
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::vector<std::unique_ptr<AST::Expression>> if_body;
-		std::vector<std::unique_ptr<AST::Expression>> else_body;
+		std::vector<AST::Expression*> if_body;
+		std::vector<AST::Expression*> else_body;
 
 		MemVerifyAll();
 
-		while(Lexer::CurrentToken != Token::End && Lexer::CurrentToken != Token::Else) {
+		while(lexer->CurrentToken != Token::End && lexer->CurrentToken != Token::Else) {
 
 			ResetMainTarget();
 
-			std::unique_ptr<AST::Expression> e = ParseExpression();
+			AST::Expression* e = ParseExpression();
 
-			if(Lexer::CurrentToken != ';') { ExprError("Expected ';' to end instruction inside if block."); }
+			if(lexer->CurrentToken != ';') { ExprError("Expected ';' to end instruction inside if block."); }
 
-			if_body.push_back(std::move(e));
+			if_body.push_back(e);
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 		}
 
 		MemVerifyAll();
 
-		if(Lexer::CurrentToken == Token::Else) {
+		if(lexer->CurrentToken == Token::Else) {
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 
-			if(Lexer::CurrentToken == Token::If) {
-				std::unique_ptr<AST::Expression> if_b = ParseIf(false);
+			if(lexer->CurrentToken == Token::If) {
+				AST::Expression* if_b = ParseIf(false);
 
-				else_body.push_back(std::move(if_b));
+				else_body.push_back(if_b);
 			}
-			else if(Lexer::CurrentToken == Token::Then) {
+			else if(lexer->CurrentToken == Token::Then) {
 
-				Lexer::GetNextToken();
+				lexer->GetNextToken();
 
-				while(Lexer::CurrentToken != Token::End) {
+				while(lexer->CurrentToken != Token::End) {
 
 					ResetMainTarget();
 
-					std::unique_ptr<AST::Expression> e = ParseExpression();
+					AST::Expression* e = ParseExpression();
 
-					if(Lexer::CurrentToken != ';') { ExprError("Expected ';' to end instruction inside else block."); }
+					if(lexer->CurrentToken != ';') { ExprError("Expected ';' to end instruction inside else block."); }
 		
-					else_body.push_back(std::move(e));
+					else_body.push_back(e);
 		
-					Lexer::GetNextToken();
+					lexer->GetNextToken();
 				}
 			}
 			else {
@@ -648,585 +785,1344 @@ struct Parser {
 		}
 
 		if(check_comma)
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 
-		return std::make_unique<AST::If>(std::move(condition), std::move(if_body), std::move(else_body));
+		return Arena::New<AST::If>(condition, std::move(if_body), std::move(else_body), attrs);
 	}
 
-	static std::unique_ptr<AST::Expression> ParseComStore() {
+	static AST::Expression* ParseComStore() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
 		ResetMainTarget();
 
-		std::unique_ptr<AST::Expression> target = ParseExpression();
+		AST::Expression* target = ParseExpression();
 
-		if(Lexer::CurrentToken != ',') { ExprError("Expected ','."); }
+		if(lexer->CurrentToken != ',') { ExprError("Expected ','."); }
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::unique_ptr<AST::Expression> value = ParseExpression();
+		AST::Expression* value = ParseExpression();
 
-		value = MemTreatment(std::move(value));
+		value = MemTreatment(value);
 
-		return std::make_unique<AST::ComStore>(std::move(target), std::move(value));
+		return Arena::New<AST::ComStore>(target, value);
 	}
 
-	static std::unique_ptr<AST::Expression> ParseMemStore() {
+	static AST::Expression* ParseMemStore() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
 		ResetMainTarget();
 
-		std::unique_ptr<AST::Expression> target = ParseExpression();
+		AST::Expression* target = ParseExpression();
 
-		if(Lexer::CurrentToken != ',') { ExprError("Expected ','."); }
+		if(lexer->CurrentToken != ',') { ExprError("Expected ','."); }
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::unique_ptr<AST::Expression> value = ParseExpression();
+		AST::Expression* value = ParseExpression();
 
-		return std::make_unique<AST::MemStore>(Mem_Verify(std::move(target)), MemTreatment(std::move(value)));
+		return Arena::New<AST::MemStore>(Mem_Verify(target), MemTreatment(value));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseLoadMem() {
+	static AST::Expression* ParseLoadMem() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::unique_ptr<AST::Expression> expr = ParseExpression();
+		AST::Expression* expr = ParseExpression();
 
-		return std::make_unique<AST::LoadMem>(std::move(expr));
+		return Arena::New<AST::LoadMem>(expr);
 	}
 
-	static std::unique_ptr<AST::Expression> ParseIntCast() {
+	static AST::Expression* ParseIntCast() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
 		ResetMainTarget();
 
 		auto Expr = ParseExpression();
 
-		if(Lexer::CurrentToken != Token::To) {
+		if(lexer->CurrentToken != Token::To) {
 			ExprError("Expected 'to'.");
 		}
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
 		auto ty = IdentStrToType();
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		return std::make_unique<AST::IntCast>(MemTreatment(std::move(Expr)), std::move(ty));
+		return Arena::New<AST::IntCast>(MemTreatment(Expr), ty);
 	}
 
-	static std::unique_ptr<AST::Expression> ParseWhile() {
+	static AST::Expression* ParseWhile() {
+
+		lexer->GetNextToken();
+
+		AST::Attributes attrs;
 
-		Lexer::GetNextToken();
+		if(lexer->CurrentToken == '[') {
+			attrs = ParseAttributes();
+		}
 
 		auto Cond = ParseExpression();
 
-		auto cOneOrigin = std::move(lastCompareOne);
-		auto cTwoOrigin = std::move(lastCompareTwo);
+		auto cOneOrigin = lastCompareOne;
+		auto cTwoOrigin = lastCompareTwo;
 
 		int cmpTypeOrigin = lastCmpType;
 		lastCmpType = 0;
 
-		if(Lexer::CurrentToken != Token::Do) {
+		if(lexer->CurrentToken != Token::Do) {
 			ExprError("Expected 'do' keyword.");
 		}
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::vector<std::unique_ptr<AST::Expression>> loop_body;
+		std::vector<AST::Expression*> loop_body;
 
-		std::vector<std::string> verifyMemAtEnd;
+		std::vector<std::string_view> verifyMemAtEnd;
 
 		MemVerifyAll();
 
-		while(Lexer::CurrentToken != Token::End) {
+		while(lexer->CurrentToken != Token::End) {
 
-			std::unique_ptr<AST::Expression> e = ParseExpression();
+			AST::Expression* e = ParseExpression();
 
-			if(dynamic_cast<AST::MemStore*>(e.get()) != nullptr) {
+			if(dynamic_cast<AST::MemStore*>(e) != nullptr) {
 
-				AST::MemStore* ms = dynamic_cast<AST::MemStore*>(e.get());
+				AST::MemStore* ms = dynamic_cast<AST::MemStore*>(e);
 
 				verifyMemAtEnd.push_back(ms->target->name);
 			}
 
-			if(Lexer::CurrentToken != ';') { ExprError("Expected ';' to end instruction inside while loop."); }
+			if(lexer->CurrentToken != ';') { ExprError("Expected ';' to end instruction inside while loop."); }
 
-			loop_body.push_back(std::move(e));
+			loop_body.push_back(e);
 
 			ResetMainTarget();
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 		}
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		auto RepeatCond = std::make_unique<AST::Compare>(MemTreatment(std::move(cOneOrigin)), MemTreatment(std::move(cTwoOrigin)), cmpTypeOrigin);
+		auto RepeatCond = Arena::New<AST::Compare>(MemTreatment(cOneOrigin), MemTreatment(cTwoOrigin), cmpTypeOrigin);
 
-		UNORDERED_MAP_FOREACH(std::string, std::unique_ptr<Parser_Mem>, all_parser_mems, it) {
+		UNORDERED_MAP_FOREACH(std::string_view, std::unique_ptr<Parser_Mem>, all_parser_mems, it) {
 
 			it->second->loadVariableName.clear();
 
 			it->second->is_verified = true;
 		}
 
-		return std::make_unique<AST::While>(std::move(Cond), std::move(RepeatCond), std::move(loop_body));
+		return Arena::New<AST::While>(Cond, RepeatCond, std::move(loop_body), attrs);
 	}
 
-	static std::unique_ptr<AST::Expression> ParseBlock() {
+	// for i: type = start to end [step constant] do ... end
+	static AST::Expression* ParseFor() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		if(Lexer::CurrentToken != Token::Identifier) {
-			ExprError("Expected identifier for new block.");
-		}
+		AST::Attributes attrs;
 
-		std::string name = Lexer::IdentifierStr;
+		if(lexer->CurrentToken == '[') {
+			attrs = ParseAttributes();
+		}
 
-		Parser::allBlockNames.push_back(name);
+		if(lexer->CurrentToken != Token::Identifier) {
+			ExprError("Expected identifier for 'for' loop variable.");
+		}
 
-		Lexer::GetNextToken();
+		std::string name(lexer->IdentifierStr);
 
-		if(Lexer::CurrentToken != Token::Begin) {
-			ExprError("Expected 'begin' for new block.");
-		}
+		lexer->GetNextToken();
 
-		Lexer::GetNextToken();
+		if(lexer->CurrentToken != ':') { ExprError("Expected ':'."); }
 
-		std::vector<std::unique_ptr<AST::Expression>> all_instructions;
+		lexer->GetNextToken();
 
-		while (Lexer::CurrentToken != Token::End) { 
+		AST::Type* ty = IdentStrToType();
 
-			std::unique_ptr<AST::Expression> e = ParseExpression();
+		lexer->GetNextToken();
 
-			if(Lexer::CurrentToken != ';') { ExprError("Expected ';' to end instruction inside '" + name + "' block."); }
+		if(lexer->CurrentToken != '=') { ExprError("Expected '='."); }
 
-			all_instructions.push_back(std::move(e));
+		lexer->GetNextToken();
 
-			ResetMainTarget();
+		AddParserCom(name, ty);
 
-			Lexer::GetNextToken();
-		}
+		ResetMainTarget();
+		SetMainTarget(name);
 
-		Lexer::GetNextToken();
+		auto Start = MemTreatment(ParseExpression());
 
-		return std::make_unique<AST::Block>(name, std::move(all_instructions));
-	}
+		if(lexer->CurrentToken != Token::To) {
+			ExprError("Expected 'to' keyword.");
+		}
 
-	static std::unique_ptr<AST::Expression> ParseGoto() {
+		lexer->GetNextToken();
 
-		Lexer::GetNextToken();
+		auto End = MemTreatment(ParseExpression());
 
-		if(Lexer::CurrentToken != Token::Identifier) {
-			ExprError("Expected block name.");
-		}
+		AST::Expression* Step = nullptr;
 
-		std::string blockName = Lexer::IdentifierStr;
+		if(lexer->CurrentToken == Token::Step) {
 
-		bool blockNameExists = false;
-		for(auto i : Parser::allBlockNames) {
+			lexer->GetNextToken();
 
-			if(i == blockName) {
-				blockNameExists = true;
-				break;
-			}
-		}
+			// Counting down needs a negative step, which expressions can't spell.
+			if(lexer->CurrentToken == '-') {
 
-		Lexer::GetNextToken();
+				lexer->GetNextToken();
 
-		return std::make_unique<AST::Goto>(blockName);
-	}
+				if(lexer->CurrentToken != Token::Number) { ExprError("Expected a number after '-'."); }
 
-	static std::unique_ptr<AST::Expression> ParseGEL() {
+				AST::IntNumber* N = (AST::IntNumber*)ParseNumber();
+				N->num = -N->num;
 
-		Lexer::GetNextToken();
+				Step = N;
+			}
+			else {
+				Step = MemTreatment(ParseExpression());
+			}
+		}
 
-		if(Lexer::CurrentToken != '(') {
-			ExprError("Expected '('.");
+		if(lexer->CurrentToken != Token::Do) {
+			ExprError("Expected 'do' keyword.");
 		}
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		auto I = ParseIdentifier();
+		std::vector<AST::Expression*> loop_body;
 
-		if(Lexer::CurrentToken != ',') {
-			ExprError("Expected ','.");
-		}
+		MemVerifyAll();
 
-		Lexer::GetNextToken();
+		while(lexer->CurrentToken != Token::End) {
 
-		auto E = ParseExpression();
+			AST::Expression* e = ParseExpression();
 
-		if(Lexer::CurrentToken != ')') {
-			ExprError("Expected ')'.");
-		}
+			if(lexer->CurrentToken != ';') { ExprError("Expected ';' to end instruction inside for loop."); }
 
-		Lexer::GetNextToken();
+			loop_body.push_back(e);
 
-		if(Lexer::CurrentToken != Token::As) {
-			ExprError("Expected 'as'.");
-		}
+			ResetMainTarget();
 
-		Lexer::GetNextToken();
+			lexer->GetNextToken();
+		}
 
-		auto T = IdentStrToType();
+		lexer->GetNextToken();
 
-		Lexer::GetNextToken();
+		MemVerifyAll();
 
-		return std::make_unique<AST::GEL>(std::move(I), MemTreatment(std::move(E)), std::move(T));
+		return Arena::New<AST::For>(name, ty, Start, End, Step, std::move(loop_body), attrs);
 	}
 
-	static std::unique_ptr<AST::Expression> ParseSEL() {
+	// parfor i in lo..hi [reduce (add | and | or | xor) into com]... do ... end
+	static AST::Expression* ParseParfor() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		if(Lexer::CurrentToken != '(') {
-			ExprError("Expected '('.");
+		if(lexer->CurrentToken != Token::Identifier) {
+			ExprError("Expected identifier for 'parfor' loop variable.");
 		}
 
-		Lexer::GetNextToken();
+		std::string name(lexer->IdentifierStr);
 
-		auto I = ParseIdentifier();
+		lexer->GetNextToken();
 
-		if(Lexer::CurrentToken != ',') {
-			ExprError("Expected ','.");
+		if(lexer->CurrentToken != Token::In) {
+			ExprError("Expected 'in' keyword.");
 		}
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		auto E = ParseExpression();
+		AddParserCom(name, AST::GetType<AST::Integer64>());
 
-		if(Lexer::CurrentToken != ',') {
-			ExprError("Expected ','.");
-		}
+		ResetMainTarget();
+		SetMainTarget(name);
 
-		Lexer::GetNextToken();
+		auto Lo = MemTreatment(ParseExpression());
 
-		auto R = ParseExpression();
+		if(lexer->CurrentToken != '.') { ExprError("Expected '..' between the bounds of 'parfor'."); }
+		lexer->GetNextToken();
+		if(lexer->CurrentToken != '.') { ExprError("Expected '..' between the bounds of 'parfor'."); }
+		lexer->GetNextToken();
 
-		if(Lexer::CurrentToken != ')') {
-			ExprError("Expected ')'.");
-		}
+		auto Hi = MemTreatment(ParseExpression());
 
-		Lexer::GetNextToken();
+		std::vector<AST::Reduction> reductions;
 
-		return std::make_unique<AST::SEL>(std::move(I), std::move(E), std::move(R));
-	}
+		while(lexer->CurrentToken == Token::Reduce) {
 
-	static std::unique_ptr<AST::Expression> ParsePrimary() {
+			lexer->GetNextToken();
 
-		if(Lexer::CurrentToken == Token::Identifier) 	{ return ParseIdentifier(); }
-		else if(Lexer::CurrentToken == Token::Number) 	{ return ParseNumber(); }
-		else if(Lexer::CurrentToken == Token::Com) 		{ return ParseCom(); }
-		else if(Lexer::CurrentToken == Token::LLReturn) { return ParseLLReturn(); }
+			AST::Reduction r;
 
-		else if(Lexer::CurrentToken == Token::Add) { return ParseAdd(); }
-		else if(Lexer::CurrentToken == Token::Sub) { return ParseSub(); }
+			if(lexer->CurrentToken == Token::Add) { r.reduce_type = AST::ReduceType::ReduceAdd; }
+			else if(lexer->CurrentToken == Token::And) { r.reduce_type = AST::ReduceType::ReduceAnd; }
+			else if(lexer->CurrentToken == Token::Or) { r.reduce_type = AST::ReduceType::ReduceOr; }
+			else if(lexer->CurrentToken == Token::Xor) { r.reduce_type = AST::ReduceType::ReduceXor; }
+			else { ExprError("Expected 'add', 'and', 'or' or 'xor' after 'reduce'."); }
 
-		else if(Lexer::CurrentToken == Token::And) { return ParseAnd(); }
-		else if(Lexer::CurrentToken == Token::Or) { return ParseOr(); }
-		else if(Lexer::CurrentToken == Token::Xor) { return ParseXor(); }
+			lexer->GetNextToken();
 
-		else if(Lexer::CurrentToken == Token::If) { return ParseIf(); }
+			if(lexer->CurrentToken != Token::Into) {
+				ExprError("Expected 'into' keyword.");
+			}
 
-		else if(Lexer::CurrentToken == Token::Compare) { return ParseCompare(); }
+			lexer->GetNextToken();
 
-		else if(Lexer::CurrentToken == Token::Return) { return ParseReturn(); }
+			if(lexer->CurrentToken != Token::Identifier || !all_parser_coms.contains(lexer->IdentifierStr)) {
+				ExprError("Expected a com to reduce into.");
+			}
 
-		else if(Lexer::CurrentToken == Token::ComStore) { return ParseComStore(); }
+			r.name = Arena::Intern(lexer->IdentifierStr);
 
-		else if(Lexer::CurrentToken == Token::Mem) { return ParseMem(); }
-		else if(Lexer::CurrentToken == Token::LoadMem) { return ParseLoadMem(); }
-		else if(Lexer::CurrentToken == Token::MemStore) { return ParseMemStore(); }
+			reductions.push_back(r);
 
-		else if(Lexer::CurrentToken == Token::IntCast) { return ParseIntCast(); }
+			lexer->GetNextToken();
+		}
 
-		else if(Lexer::CurrentToken == Token::While) { return ParseWhile(); }
+		if(lexer->CurrentToken != Token::Do) {
+			ExprError("Expected 'do' keyword.");
+		}
 
-		else if(Lexer::CurrentToken == Token::Block) { return ParseBlock(); }
-		else if(Lexer::CurrentToken == Token::Goto) { return ParseGoto(); }
+		lexer->GetNextToken();
 
-		else if(Lexer::CurrentToken == Token::GEL) { return ParseGEL(); }
-		else if(Lexer::CurrentToken == Token::SEL) { return ParseSEL(); }
+		std::vector<AST::Expression*> loop_body;
 
-		ExprError("Unknown expression found. Found Token Number: " + std::to_string(Lexer::CurrentToken));
-		return nullptr;
-	}
+		MemVerifyAll();
 
-	static std::unique_ptr<AST::Expression> Mem_CreateAutoLoad(std::unique_ptr<AST::Expression> V, std::vector<std::unique_ptr<AST::Expression>> ext_init = {} ) {
+		parforDepth++;
 
-		Parser::all_parser_mems[V->name]->loadCount += 1;
-		Parser::all_parser_mems[V->name]->loadVariableName = V->name + "_load" + std::to_string(Parser::all_parser_mems[V->name]->loadCount);
+		while(lexer->CurrentToken != Token::End) {
 
-		auto newCom = std::make_unique<AST::Com>(
-			Parser::all_parser_mems[V->name]->loadVariableName, 
-			Parser::all_parser_mems[V->name]->ty->Clone(),
-			std::make_unique<AST::LoadMem>(std::move(V))
-		);
+			AST::Expression* e = ParseExpression();
 
-		std::string getComName = newCom->name;
+			if(lexer->CurrentToken != ';') { ExprError("Expected ';' to end instruction inside parfor loop."); }
 
-		std::vector<std::unique_ptr<AST::Expression>> addVec;
+			loop_body.push_back(e);
 
-		addVec = std::move(ext_init);
+			ResetMainTarget();
 
-		addVec.push_back(std::move(newCom));
+			lexer->GetNextToken();
+		}
 
-		//std::cout << getComName << "'s new auto load created!\n";
+		parforDepth--;
 
-		return std::make_unique<AST::Variable>(getComName, std::move(addVec));
-	}
+		lexer->GetNextToken();
 
-	static std::unique_ptr<AST::Expression> Mem_CreateAutoStoreAndVerify(std::unique_ptr<AST::Expression> V) {
+		MemVerifyAll();
 
-		std::string getVName = V->name;
-		std::string getLoadName = Parser::all_parser_mems[V->name]->loadVariableName;
+		return Arena::New<AST::Parfor>(name, Lo, Hi, std::move(loop_body), std::move(reductions));
+	}
 
-		Parser::all_parser_mems[V->name]->loadVariableName.clear();
+	static AST::Expression* ParseBlock() {
 
-		Parser::all_parser_mems[V->name]->is_verified = true;
+		lexer->GetNextToken();
 
-		std::vector<std::unique_ptr<AST::Expression>> initStore;
+		AST::Attributes attrs;
 
-		initStore.push_back(std::make_unique<AST::MemStore>(std::move(V), std::make_unique<AST::Variable>(getLoadName)));
+		if(lexer->CurrentToken == '[') {
+			attrs = ParseAttributes();
+		}
 
-		return Mem_CreateAutoLoad(std::make_unique<AST::Variable>(getVName), std::move(initStore));
-	}
+		if(lexer->CurrentToken != Token::Identifier) {
+			ExprError("Expected identifier for new block.");
+		}
 
-	static void MemVerifyAll() {
+		std::string name(lexer->IdentifierStr);
 
-		UNORDERED_MAP_FOREACH(std::string, std::unique_ptr<Parser_Mem>, Parser::all_parser_mems, it) {
+		Parser::allBlockNames.push_back(name);
 
-			it->second->loadVariableName.clear();
+		lexer->GetNextToken();
 
-			it->second->is_verified = true;
+		if(lexer->CurrentToken != Token::Begin) {
+			ExprError("Expected 'begin' for new block.");
 		}
-	}
 
-	static std::unique_ptr<AST::Expression> Mem_Verify(std::unique_ptr<AST::Expression> V) {
+		lexer->GetNextToken();
 
-		if(Parser::all_parser_mems.find(V->name) != Parser::all_parser_mems.end()) {
+		std::vector<AST::Expression*> all_instructions;
 
-			Parser::all_parser_mems[V->name]->loadVariableName.clear();
+		while (lexer->CurrentToken != Token::End) { 
 
-			Parser::all_parser_mems[V->name]->is_verified = true;
-		}
+			AST::Expression* e = ParseExpression();
 
-		return std::move(V);
-	}
+			if(lexer->CurrentToken != ';') { ExprError("Expected ';' to end instruction inside '" + name + "' block."); }
 
-	static std::unique_ptr<AST::Expression> MemTreatment(std::unique_ptr<AST::Expression> V, bool is_left_ident = false) {
+			all_instructions.push_back(e);
 
-		if(Parser::all_parser_mems.find(V->name) == Parser::all_parser_mems.end()) {
-			return V;
-		}
+			ResetMainTarget();
 
-		if(Parser::all_parser_mems[V->name]->loadVariableName == "" && Parser::all_parser_mems[V->name]->is_verified) {
-			return Mem_CreateAutoLoad(std::move(V));
+			lexer->GetNextToken();
 		}
-		else if(!is_left_ident) {
 
-			if(Parser::all_parser_mems[V->name]->loadVariableName != "" && !Parser::all_parser_mems[V->name]->is_verified) {
-				return Mem_CreateAutoStoreAndVerify(std::move(V));
-			}
-		}
+		lexer->GetNextToken();
 
-		return std::make_unique<AST::Variable>(Parser::all_parser_mems[V->name]->loadVariableName);
+		return Arena::New<AST::Block>(name, std::move(all_instructions), attrs);
 	}
 
-	static std::unique_ptr<AST::Expression> UnverifyMem(std::unique_ptr<AST::Expression> V) {
+	static AST::Expression* ParseGoto() {
 
-		if(Parser::all_parser_mems.find(V->name) != Parser::all_parser_mems.end()) {
-	
-			std::string getMemName = V->name;
-	
-			auto result = MemTreatment(std::move(V), true);
+		if(parforDepth > 0) { ExprError("Can't use 'goto' inside of a 'parfor' loop."); }
 
-			Parser::all_parser_mems[getMemName]->is_verified = false;
-	
-			return result;
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != Token::Identifier) {
+			ExprError("Expected block name.");
 		}
-	
-		return V;
-	}
 
-	static std::unique_ptr<AST::Expression> ParseAddOperator(std::unique_ptr<AST::Expression> L) {
+		std::string blockName(lexer->IdentifierStr);
 
-		Lexer::GetNextToken();
+		bool blockNameExists = false;
+		for(auto i : Parser::allBlockNames) {
 
-		if(Lexer::CurrentToken != '=') {
-			ExprError("Expected '='.");
+			if(i == blockName) {
+				blockNameExists = true;
+				break;
+			}
 		}
 
-		Lexer::GetNextToken();
-
-		auto R = ParseExpression();
+		lexer->GetNextToken();
 
-		return std::make_unique<AST::Add>(UnverifyMem(std::move(L)), MemTreatment(std::move(R)));
+		return Arena::New<AST::Goto>(blockName);
 	}
 
-	static std::unique_ptr<AST::Expression> ParseSubOperator(std::unique_ptr<AST::Expression> L) {
+	static AST::Expression* ParseGEL() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		if(Lexer::CurrentToken != '=') {
-			ExprError("Expected '='.");
+		if(lexer->CurrentToken != '(') {
+			ExprError("Expected '('.");
 		}
 
-		Lexer::GetNextToken();
-
-		auto R = ParseExpression();
-
-		return std::make_unique<AST::Sub>(UnverifyMem(std::move(L)), MemTreatment(std::move(R)));
-	}
-
-	static std::unique_ptr<AST::Expression> ParseEqualsOperator(std::unique_ptr<AST::Expression> L) {
+		lexer->GetNextToken();
 
-		Lexer::GetNextToken();
+		auto I = ParseIdentifier();
 
-		if(all_parser_coms.find(L->name) != all_parser_coms.end()) {
+		auto itMem = all_parser_mems.find(I->name);
 
-			auto R = ParseExpression();
+		if(itMem != all_parser_mems.end() && dynamic_cast<AST::SoA*>(itMem->second->ty) != nullptr) {
+			ExprError("Records of the 'SoA' mem '" + std::string(I->name) + "' can only be reached with 'GEF'.");
+		}
 
-			return std::make_unique<AST::ComStore>(std::move(L), MemTreatment(std::move(R)));
+		if(lexer->CurrentToken != ',') {
+			ExprError("Expected ','.");
 		}
 
-		if(all_parser_mems.find(L->name) != all_parser_mems.end()) {
+		lexer->GetNextToken();
 
-			auto R = ParseExpression();
+		auto E = ParseLaneExpression();
 
-			return std::make_unique<AST::MemStore>(Mem_Verify(std::move(L)), MemTreatment(std::move(R)));
+		if(lexer->CurrentToken != ')') {
+			ExprError("Expected ')'.");
 		}
 
-		ExprError("Unknown var type found.");
-		return nullptr;
-	}
-
-	static std::unique_ptr<AST::Expression> ParseBinaryOperator(std::unique_ptr<AST::Expression> L) {
+		lexer->GetNextToken();
 
-		if(Lexer::CurrentToken == '=') {
-			return ParseEqualsOperator(std::move(L));
-		}
-		else if(Lexer::CurrentToken == '+') {
-			return ParseAddOperator(std::move(L));
-		}
-		else if(Lexer::CurrentToken == '-') {
-			return ParseSubOperator(std::move(L));
+		if(lexer->CurrentToken != Token::As) {
+			ExprError("Expected 'as'.");
 		}
 
-		return L;
-	}
+		lexer->GetNextToken();
 
-	static std::unique_ptr<AST::Expression> ParseExpression() {
+		auto T = IdentStrToType();
 
-		auto P = ParsePrimary();
+		lexer->GetNextToken();
 
-		return ParseBinaryOperator(std::move(P));
+		return Arena::New<AST::GEL>(I, E, T);
 	}
 
-	static AST::Attributes ParseAttributes() {
+	static AST::Expression* ParseSEL() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		AST::Attributes attrs;
+		if(lexer->CurrentToken != '(') {
+			ExprError("Expected '('.");
+		}
 
-		while(Lexer::CurrentToken != ']') {
+		lexer->GetNextToken();
 
-			if(Lexer::IsIdentifier("StackProtected")) {
-				attrs.isStackProtected = true;
+		auto I = ParseIdentifier();
+
+		if(lexer->CurrentToken != ',') {
+			ExprError("Expected ','.");
+		}
+
+		lexer->GetNextToken();
+
+		auto E = ParseExpression();
+
+		if(lexer->CurrentToken != ',') {
+			ExprError("Expected ','.");
+		}
+
+		lexer->GetNextToken();
+
+		auto R = ParseExpression();
+
+		if(lexer->CurrentToken != ')') {
+			ExprError("Expected ')'.");
+		}
+
+		lexer->GetNextToken();
+
+		return Arena::New<AST::SEL>(I, E, R);
+	}
+
+	static AST::Expression* ParseGEF() {
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != '(') {
+			ExprError("Expected '('.");
+		}
+
+		lexer->GetNextToken();
+
+		auto I = ParseIdentifier();
+
+		AST::Type* baseTy = FindType(I->name);
+
+		if(dynamic_cast<AST::Ref*>(baseTy) != nullptr) {
+			baseTy = baseTy->childTy;
+		}
+
+		// Arrays (and 'SoA' mems) take the index of the record before the field.
+		bool isIndexed = dynamic_cast<AST::Array*>(baseTy) != nullptr || dynamic_cast<AST::SoA*>(baseTy) != nullptr;
+
+		if(dynamic_cast<AST::Array*>(baseTy) != nullptr) {
+			baseTy = baseTy->childTy;
+		}
+
+		AST::Record* record = dynamic_cast<AST::Record*>(dynamic_cast<AST::SoA*>(baseTy) != nullptr ? baseTy->childTy : baseTy);
+
+		if(record == nullptr) {
+			ExprError("'GEF' needs a record, an array of records or a reference to one, found '" + std::string(I->name) + "'.");
+		}
+
+		if(lexer->CurrentToken != ',') {
+			ExprError("Expected ','.");
+		}
+
+		lexer->GetNextToken();
+
+		AST::Expression* item = nullptr;
+
+		if(isIndexed) {
+
+			item = ParseLaneExpression();
+
+			if(lexer->CurrentToken != ',') {
+				ExprError("Expected ','.");
+			}
+
+			lexer->GetNextToken();
+		}
+
+		if(lexer->CurrentToken != Token::Identifier) {
+			ExprError("Expected the name of a field of '" + record->recordName + "'.");
+		}
+
+		int field = record->FindField(lexer->IdentifierStr);
+
+		if(field < 0) {
+			ExprError("Record '" + record->recordName + "' has no field '" + std::string(lexer->IdentifierStr) + "'.");
+		}
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != ')') {
+			ExprError("Expected ')'.");
+		}
+
+		lexer->GetNextToken();
+
+		return Arena::New<AST::GEF>(I, item, baseTy, field);
+	}
+
+	// Numbers parsed here are plain 'i32' instead of taking the type of the main target
+	// (a lane index or a lane value must not become a vector, an element index must not become a float).
+	static AST::Expression* ParseLaneExpression() {
+
+		std::string oldMainTarget = Parser::main_target;
+		bool oldCanBeModified = Parser::can_main_target_be_modified;
+
+		Parser::main_target.clear();
+		Parser::can_main_target_be_modified = false;
+
+		auto E = MemTreatment(ParseExpression());
+
+		Parser::main_target = oldMainTarget;
+		Parser::can_main_target_be_modified = oldCanBeModified;
+
+		return E;
+	}
+
+	// Optional alignment (in bytes) at the end of 'VLOAD' and 'VSTORE'.
+	static uint64_t ParseVectorAlign() {
+
+		if(lexer->CurrentToken != ',') {
+			return 0;
+		}
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != Token::Number) {
+			ExprError("Expected number to set alignment.");
+		}
+
+		uint64_t align = ToInteger<uint64_t>(lexer->NumValString);
+
+		if(align == 0 || (align & (align - 1)) != 0) {
+			ExprError("Alignment must be a power of two.");
+		}
+
+		lexer->GetNextToken();
+
+		return align;
+	}
+
+	static AST::Type* ParseVectorAs() {
+
+		if(lexer->CurrentToken != Token::As) {
+			ExprError("Expected 'as'.");
+		}
+
+		lexer->GetNextToken();
+
+		auto T = IdentStrToType();
+
+		if(dynamic_cast<AST::Vector*>(T) == nullptr) {
+			ExprError("Expected vector type.");
+		}
+
+		lexer->GetNextToken();
+
+		return T;
+	}
+
+	static AST::Expression* ParseSplat() {
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != '(') {
+			ExprError("Expected '('.");
+		}
+
+		lexer->GetNextToken();
+
+		auto V = ParseLaneExpression();
+
+		if(lexer->CurrentToken != ')') {
+			ExprError("Expected ')'.");
+		}
+
+		lexer->GetNextToken();
+
+		return Arena::New<AST::Splat>(V, ParseVectorAs());
+	}
+
+	static AST::Expression* ParseExtract() {
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != '(') {
+			ExprError("Expected '('.");
+		}
+
+		lexer->GetNextToken();
+
+		auto V = MemTreatment(ParseIdentifier());
+
+		if(lexer->CurrentToken != ',') {
+			ExprError("Expected ','.");
+		}
+
+		lexer->GetNextToken();
+
+		auto L = ParseLaneExpression();
+
+		if(lexer->CurrentToken != ')') {
+			ExprError("Expected ')'.");
+		}
+
+		lexer->GetNextToken();
+
+		return Arena::New<AST::Extract>(V, L);
+	}
+
+	static AST::Expression* ParseInsert() {
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != '(') {
+			ExprError("Expected '('.");
+		}
+
+		lexer->GetNextToken();
+
+		auto V = MemTreatment(ParseIdentifier());
+
+		if(lexer->CurrentToken != ',') {
+			ExprError("Expected ','.");
+		}
+
+		lexer->GetNextToken();
+
+		auto L = ParseLaneExpression();
+
+		if(lexer->CurrentToken != ',') {
+			ExprError("Expected ','.");
+		}
+
+		lexer->GetNextToken();
+
+		auto R = ParseLaneExpression();
+
+		if(lexer->CurrentToken != ')') {
+			ExprError("Expected ')'.");
+		}
+
+		lexer->GetNextToken();
+
+		return Arena::New<AST::Insert>(V, L, R);
+	}
+
+	static AST::Expression* ParseVLoad() {
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != '(') {
+			ExprError("Expected '('.");
+		}
+
+		lexer->GetNextToken();
+
+		auto I = ParseIdentifier();
+
+		if(lexer->CurrentToken != ',') {
+			ExprError("Expected ','.");
+		}
+
+		lexer->GetNextToken();
+
+		auto E = ParseLaneExpression();
+
+		uint64_t align = ParseVectorAlign();
+
+		if(lexer->CurrentToken != ')') {
+			ExprError("Expected ')'.");
+		}
+
+		lexer->GetNextToken();
+
+		return Arena::New<AST::VLoad>(I, E, align, ParseVectorAs());
+	}
+
+	static AST::Expression* ParseVStore() {
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != '(') {
+			ExprError("Expected '('.");
+		}
+
+		lexer->GetNextToken();
+
+		auto I = ParseIdentifier();
+
+		if(lexer->CurrentToken != ',') {
+			ExprError("Expected ','.");
+		}
+
+		lexer->GetNextToken();
+
+		auto E = ParseLaneExpression();
+
+		if(lexer->CurrentToken != ',') {
+			ExprError("Expected ','.");
+		}
+
+		lexer->GetNextToken();
+
+		auto R = MemTreatment(ParseExpression());
+
+		uint64_t align = ParseVectorAlign();
+
+		if(lexer->CurrentToken != ')') {
+			ExprError("Expected ')'.");
+		}
+
+		lexer->GetNextToken();
+
+		return Arena::New<AST::VStore>(I, E, R, align);
+	}
+
+	static AST::Expression* ParseNTStore() {
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != '(') {
+			ExprError("Expected '('.");
+		}
+
+		lexer->GetNextToken();
+
+		auto I = ParseIdentifier();
+
+		if(lexer->CurrentToken != ',') {
+			ExprError("Expected ','.");
+		}
+
+		lexer->GetNextToken();
+
+		auto E = ParseLaneExpression();
+
+		if(lexer->CurrentToken != ',') {
+			ExprError("Expected ','.");
+		}
+
+		lexer->GetNextToken();
+
+		auto R = MemTreatment(ParseExpression());
+
+		uint64_t align = ParseVectorAlign();
+
+		if(lexer->CurrentToken != ')') {
+			ExprError("Expected ')'.");
+		}
+
+		lexer->GetNextToken();
+
+		return Arena::New<AST::NTStore>(I, E, R, align);
+	}
+
+	static AST::Expression* ParsePrefetch() {
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != '(') {
+			ExprError("Expected '('.");
+		}
+
+		lexer->GetNextToken();
+
+		auto I = ParseIdentifier();
+
+		// Elements of 'Array<T>' / 'Ref<Array<T>>' are 'T', a 'Ref<T>' points to the first 'T'.
+		AST::Type* elementTy = FindType(I->name);
+
+		if(dynamic_cast<AST::Ref*>(elementTy) != nullptr) {
+			elementTy = elementTy->childTy;
+		}
+
+		if(dynamic_cast<AST::Array*>(elementTy) != nullptr) {
+			elementTy = elementTy->childTy;
+		}
+
+		if(dynamic_cast<AST::SoA*>(elementTy) != nullptr) {
+			ExprError("Records of the 'SoA' mem '" + std::string(I->name) + "' can only be reached with 'GEF'.");
+		}
+
+		if(lexer->CurrentToken != ',') {
+			ExprError("Expected ','.");
+		}
+
+		lexer->GetNextToken();
+
+		auto E = ParseLaneExpression();
+
+		if(lexer->CurrentToken != ')') {
+			ExprError("Expected ')'.");
+		}
+
+		lexer->GetNextToken();
+
+		return Arena::New<AST::Prefetch>(I, E, elementTy);
+	}
+
+	static AST::Expression* ParsePrimary() {
+
+		if(lexer->CurrentToken == Token::Identifier) 	{ return ParseIdentifier(); }
+		else if(lexer->CurrentToken == Token::Number) 	{ return ParseNumber(); }
+		else if(lexer->CurrentToken == Token::Com) 		{ return ParseCom(); }
+		else if(lexer->CurrentToken == Token::LLReturn) { return ParseLLReturn(); }
+
+		else if(lexer->CurrentToken == Token::Add) { return ParseAdd(); }
+		else if(lexer->CurrentToken == Token::Sub) { return ParseSub(); }
+
+		else if(lexer->CurrentToken == Token::And) { return ParseAnd(); }
+		else if(lexer->CurrentToken == Token::Or) { return ParseOr(); }
+		else if(lexer->CurrentToken == Token::Xor) { return ParseXor(); }
+
+		else if(lexer->CurrentToken == Token::Mul) { return ParseArithmetic(AST::ArithmeticType::Mul); }
+		else if(lexer->CurrentToken == Token::UMul) { return ParseArithmetic(AST::ArithmeticType::UMul); }
+		else if(lexer->CurrentToken == Token::Div) { return ParseArithmetic(AST::ArithmeticType::Div); }
+		else if(lexer->CurrentToken == Token::UDiv) { return ParseArithmetic(AST::ArithmeticType::UDiv); }
+		else if(lexer->CurrentToken == Token::Rem) { return ParseArithmetic(AST::ArithmeticType::Rem); }
+		else if(lexer->CurrentToken == Token::URem) { return ParseArithmetic(AST::ArithmeticType::URem); }
+		else if(lexer->CurrentToken == Token::Shl) { return ParseArithmetic(AST::ArithmeticType::Shl); }
+		else if(lexer->CurrentToken == Token::Shr) { return ParseArithmetic(AST::ArithmeticType::Shr); }
+		else if(lexer->CurrentToken == Token::UShr) { return ParseArithmetic(AST::ArithmeticType::UShr); }
+
+		else if(lexer->CurrentToken == Token::If) { return ParseIf(); }
+
+		else if(lexer->CurrentToken == Token::Compare) { return ParseCompare(); }
+
+		else if(lexer->CurrentToken == Token::Return) { return ParseReturn(); }
+
+		else if(lexer->CurrentToken == Token::ComStore) { return ParseComStore(); }
+
+		else if(lexer->CurrentToken == Token::Mem) { return ParseMem(); }
+		else if(lexer->CurrentToken == Token::LoadMem) { return ParseLoadMem(); }
+		else if(lexer->CurrentToken == Token::MemStore) { return ParseMemStore(); }
+
+		else if(lexer->CurrentToken == Token::IntCast) { return ParseIntCast(); }
+
+		else if(lexer->CurrentToken == Token::While) { return ParseWhile(); }
+		else if(lexer->CurrentToken == Token::For) { return ParseFor(); }
+		else if(lexer->CurrentToken == Token::Parfor) { return ParseParfor(); }
+
+		else if(lexer->CurrentToken == Token::Block) { return ParseBlock(); }
+		else if(lexer->CurrentToken == Token::Goto) { return ParseGoto(); }
+
+		else if(lexer->CurrentToken == Token::GEL) { return ParseGEL(); }
+		else if(lexer->CurrentToken == Token::SEL) { return ParseSEL(); }
+		else if(lexer->CurrentToken == Token::GEF) { return ParseGEF(); }
+
+		else if(lexer->CurrentToken == Token::Splat) { return ParseSplat(); }
+		else if(lexer->CurrentToken == Token::Extract) { return ParseExtract(); }
+		else if(lexer->CurrentToken == Token::Insert) { return ParseInsert(); }
+		else if(lexer->CurrentToken == Token::VLoad) { return ParseVLoad(); }
+		else if(lexer->CurrentToken == Token::VStore) { return ParseVStore(); }
+		else if(lexer->CurrentToken == Token::NTStore) { return ParseNTStore(); }
+		else if(lexer->CurrentToken == Token::Prefetch) { return ParsePrefetch(); }
+
+		ExprError("Unknown expression found. Found Token Number: " + std::to_string(lexer->CurrentToken));
+		return nullptr;
+	}
+
+	static AST::Expression* Mem_CreateAutoLoad(AST::Expression* V, std::vector<AST::Expression*> ext_init = {} ) {
+
+		Parser::all_parser_mems[V->name]->loadCount += 1;
+		Parser::all_parser_mems[V->name]->loadVariableName = std::string(V->name) + "_load" + std::to_string(Parser::all_parser_mems[V->name]->loadCount);
+
+		auto newCom = Arena::New<AST::Com>(
+			Parser::all_parser_mems[V->name]->loadVariableName, 
+			Parser::all_parser_mems[V->name]->ty,
+			Arena::New<AST::LoadMem>(V)
+		);
+
+		std::string_view getComName = newCom->name;
+
+		std::vector<AST::Expression*> addVec;
+
+		addVec = std::move(ext_init);
+
+		addVec.push_back(newCom);
+
+		//std::cout << getComName << "'s new auto load created!\n";
+
+		return Arena::New<AST::Variable>(getComName, std::move(addVec));
+	}
+
+	static AST::Expression* Mem_CreateAutoStoreAndVerify(AST::Expression* V) {
+
+		std::string_view getVName = V->name;
+		std::string getLoadName = Parser::all_parser_mems[V->name]->loadVariableName;
+
+		Parser::all_parser_mems[V->name]->loadVariableName.clear();
+
+		Parser::all_parser_mems[V->name]->is_verified = true;
+
+		std::vector<AST::Expression*> initStore;
+
+		initStore.push_back(Arena::New<AST::MemStore>(V, Arena::New<AST::Variable>(getLoadName)));
+
+		return Mem_CreateAutoLoad(Arena::New<AST::Variable>(getVName), std::move(initStore));
+	}
+
+	static void MemVerifyAll() {
+
+		UNORDERED_MAP_FOREACH(std::string_view, std::unique_ptr<Parser_Mem>, Parser::all_parser_mems, it) {
+
+			it->second->loadVariableName.clear();
+
+			it->second->is_verified = true;
+		}
+	}
+
+	static AST::Expression* Mem_Verify(AST::Expression* V) {
+
+		if(Parser::all_parser_mems.find(V->name) != Parser::all_parser_mems.end()) {
+
+			Parser::all_parser_mems[V->name]->loadVariableName.clear();
+
+			Parser::all_parser_mems[V->name]->is_verified = true;
+		}
+
+		return V;
+	}
+
+	static AST::Expression* MemTreatment(AST::Expression* V, bool is_left_ident = false) {
+
+		if(Parser::all_parser_mems.find(V->name) == Parser::all_parser_mems.end()) {
+			return V;
+		}
+
+		if(Parser::all_parser_mems[V->name]->loadVariableName == "" && Parser::all_parser_mems[V->name]->is_verified) {
+			return Mem_CreateAutoLoad(V);
+		}
+		else if(!is_left_ident) {
+
+			if(Parser::all_parser_mems[V->name]->loadVariableName != "" && !Parser::all_parser_mems[V->name]->is_verified) {
+				return Mem_CreateAutoStoreAndVerify(V);
+			}
+		}
+
+		return Arena::New<AST::Variable>(Parser::all_parser_mems[V->name]->loadVariableName);
+	}
+
+	static AST::Expression* UnverifyMem(AST::Expression* V) {
+
+		if(Parser::all_parser_mems.find(V->name) != Parser::all_parser_mems.end()) {
+	
+			std::string_view getMemName = V->name;
+	
+			auto result = MemTreatment(V, true);
+
+			Parser::all_parser_mems[getMemName]->is_verified = false;
+	
+			return result;
+		}
+	
+		return V;
+	}
+
+	static AST::Expression* ParseAddOperator(AST::Expression* L) {
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != '=') {
+			ExprError("Expected '='.");
+		}
+
+		lexer->GetNextToken();
+
+		auto R = ParseExpression();
+
+		return Arena::New<AST::Add>(UnverifyMem(L), MemTreatment(R));
+	}
+
+	static AST::Expression* ParseSubOperator(AST::Expression* L) {
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != '=') {
+			ExprError("Expected '='.");
+		}
+
+		lexer->GetNextToken();
+
+		auto R = ParseExpression();
+
+		return Arena::New<AST::Sub>(UnverifyMem(L), MemTreatment(R));
+	}
+
+	// 'x *= y', 'x /= y', 'x %= y', 'x <<= y' and 'x >>= y'. All signed.
+	static AST::Expression* ParseArithmeticOperator(AST::Expression* L, int arith_type) {
+
+		// The second '<' / '>' of a shift.
+		if(arith_type == AST::ArithmeticType::Shl || arith_type == AST::ArithmeticType::Shr) {
+
+			int op = lexer->CurrentToken;
+
+			lexer->GetNextToken();
+
+			if(lexer->CurrentToken != op) {
+				ExprError("Expected '" + std::string(2, (char)op) + "='.");
+			}
+		}
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != '=') {
+			ExprError("Expected '='.");
+		}
+
+		lexer->GetNextToken();
+
+		auto R = ParseExpression();
+
+		return Arena::New<AST::Arithmetic>(UnverifyMem(L), MemTreatment(R), arith_type);
+	}
+
+	static AST::Expression* ParseEqualsOperator(AST::Expression* L) {
+
+		lexer->GetNextToken();
+
+		if(all_parser_coms.find(L->name) != all_parser_coms.end()) {
+
+			auto R = ParseExpression();
+
+			return Arena::New<AST::ComStore>(L, MemTreatment(R));
+		}
+
+		if(all_parser_mems.find(L->name) != all_parser_mems.end()) {
+
+			auto R = ParseExpression();
+
+			return Arena::New<AST::MemStore>(Mem_Verify(L), MemTreatment(R));
+		}
+
+		ExprError("Unknown var type found.");
+		return nullptr;
+	}
+
+	static AST::Expression* ParseBinaryOperator(AST::Expression* L) {
+
+		if(lexer->CurrentToken == '=') {
+			return ParseEqualsOperator(L);
+		}
+		else if(lexer->CurrentToken == '+') {
+			return ParseAddOperator(L);
+		}
+		else if(lexer->CurrentToken == '-') {
+			return ParseSubOperator(L);
+		}
+		else if(lexer->CurrentToken == '*') {
+			return ParseArithmeticOperator(L, AST::ArithmeticType::Mul);
+		}
+		else if(lexer->CurrentToken == '/') {
+			return ParseArithmeticOperator(L, AST::ArithmeticType::Div);
+		}
+		else if(lexer->CurrentToken == '%') {
+			return ParseArithmeticOperator(L, AST::ArithmeticType::Rem);
+		}
+		else if(lexer->CurrentToken == '<') {
+			return ParseArithmeticOperator(L, AST::ArithmeticType::Shl);
+		}
+		else if(lexer->CurrentToken == '>') {
+			return ParseArithmeticOperator(L, AST::ArithmeticType::Shr);
+		}
+
+		return L;
+	}
+
+	static AST::Expression* ParseExpression() {
+
+		auto P = ParsePrimary();
+
+		return ParseBinaryOperator(P);
+	}
+
+	// The '(n)' of attributes like 'Unroll(n)'. Leaves the lexer on ')'.
+	static unsigned ParseAttributeNumber(std::string name) {
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != '(') { ExprError("Expected '(' after '" + name + "'."); }
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != Token::Number) { ExprError("Expected a number for '" + name + "'."); }
+
+		unsigned n = ToInteger<unsigned>(lexer->NumValString);
+
+		if(n < 1) { ExprError("'" + name + "' must be at least 1."); }
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != ')') { ExprError("Expected ')' after the number of '" + name + "'."); }
+
+		return n;
+	}
+
+	static AST::Attributes ParseAttributes() {
+
+		lexer->GetNextToken();
+
+		AST::Attributes attrs;
+
+		while(lexer->CurrentToken != ']') {
+
+			if(lexer->IsIdentifier("StackProtected")) {
+				attrs.isStackProtected = true;
 			}
 
-			if(Lexer::IsIdentifier("CStdLib")) {
+			if(lexer->IsIdentifier("CStdLib")) {
 				attrs.usesCStdLib = true;
 			}
 
-			Lexer::GetNextToken();
+			if(lexer->IsIdentifier("Inline")) {
+				attrs.isInline = true;
+			}
+
+			if(lexer->IsIdentifier("Static")) {
+				attrs.isStatic = true;
+			}
+
+			if(lexer->IsIdentifier("Hot")) {
+				attrs.isHot = true;
+			}
+
+			if(lexer->IsIdentifier("Cold")) {
+				attrs.isCold = true;
+			}
+
+			if(lexer->IsIdentifier("NoInline")) {
+				attrs.isNoInline = true;
+			}
+
+			if(lexer->IsIdentifier("Likely")) {
+				attrs.isLikely = true;
+			}
+
+			if(lexer->IsIdentifier("FastMath")) {
+				attrs.isFastMath = true;
+			}
+
+			if(lexer->IsIdentifier("Packed")) {
+				attrs.isPacked = true;
+			}
+
+			if(lexer->IsIdentifier("SoA")) {
+				attrs.isSoA = true;
+			}
+
+			// 'IdentifierStr' is left as is by other tokens, like the ')' of 'Unroll(n)'.
+			bool isIdentifier = lexer->CurrentToken == Token::Identifier;
+
+			if(isIdentifier && lexer->IsIdentifier("Unroll")) {
+				attrs.unrollCount = ParseAttributeNumber("Unroll");
+			}
+			else if(isIdentifier && lexer->IsIdentifier("Vectorize")) {
+				attrs.vectorizeWidth = ParseAttributeNumber("Vectorize");
+			}
+			else if(isIdentifier && lexer->IsIdentifier("Align")) {
+
+				attrs.align = ParseAttributeNumber("Align");
+
+				if((attrs.align & (attrs.align - 1)) != 0) {
+					ExprError("'Align' must be a power of two.");
+				}
+			}
+
+			lexer->GetNextToken();
 		}
 
-		if(Lexer::CurrentToken == ']') {
-			Lexer::GetNextToken();
+		if(lexer->CurrentToken == ']') {
+			lexer->GetNextToken();
 		}
 
 		return attrs;
 	}
 
-	static std::unique_ptr<AST::Program> ParseProgram() {
+	static AST::Program* ParseProgram() {
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		if(Lexer::CurrentToken == '[') {
+		if(lexer->CurrentToken == '[') {
 			Parser::currentAttributes = ParseAttributes();
 		}
 
-		if(Lexer::CurrentToken != Token::Begin) { ExprError("'begin' keyword not found."); }
+		if(lexer->CurrentToken != Token::Begin) { ExprError("'begin' keyword not found."); }
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::vector<std::unique_ptr<AST::Expression>> all_instructions;
+		std::vector<AST::Expression*> all_instructions;
 
-		while (Lexer::CurrentToken != Token::End) { 
+		while (lexer->CurrentToken != Token::End) { 
 
-			std::unique_ptr<AST::Expression> e = ParseExpression();
+			AST::Expression* e = ParseExpression();
 
-			if(Lexer::CurrentToken != ';') { ExprError("Expected ';' to end instruction inside program."); }
+			if(lexer->CurrentToken != ';') { ExprError("Expected ';' to end instruction inside program."); }
 
-			all_instructions.push_back(std::move(e));
+			all_instructions.push_back(e);
 
 			ResetMainTarget();
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 		}
 
-		return std::make_unique<AST::Program>(std::move(all_instructions), Parser::currentAttributes);
+		return Arena::New<AST::Program>(std::move(all_instructions), Parser::currentAttributes);
 	}
 
-	static std::unique_ptr<AST::Procedure> ParseProcedure() {
+	static AST::Procedure* ParseProcedure() {
+
+		lexer->isInside = LexerIsInside::AProcedure;
+
+		lexer->GetNextToken();
 
-		Lexer::isInside = LexerIsInside::AProcedure;
+		AST::Attributes attrs;
 
-		Lexer::GetNextToken();
+		if(lexer->CurrentToken == '[') {
+			attrs = ParseAttributes();
+		}
 
-		std::string procName = Lexer::IdentifierStr;
+		std::string procName(lexer->IdentifierStr);
 
 		Parser::current_procedure_name = procName;
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
 		std::vector<std::string> all_argument_var_types;
-		std::vector<std::unique_ptr<AST::Expression>> all_arguments;
-		std::vector<std::unique_ptr<AST::Type>> all_argument_types;
-		std::vector<std::unique_ptr<AST::Expression>> body;
+		std::vector<AST::Expression*> all_arguments;
+		std::vector<AST::Type*> all_argument_types;
+		std::vector<AST::Attributes> all_argument_attrs;
+		std::vector<AST::Expression*> body;
 
-		if(Lexer::CurrentToken != '(') { ExprError("Expected '(' to add arguments."); }
+		if(lexer->CurrentToken != '(') { ExprError("Expected '(' to add arguments."); }
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		while(Lexer::CurrentToken != ')') {
+		while(lexer->CurrentToken != ')') {
 
-			if(Lexer::CurrentToken == Token::Com)
+			if(lexer->CurrentToken == Token::Com)
 				all_argument_var_types.push_back("com");
+			else if(lexer->CurrentToken == Token::Mem)
+				all_argument_var_types.push_back("mem");
+
+			lexer->GetNextToken();
+
+			AST::Attributes argAttrs;
 
-			Lexer::GetNextToken();
+			if(lexer->CurrentToken == '[') {
+
+				argAttrs = ParseAttributes();
+
+				if(argAttrs.align != 0 && all_argument_var_types.back() != "mem") {
+					ExprError("'Align' only applies to 'mem' arguments.");
+				}
+			}
 
 			auto I = ParseIdentifier();
 
-			if(Lexer::CurrentToken != ':') { ExprError("Expected ':' to specify argument type."); }
+			if(lexer->CurrentToken != ':') { ExprError("Expected ':' to specify argument type."); }
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 
 			auto T = IdentStrToType();
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
+
+			if(all_argument_var_types.back() == "mem") {
+				AddParserMem(I->name, T);
+			}
+			else {
+				AddParserCom(I->name, T);
+			}
 
-			all_arguments.push_back(std::move(I));
-			all_argument_types.push_back(std::move(T));
+			all_arguments.push_back(I);
+			all_argument_types.push_back(T);
+			all_argument_attrs.push_back(argAttrs);
 
-			if(Lexer::CurrentToken != ',') {
-				if(Lexer::CurrentToken == ')') {
+			if(lexer->CurrentToken != ',') {
+				if(lexer->CurrentToken == ')') {
 					break;
 				}
 				else {
@@ -1234,24 +2130,24 @@ struct Parser {
 				}
 			}
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 		}
 
-		if(Lexer::CurrentToken != ')') { ExprError("Expected ')' to close argument list."); }
+		if(lexer->CurrentToken != ')') { ExprError("Expected ')' to close argument list."); }
 
-		Lexer::GetNextToken();
+		lexer->GetNextToken();
 
-		std::unique_ptr<AST::Type> procType;
+		AST::Type* procType = nullptr;
 
-		if(Lexer::CurrentToken == ':') { 
+		if(lexer->CurrentToken == ':') { 
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 
 			procType = IdentStrToType();
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 		}
-		else if(Lexer::CurrentToken != Token::Begin) {
+		else if(lexer->CurrentToken != Token::Begin) {
 			ExprError("Expected ':' to specify procedure type or 'begin' in procedure.");
 		}
 
@@ -1259,58 +2155,70 @@ struct Parser {
 
 		if(procType == nullptr) {
 			isVoid = true;
-			procType = std::make_unique<AST::Void>();
+			procType = AST::GetType<AST::Void>();
 		}
 
-		auto proc = std::make_unique<AST::Procedure>(procName, all_argument_var_types, std::move(all_arguments), std::move(all_argument_types), std::move(procType));
+		// The procedure is visible while its body is parsed, so its arguments
+		// can be found and it can call itself.
+		all_procedures.push_back(Arena::New<AST::Procedure>(procName, all_argument_var_types, std::move(all_arguments), std::move(all_argument_types), std::move(all_argument_attrs), procType, attrs));
 
-		all_procedures.push_back(std::move(proc));
+		AST::Procedure* newProc = all_procedures.back();
 
-		auto newProc = all_procedures[all_procedures.size() - 1]->CloneWithoutBody();
+		if(lexer->CurrentToken != Token::Begin) { ExprError("Expected 'begin' in procedure."); }
 
-		//std::cout << "Clone Success!\n";
+		lexer->GetNextToken();
 
-		if(Lexer::CurrentToken != Token::Begin) { ExprError("Expected 'begin' in procedure."); }
+		if(!isVoid) {
 
-		Lexer::GetNextToken();
+			AST::Expression* zero = nullptr;
 
-		if(!isVoid) {
+			if(AST::IsFloatType(newProc->proc_type)) {
+				zero = Arena::New<AST::FloatNumber>(0.0, newProc->proc_type);
+			}
+			else {
+				zero = Arena::New<AST::IntNumber>(0, newProc->proc_type);
+			}
 
-			auto return_value = std::make_unique<AST::Com>(procName + "_return", newProc->proc_type->Clone(), std::make_unique<AST::IntNumber>(0, newProc->proc_type->Clone()));
+			auto return_value = Arena::New<AST::Com>(procName + "_return", newProc->proc_type, zero);
 
-			AddParserCom(procName + "_return", return_value->ty.get());
+			AddParserCom(procName + "_return", return_value->ty);
 
-			body.push_back(std::move(return_value));
+			body.push_back(return_value);
 		}
 
-		while (Lexer::CurrentToken != Token::End) { 
+		// Parsing the arguments set the main target to the first one.
+		ResetMainTarget();
+
+		while (lexer->CurrentToken != Token::End) { 
 
-			std::unique_ptr<AST::Expression> e = ParseExpression();
+			AST::Expression* e = ParseExpression();
 
-			if(Lexer::CurrentToken != ';') { ExprError("Expected ';' to end instruction inside procedure."); }
+			if(lexer->CurrentToken != ';') { ExprError("Expected ';' to end instruction inside procedure."); }
 
-			body.push_back(std::move(e));
+			body.push_back(e);
 
 			ResetMainTarget();
 
-			Lexer::GetNextToken();
+			lexer->GetNextToken();
 		}
 
 		newProc->body = std::move(body);
 
+		auto proc = std::move(all_procedures.back());
+
 		all_procedures.pop_back();
 
-		return newProc;
+		return proc;
 	}
 
-	static std::unique_ptr<AST::Program> HandleProgram() {
+	static AST::Program* HandleProgram() {
 
-		Lexer::isInside = LexerIsInside::AProgram;
+		lexer->isInside = LexerIsInside::AProgram;
 
 		auto program = ParseProgram();
 
 		std::ofstream myfile;
-  		myfile.open("llm_main.mascal");
+  		myfile.open(CompilationSession::current->llmPath);
   		myfile << program->ToLLMascal();
   		myfile.close();
 
@@ -1321,65 +2229,262 @@ struct Parser {
 
 		auto proc = ParseProcedure();
 
-		all_procedures.push_back(std::move(proc));
+		all_procedures.push_back(proc);
 	}
 
-	static void MainLoop(bool build = false) {
+	static AST::Record* ParseRecord() {
+
+		lexer->GetNextToken();
+
+		AST::Attributes attrs;
+
+		if(lexer->CurrentToken == '[') {
+			attrs = ParseAttributes();
+		}
+
+		if(lexer->CurrentToken != Token::Identifier) { ExprError("Expected the name of the record."); }
+
+		std::string recordName(lexer->IdentifierStr);
+
+		if(AST::FindRecordType(recordName) != nullptr) { ExprError("Record '" + recordName + "' already exists."); }
+
+		lexer->GetNextToken();
+
+		if(lexer->CurrentToken != Token::Begin) { ExprError("Expected 'begin' in record."); }
+
+		lexer->GetNextToken();
+
+		std::vector<std::string> fieldNames;
+		std::vector<AST::Type*> fieldTypes;
+
+		while(lexer->CurrentToken != Token::End) {
+
+			if(lexer->CurrentToken != Token::Identifier) { ExprError("Expected the name of a field of record '" + recordName + "'."); }
+
+			std::string fieldName(lexer->IdentifierStr);
+
+			for(auto const& i : fieldNames) {
+				if(i == fieldName) { ExprError("Field '" + fieldName + "' is already in record '" + recordName + "'."); }
+			}
+
+			lexer->GetNextToken();
+
+			if(lexer->CurrentToken != ':') { ExprError("Expected ':' to specify field type."); }
+
+			lexer->GetNextToken();
 
-		StartMainTargetSystem();
+			AST::Type* T = IdentStrToType();
 
-		std::unique_ptr<AST::Program> MainProgram = nullptr;
+			if(dynamic_cast<AST::Void*>(T) != nullptr) { ExprError("Field '" + fieldName + "' can't be void."); }
 
-		while (Lexer::CurrentToken != Token::EndOfFile) {
+			lexer->GetNextToken();
 
-			Lexer::GetNextToken();
+			if(lexer->CurrentToken != ';') { ExprError("Expected ';' to end field '" + fieldName + "'."); }
 
-			if (Lexer::CurrentToken == Token::EndOfFile) 	break;
-			if (Lexer::CurrentToken == Token::Program) 		MainProgram = std::move(HandleProgram());
-			if (Lexer::CurrentToken == Token::Procedure) 	HandleProcedure();
+			lexer->GetNextToken();
+
+			fieldNames.push_back(fieldName);
+			fieldTypes.push_back(T);
 		}
 
-		//std::cout << "CodeGen...\n";
+		if(fieldNames.empty()) { ExprError("Record '" + recordName + "' has no fields."); }
 
-		MainProgram->codegen();
+		return Arena::New<AST::Record>(recordName, std::move(fieldNames), std::move(fieldTypes), attrs.isPacked, attrs.align);
+	}
 
-		if(build) {
+	// Records are types, so they must be declared before they are used.
+	static void HandleRecord() {
 
-			std::error_code EC;
-			llvm::raw_fd_ostream dest("output.ll", EC, llvm::sys::fs::OF_None);
-			CodeGen::TheModule->print(dest, nullptr);
-	
-			system("llc output.ll");
+		auto record = ParseRecord();
+
+		AST::record_types[record->recordName] = record;
+	}
+
+	// Everything after codegen only needs the module, so the AST is dropped at once.
+	static void FreeAST() {
+
+		all_procedures.clear();
+		all_parser_coms.clear();
+		all_parser_mems.clear();
+
+		// Keyed by names owned by the arena.
+		CodeGen::symbols = LLVM_Symbols();
+
+		lastCompareOne = nullptr;
+		lastCompareTwo = nullptr;
+
+		AST::Reset();
+	}
+
+	// Leaves the parser of this thread as it was before the session, for the next one.
+	static void Reset() {
+
+		FreeAST();
+
+		lexer = nullptr;
+
+		main_target.clear();
+		can_main_target_be_modified = true;
+
+		current_procedure_name.clear();
+		currentAttributes = AST::Attributes();
+
+		lastCmpType = 0;
+
+		allBlockNames.clear();
+
+		parforDepth = 0;
+	}
+
+	static int MainLoop(CompilationSession& session, bool build = false, bool run = false) {
+
+		CompilationSession::Scope scope(session);
+
+		lexer = session.lexer.get();
+
+		Timing::Scope compile("session", "Compile", CodeGen::TheModule->getModuleIdentifier());
+
+		// An unchanged program comes out of the cache already optimized.
+		if(!CompilationCache::Load(session)) {
+
+			StartMainTargetSystem();
 
-			std::cout << "Post-Procesing Assembly...\n";
+			AST::Program* MainProgram = nullptr;
+
+			{
+				Timing::Scope parse("parse", "Parse");
+
+				lexer->isTimed = Timing::enabled;
+
+				while (lexer->CurrentToken != Token::EndOfFile) {
+
+					lexer->GetNextToken();
+
+					if (lexer->CurrentToken == Token::EndOfFile) 	break;
+					if (lexer->CurrentToken == Token::Program) 		{ Timing::Scope item("parse", "Program"); MainProgram = HandleProgram(); }
+					if (lexer->CurrentToken == Token::Procedure) 	{ Timing::Scope item("parse", "Procedure"); HandleProcedure(); }
+					if (lexer->CurrentToken == Token::Record) 		{ Timing::Scope item("parse", "Record"); HandleRecord(); }
+				}
+
+				lexer->isTimed = false;
+			}
+
+			if(MainProgram == nullptr) { ExprError("No 'program' found."); }
+
+			//std::cout << "CodeGen...\n";
+
+			{
+				Timing::Scope codegen("codegen", "Codegen");
+
+				for(auto const& i : all_procedures) {
+
+					Timing::Scope procedure("codegen", "Procedure", i->procName);
+
+					i->codegen();
+				}
+
+				Timing::Scope program("codegen", "Program");
+
+				MainProgram->codegen();
+			}
+
+			session.usesCStdLib = MainProgram->attrs.usesCStdLib;
+
+			{
+				Timing::Scope freeAST("session", "Free AST");
+
+				FreeAST();
+			}
+
+			Optimizer::Run(CodeGen::TheModule.get(), CodeGen::TheTargetMachine.get());
+
+			CompilationCache::StoreModule(session);
+		}
+
+		if(build) {
 
 			std::string compilerArgs = "";
-	
-			if(!MainProgram->attrs.usesCStdLib) {
-	
-				std::string asmResult = Utils_DeleteGCCMainCall("output.s");
-	
-				std::ofstream asmOutput("output.s");
-  				asmOutput << asmResult;
-  				asmOutput.close();
 
-  				compilerArgs += "-nostdlib";
+			if(!session.usesCStdLib) {
+
+				CodeGen::AddGCCMainStub();
+
+				compilerArgs += "-nostdlib";
 			}
 
-			std::cout << "Building...\n";
+			// 'parfor' loops call into libmascalrt, built next to the compiler.
+			if(CodeGen::usesRuntime) {
+
+				if(session.usesCStdLib) {
+					compilerArgs += " \"" + CodeGen::runtimeDir + "/libmascalrt.a\" -lpthread";
+				}
+				else {
+					compilerArgs += " \"" + CodeGen::runtimeDir + "/libmascalrt_nostdlib.a\"";
+				}
+			}
+
+			if(CompilationCache::LoadObjects(session)) {
+				CompilationSession::Out() << "Using Cached Object File...\n";
+			}
+			else {
+
+				CompilationSession::Out() << "Emitting Object File...\n";
+
+				session.objects = CodeGen::EmitObjectFiles(session.objectPath);
+
+				CompilationCache::StoreObjects(session);
+			}
+
+			CompilationSession::Out() << "Building...\n";
+
+			Timing::Scope link("link", "Link", session.executablePath);
+
+			std::string clangCmd = "clang ";
+
+			for(auto const& o : session.objects) {
+				clangCmd += "\"" + o + "\" ";
+			}
 
-			std::string clangCmd = "clang output.s ";
 			clangCmd += compilerArgs;
-			clangCmd += " -static -o result";
+			clangCmd += " -static -o \"" + session.executablePath + "\"";
+
+			if(system(clangCmd.c_str()) != 0) {
+				CompilationSession::Out() << "Error: Linking '" << session.executablePath << "' failed.\n";
+				CompilationSession::Fail();
+			}
+
+			CompilationSession::Out() << "Done!\n";
+
+			return 0;
+		}
+
+		if(run) {
+
+			Timing::Scope jit("jit", "JIT");
 
-			system(clangCmd.c_str());
+			return MascalJIT::Run();
+		}
+
+		Timing::Scope printIR("emit", "Print IR", session.irPath);
+
+		if(session.irPath.empty()) {
+
+			CodeGen::TheModule->print(llvm::outs(), nullptr);
 
-			std::cout << "Done!\n";
+			return 0;
+		}
+
+		std::error_code EC;
+		llvm::raw_fd_ostream dest(session.irPath, EC, llvm::sys::fs::OF_Text);
 
-			return;
+		if(EC) {
+			CompilationSession::Out() << "Error: Could not open file '" << session.irPath << "': " << EC.message() << "\n";
+			CompilationSession::Fail();
 		}
 
-		CodeGen::TheModule->print(llvm::outs(), nullptr);
+		CodeGen::TheModule->print(dest, nullptr);
+
+		return 0;
 	}
 };
 
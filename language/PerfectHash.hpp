@@ -0,0 +1,111 @@
+#ifndef PERFECT_HASH_HPP
+#define PERFECT_HASH_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+// Compile-time perfect hash used by the lexers to map keyword spellings to tokens.
+//
+// The seed is searched while compiling until every keyword lands in its own slot,
+// so a lookup is one hash of the identifier, one slot and one compare.
+
+namespace PerfectHash {
+
+// Keys are stored inline, so spellings can be built at compile time (e.g. 'add' + 'q').
+struct Key {
+
+	char text[24] = {};
+	uint8_t length = 0;
+
+	constexpr Key() = default;
+
+	constexpr Key(const char* s) : Key(std::string_view(s)) {}
+
+	constexpr Key(std::string_view s, char suffix = 0) {
+
+		for(char c : s) text[length++] = c;
+
+		if(suffix != 0) text[length++] = suffix;
+	}
+
+	constexpr std::string_view View() const { return std::string_view(text, length); }
+};
+
+struct Entry {
+
+	Key key;
+	int token = 0;
+};
+
+constexpr uint32_t Hash(std::string_view s, uint32_t seed) {
+
+	// FNV-1a, with the seed as the offset basis.
+	uint32_t h = 2166136261u ^ seed;
+
+	for(char c : s) {
+		h ^= (unsigned char)c;
+		h *= 16777619u;
+	}
+
+	return h ^ (h >> 15);
+}
+
+template<size_t TableSize>
+struct Table {
+
+	static_assert((TableSize & (TableSize - 1)) == 0, "Table size must be a power of two.");
+
+	std::array<Entry, TableSize> slots = {};
+	uint32_t seed = 0;
+	size_t maxLength = 0;
+	bool found = false;
+
+	// 'entries' is any constexpr range of Entry (a C array or a std::array).
+	template<typename Entries>
+	constexpr Table(const Entries& entries) {
+
+		for(const Entry& e : entries) {
+			if(e.key.length > maxLength) maxLength = e.key.length;
+		}
+
+		for(uint32_t s = 1; s < 100000 && !found; s++) {
+
+			std::array<bool, TableSize> used = {};
+			bool collision = false;
+
+			for(const Entry& e : entries) {
+
+				size_t slot = Hash(e.key.View(), s) & (TableSize - 1);
+
+				if(used[slot]) { collision = true; break; }
+
+				used[slot] = true;
+			}
+
+			if(!collision) {
+				seed = s;
+				found = true;
+			}
+		}
+
+		for(const Entry& e : entries) {
+			slots[Hash(e.key.View(), seed) & (TableSize - 1)] = e;
+		}
+	}
+
+	// Returns 'fallback' when 's' is not a keyword.
+	constexpr int Lookup(std::string_view s, int fallback) const {
+
+		if(s.size() > maxLength) return fallback;
+
+		const Entry& e = slots[Hash(s, seed) & (TableSize - 1)];
+
+		return e.key.length != 0 && e.key.View() == s ? e.token : fallback;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,63 @@
+#include "Session.hpp"
+#include "Parser.hpp"
+#include <iostream>
+
+thread_local CompilationSession* CompilationSession::current = nullptr;
+
+thread_local std::ostream* CompilationSession::output = &std::cout;
+thread_local bool CompilationSession::throwOnError = false;
+
+void CompilationSession::Fail() {
+
+	Out().flush();
+
+	if(throwOnError) {
+		throw CompileError();
+	}
+
+	exit(1);
+}
+
+CompilationSession::CompilationSession(std::unique_ptr<Lexer> source, std::string_view name) : lexer(std::move(source)) {
+
+	context = std::make_unique<llvm::LLVMContext>();
+
+	module = std::make_unique<llvm::Module>(llvm::StringRef(name.data(), name.size()), *context);
+
+	targetMachine = CodeGen::InitializeTarget(module.get());
+
+	builder = std::make_unique<llvm::IRBuilder<>>(*context);
+}
+
+static void SwapState(CompilationSession& session) {
+
+	std::swap(CodeGen::TheContext, session.context);
+	std::swap(CodeGen::TheModule, session.module);
+	std::swap(CodeGen::Builder, session.builder);
+	std::swap(CodeGen::TheTargetMachine, session.targetMachine);
+}
+
+CompilationSession::Scope::Scope(CompilationSession& s) : session(s) {
+
+	if(current != nullptr) {
+		Out() << "Error: A thread can only compile one session at a time.\n";
+		Fail();
+	}
+
+	current = &session;
+
+	SwapState(session);
+}
+
+CompilationSession::Scope::~Scope() {
+
+	session.usesRuntime = CodeGen::usesRuntime;
+
+	Parser::Reset();
+	CodeGen::Reset();
+
+	// The JIT takes the module and context, they don't come back.
+	SwapState(session);
+
+	current = nullptr;
+}
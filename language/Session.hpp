@@ -0,0 +1,78 @@
+#ifndef SESSION_HPP
+#define SESSION_HPP
+
+#include "Lexer.hpp"
+#include "CodeGen.hpp"
+#include <ostream>
+
+// Thrown by 'CompilationSession::Fail' when the thread catches compile errors.
+// The message is already in 'CompilationSession::Out()'.
+struct CompileError {};
+
+// One compilation of one source. The session owns its lexer and its own LLVM
+// context, module, builder and target machine, so sessions never share LLVM state.
+//
+// Parser, CodeGen, AST and Arena keep their working state in 'thread_local' statics.
+// A 'Scope' binds them to one session: the LLVM objects are swapped in, and when
+// the scope ends they go back to the session and everything else is reset.
+// Sessions can then be compiled one after another in the same process, or one per thread.
+struct CompilationSession {
+
+	std::unique_ptr<Lexer> lexer;
+
+	std::unique_ptr<llvm::LLVMContext> context;
+	std::unique_ptr<llvm::Module> module;
+	std::unique_ptr<llvm::IRBuilder<>> builder;
+	std::unique_ptr<llvm::TargetMachine> targetMachine;
+
+	// Copied from 'CodeGen::usesRuntime' when the scope ends.
+	bool usesRuntime = false;
+
+	// '[CStdLib]' of the program, which decides how it is linked.
+	bool usesCStdLib = false;
+
+	// See 'CompilationCache'. The key is empty when the cache is off.
+	std::string cacheKey;
+	bool cacheHit = false;
+	unsigned cachedObjectCount = 0;
+
+	// Artifacts of the session. The defaults are the names 'main.mascal' was always built to.
+	std::string llmPath = "llm_main.mascal";
+	std::string objectPath = "output.o";
+	std::string executablePath = "result";
+
+	// Objects 'build' linked: 'objectPath', or its partitions with '--backend-threads'.
+	std::vector<std::string> objects;
+
+	// Where 'emit' writes the module. Printed to stdout when empty.
+	std::string irPath;
+
+	CompilationSession(std::unique_ptr<Lexer> source, std::string_view name = "Mascal");
+
+	struct Scope {
+
+		CompilationSession& session;
+
+		Scope(CompilationSession& s);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+
+	// Session bound to the calling thread, nullptr outside of a 'Scope'.
+	static thread_local CompilationSession* current;
+
+	// Errors and progress messages of the compilations on this thread. std::cout by default.
+	static thread_local std::ostream* output;
+
+	// By default an error ends the process. A driver compiling many files sets
+	// this on its threads, so an error only ends the file, with a 'CompileError'.
+	static thread_local bool throwOnError;
+
+	static std::ostream& Out() { return *output; }
+
+	[[noreturn]] static void Fail();
+};
+
+#endif
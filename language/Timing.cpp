@@ -0,0 +1,331 @@
+#include "Timing.hpp"
+#include "llvm/Demangle/Demangle.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+bool Timing::enabled = false;
+
+bool Timing::report = false;
+std::string Timing::tracePath;
+
+// Time added to a scope with 'Timing::Add', by name.
+struct AddedTime {
+
+	const char* category;
+	const char* name;
+
+	Clock::duration time{};
+	uint64_t count = 0;
+};
+
+struct OpenScope {
+
+	std::string category;
+	std::string name;
+	std::string detail;
+
+	Clock::time_point start;
+
+	// Time of the scopes nested in this one, and of what was added to it.
+	Clock::duration children{};
+
+	std::vector<AddedTime> added;
+};
+
+struct TraceEvent {
+
+	std::string category;
+	std::string name;
+	std::string detail;
+
+	Clock::time_point start;
+	Clock::duration duration;
+
+	unsigned thread;
+
+	std::vector<AddedTime> added;
+};
+
+struct PhaseTotal {
+
+	Clock::duration self{};
+	Clock::duration total{};
+
+	uint64_t count = 0;
+};
+
+// Trace timestamps start when the compiler does.
+static const Clock::time_point epoch = Clock::now();
+
+static std::mutex timingLock;
+
+static std::map<std::pair<std::string, std::string>, PhaseTotal> totals;
+static std::vector<TraceEvent> events;
+
+static std::atomic<unsigned> nextThread = 0;
+
+static thread_local unsigned threadId = nextThread++;
+
+static thread_local std::vector<OpenScope> openScopes;
+
+// How many scopes of each phase are open on this thread. A phase inside itself
+// (nested pass managers) counts once in its total, the outermost time.
+static thread_local std::map<std::pair<std::string, std::string>, unsigned> openPhases;
+
+bool Timing::ParseArgument(std::string arg) {
+
+	std::string traceArg = "--trace=";
+
+	if(arg == "--time-report") {
+
+		report = true;
+		enabled = true;
+
+		return true;
+	}
+
+	if(arg.rfind(traceArg, 0) == 0) {
+
+		tracePath = arg.substr(traceArg.size());
+		enabled = !tracePath.empty();
+
+		return enabled;
+	}
+
+	return false;
+}
+
+void Timing::Begin(std::string_view category, std::string_view name, std::string_view detail) {
+
+	OpenScope& scope = openScopes.emplace_back();
+
+	scope.category = category;
+	scope.name = name;
+	scope.detail = detail;
+
+	openPhases[{ scope.category, scope.name }]++;
+
+	// Last, so setting up the scope isn't part of it.
+	scope.start = Clock::now();
+}
+
+void Timing::End() {
+
+	Clock::time_point end = Clock::now();
+
+	// An 'End' without its 'Begin' (instrumentation callbacks LLVM didn't pair up).
+	if(openScopes.empty()) {
+		return;
+	}
+
+	OpenScope scope = std::move(openScopes.back());
+	openScopes.pop_back();
+
+	Clock::duration duration = end - scope.start;
+
+	if(!openScopes.empty()) {
+		openScopes.back().children += duration;
+	}
+
+	bool outermost = --openPhases[{ scope.category, scope.name }] == 0;
+
+	std::lock_guard<std::mutex> lock(timingLock);
+
+	PhaseTotal& phase = totals[{ scope.category, scope.name }];
+
+	phase.self += duration - scope.children;
+	phase.count++;
+
+	if(outermost) {
+		phase.total += duration;
+	}
+
+	for(auto const& a : scope.added) {
+
+		PhaseTotal& addedPhase = totals[{ a.category, a.name }];
+
+		addedPhase.self += a.time;
+		addedPhase.total += a.time;
+		addedPhase.count += a.count;
+	}
+
+	if(!tracePath.empty()) {
+		events.push_back({ std::move(scope.category), std::move(scope.name), std::move(scope.detail), scope.start, duration, threadId, std::move(scope.added) });
+	}
+}
+
+void Timing::Add(const char* category, const char* name, Clock::duration time) {
+
+	if(openScopes.empty()) {
+
+		std::lock_guard<std::mutex> lock(timingLock);
+
+		PhaseTotal& phase = totals[{ category, name }];
+
+		phase.self += time;
+		phase.total += time;
+		phase.count++;
+
+		return;
+	}
+
+	OpenScope& scope = openScopes.back();
+
+	scope.children += time;
+
+	// Only a few names are ever added, by the same call sites.
+	for(auto& a : scope.added) {
+
+		if(a.name == name && a.category == category) {
+
+			a.time += time;
+			a.count++;
+
+			return;
+		}
+	}
+
+	scope.added.push_back({ category, name, time, 1 });
+}
+
+std::string Timing::KindName(const std::type_info& type) {
+
+	static thread_local std::unordered_map<std::type_index, std::string> names;
+
+	auto found = names.find(type);
+
+	if(found != names.end()) {
+		return found->second;
+	}
+
+	// Demangled, an Itanium type name reads 'typeinfo name for AST::If'. Other
+	// ABIs name the type as is ('struct AST::If'), the demangler leaves those alone.
+	std::string name = llvm::demangle(std::string("_ZTS") + type.name());
+
+	size_t last = name.find_last_of(": ");
+
+	if(last != std::string::npos) {
+		name = name.substr(last + 1);
+	}
+
+	names.emplace(type, name);
+
+	return name;
+}
+
+static double Milliseconds(Clock::duration d) {
+
+	return std::chrono::duration<double, std::milli>(d).count();
+}
+
+static double Microseconds(Clock::duration d) {
+
+	return std::chrono::duration<double, std::micro>(d).count();
+}
+
+// Functions and files can be named with anything, JSON strings must be UTF-8.
+static std::string ToUTF8(const std::string& s) {
+
+	return llvm::json::isUTF8(s) ? s : llvm::json::fixUTF8(s);
+}
+
+static void PrintReport() {
+
+	std::vector<std::pair<std::pair<std::string, std::string>, PhaseTotal>> phases(totals.begin(), totals.end());
+
+	std::stable_sort(phases.begin(), phases.end(), [](auto const& a, auto const& b) { return a.second.self > b.second.self; });
+
+	llvm::raw_ostream& os = llvm::errs();
+
+	os << "===--- Time report ---===\n";
+	os << "  Self (ms)  Total (ms)      Count  Phase\n";
+
+	for(auto const& p : phases) {
+		os << llvm::format("%11.3f %11.3f %10llu  ", Milliseconds(p.second.self), Milliseconds(p.second.total), (unsigned long long)p.second.count) << p.first.first << ": " << p.first.second << "\n";
+	}
+
+	os.flush();
+}
+
+static void WriteTrace() {
+
+	std::error_code EC;
+	llvm::raw_fd_ostream file(Timing::tracePath, EC, llvm::sys::fs::OF_Text);
+
+	if(EC) {
+		llvm::errs() << "Error: Could not open file '" << Timing::tracePath << "': " << EC.message() << "\n";
+		return;
+	}
+
+	int64_t pid = llvm::sys::Process::getProcessId();
+
+	llvm::json::OStream J(file);
+
+	J.object([&] {
+
+		J.attribute("displayTimeUnit", "ms");
+
+		J.attributeArray("traceEvents", [&] {
+
+			for(auto const& e : events) {
+
+				J.object([&] {
+
+					J.attribute("name", ToUTF8(e.name));
+					J.attribute("cat", e.category);
+					J.attribute("ph", "X");
+					J.attribute("ts", Microseconds(e.start - epoch));
+					J.attribute("dur", Microseconds(e.duration));
+					J.attribute("pid", pid);
+					J.attribute("tid", (int64_t)e.thread);
+
+					if(e.detail.empty() && e.added.empty()) {
+						return;
+					}
+
+					J.attributeObject("args", [&] {
+
+						if(!e.detail.empty()) {
+							J.attribute("detail", ToUTF8(e.detail));
+						}
+
+						for(auto const& a : e.added) {
+							J.attribute(std::string(a.name) + " (ms)", Milliseconds(a.time));
+						}
+					});
+				});
+			}
+		});
+	});
+
+	file << "\n";
+}
+
+void Timing::Finish() {
+
+	if(!enabled) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(timingLock);
+
+	if(report) {
+		PrintReport();
+	}
+
+	if(!tracePath.empty()) {
+		WriteTrace();
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+
+// Phase timers of the compiler ('--time-report', '--trace=out.json'). Phases are
+// nested scopes, timed on the thread that runs them: sessions of the batch driver
+// and backend threads each get their own track. When neither option is given,
+// a scope costs a check of 'enabled'.
+//
+// '--time-report' prints the total and self time of every phase to stderr once the
+// compiler is done. '--trace' writes every scope as a Chrome trace event, which
+// chrome://tracing and Perfetto can load.
+struct Timing {
+
+	static bool enabled;
+
+	static bool report;
+	static std::string tracePath;
+
+	// Consumes '--time-report' and '--trace=file'.
+	// Returns false if the argument is not a timing argument.
+	static bool ParseArgument(std::string arg);
+
+	// Every 'Begin' is closed by an 'End' on the same thread. 'detail' (the function,
+	// the file...) is shown in the trace, the report only groups by category and name.
+	static void Begin(std::string_view category, std::string_view name, std::string_view detail = "");
+	static void End();
+
+	// Time of work too small and frequent to be a scope of its own (a token of the lexer).
+	// It's taken out of the self time of the open scope, and counted in the report on its own.
+	static void Add(const char* category, const char* name, std::chrono::steady_clock::duration time);
+
+	// 'If' for 'AST::If'. Names the statement kinds in codegen.
+	static std::string KindName(const std::type_info& type);
+
+	// Prints the report and writes the trace. Called by 'main' when the compiler is done.
+	static void Finish();
+
+	struct Scope {
+
+		bool active;
+
+		Scope(std::string_view category, std::string_view name, std::string_view detail = "") : active(enabled) {
+
+			if(active) Begin(category, name, detail);
+		}
+
+		// Named after the dynamic type of a node, which is only looked up when timing.
+		Scope(std::string_view category, const std::type_info& kind) : active(enabled) {
+
+			if(active) Begin(category, KindName(kind));
+		}
+
+		~Scope() {
+
+			if(active) End();
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+};
+
+#endif
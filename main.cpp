@@ -1,7 +1,16 @@
-#include <fstream>
 #include "language/Lexer.hpp"
 #include "language/Parser.hpp"
 #include "language/CodeGen.hpp"
+#include "language/Optimizer.hpp"
+#include "language/Session.hpp"
+#include "language/Driver.hpp"
+#include "language/Cache.hpp"
+#include "language/Timing.hpp"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+#include <thread>
 
 #include "translators/Assembly/AssemblyMain.hpp"
 
@@ -9,25 +18,81 @@ int main(int argc, char const *argv[])
 {
 	CodeGen::releaseMode = false;
 
+	// libmascalrt is installed next to the compiler.
+	std::string exePath = llvm::sys::fs::getMainExecutable(argv[0], (void*)&main);
+
+	if(!exePath.empty()) {
+		CodeGen::runtimeDir = llvm::sys::path::parent_path(exePath).str();
+	}
+
+	CompilationCache::compilerPath = exePath;
+
 	if(argc > 1) {
 
 		std::string cmd = argv[1];
 
-		if(cmd == "build" || cmd == "emit") {
-
-			std::ifstream t("main.mascal");
-			std::string str((std::istreambuf_iterator<char>(t)),
-  			             std::istreambuf_iterator<char>());
-		
-			CodeGen::Initialize();
-		
-			Lexer::AddContent(str);
-		
-			Lexer::Start();
-			
+		// Without inputs, 'main.mascal' is compiled to the same files as always.
+		std::vector<std::string> inputs;
+
+		std::string outDir = ".";
+		unsigned jobs = std::thread::hardware_concurrency();
+
+		for(int i = 2; i < argc; i++) {
+
+			std::string arg = argv[i];
+
+			if(arg == "--release") {
+				CodeGen::releaseMode = true;
+			}
+			else if(arg == "-o" && i + 1 < argc) {
+				outDir = argv[++i];
+			}
+			else if(arg == "-j" && i + 1 < argc) {
+
+				if(llvm::StringRef(argv[++i]).getAsInteger(10, jobs)) {
+					std::cout << "Invalid number of jobs '" << argv[i] << "'.\n";
+					return 1;
+				}
+			}
+			else if(llvm::sys::path::extension(arg) == ".mascal") {
+				inputs.push_back(arg);
+			}
+			else if(!Optimizer::ParseArgument(arg) && !CodeGen::ParseArgument(arg) && !CompilationCache::ParseArgument(arg) && !Timing::ParseArgument(arg)) {
+				std::cout << "Unknown argument '" << arg << "'.\n";
+				return 1;
+			}
+		}
+
+		if(cmd == "build" || cmd == "emit" || cmd == "run") {
+
+			if(!inputs.empty() && cmd != "run") {
+
+				int result = Driver::Build(inputs, outDir, jobs, cmd == "build");
+
+				Timing::Finish();
+
+				return result;
+			}
+
+			if(inputs.size() > 1) {
+				std::cout << "'run' takes a single program.\n";
+				return 1;
+			}
+
+			CompilationSession session(Lexer::FromFile(inputs.empty() ? "main.mascal" : inputs[0]));
+
+			session.lexer->Start();
+
 			bool canBuild = cmd == "build";
+			bool canRun = cmd == "run";
+
+			int result = Parser::MainLoop(session, canBuild, canRun);
+
+			CompilationCache::Prune();
+
+			Timing::Finish();
 
-			Parser::MainLoop(canBuild);
+			return result;
 		}
 
 		if(cmd == "translate") {
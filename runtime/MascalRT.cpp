@@ -0,0 +1,459 @@
+#include "MascalRT.hpp"
+
+// Nothing here may depend on the C++ runtime (no new, no exceptions, no static
+// constructors): the -nostdlib build is linked without libc and libstdc++.
+
+#ifdef MASCALRT_NOSTDLIB
+
+#if !defined(__linux__) || !defined(__x86_64__)
+#error "The -nostdlib runtime only supports Linux x86-64."
+#endif
+
+#else
+
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#endif
+
+namespace {
+
+// Iterations not taken yet by a worker. Thieves take half of it from the back.
+struct alignas(64) WorkRange {
+
+	uint32_t lock;
+
+	int64_t begin;
+	int64_t end;
+};
+
+struct Job {
+
+	MascalParforBody body;
+	void* ctx;
+
+	int64_t grain;
+};
+
+WorkRange ranges[MASCALRT_MAX_WORKERS];
+
+Job job;
+
+// Pool threads plus the thread that calls '__mascal_parfor'. 0 until the pool is started.
+int64_t workerCount = 0;
+
+// Futex words. 'generation' changes when a new job is published,
+// 'pending' counts the pool threads still working on it.
+uint32_t generation = 0;
+uint32_t pending = 0;
+
+// A 'parfor' inside the body of another one runs serially on its worker.
+bool isRunning = false;
+
+}
+
+#ifdef MASCALRT_NOSTDLIB
+
+enum {
+	SYS_mmap = 9,
+	SYS_clone = 56,
+	SYS_exit = 60,
+	SYS_futex = 202,
+	SYS_sched_getaffinity = 204
+};
+
+enum {
+	FUTEX_WAIT_PRIVATE = 128,
+	FUTEX_WAKE_PRIVATE = 129
+};
+
+static long Syscall(long n, long a = 0, long b = 0, long c = 0, long d = 0, long e = 0, long f = 0) {
+
+	register long r10 __asm__("r10") = d;
+	register long r8 __asm__("r8") = e;
+	register long r9 __asm__("r9") = f;
+
+	long ret;
+
+	__asm__ volatile("syscall"
+		: "=a"(ret)
+		: "a"(n), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9)
+		: "rcx", "r11", "memory");
+
+	return ret;
+}
+
+static void Wait(uint32_t* addr, uint32_t expected) {
+
+	Syscall(SYS_futex, (long)addr, FUTEX_WAIT_PRIVATE, expected, 0);
+}
+
+static void WakeAll(uint32_t* addr) {
+
+	Syscall(SYS_futex, (long)addr, FUTEX_WAKE_PRIVATE, 0x7fffffff);
+}
+
+static int64_t CPUCount() {
+
+	uint64_t mask[16];
+
+	for(int i = 0; i < 16; i++) mask[i] = 0;
+
+	long bytes = Syscall(SYS_sched_getaffinity, 0, sizeof(mask), (long)mask);
+
+	if(bytes <= 0) return 1;
+
+	int64_t count = 0;
+
+	for(long i = 0; i < bytes / 8; i++) {
+
+		for(uint64_t bits = mask[i]; bits != 0; bits &= bits - 1) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+static bool Spawn(void (*fn)(void*), void* arg) {
+
+	const long stackSize = 8 << 20;
+
+	// PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK.
+	long stack = Syscall(SYS_mmap, 0, stackSize, 0x3, 0x22 | 0x20000, -1, 0);
+
+	if(stack < 0 && stack > -4096) return false;
+
+	// The child starts on its own stack, with nothing but 'fn' and 'arg' on it.
+	void** sp = (void**)(stack + stackSize);
+	*--sp = arg;
+	*--sp = (void*)fn;
+
+	// CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD | CLONE_SYSVSEM.
+	long flags = 0x100 | 0x200 | 0x400 | 0x800 | 0x10000 | 0x40000;
+
+	register long r10 __asm__("r10") = 0;
+	register long r8 __asm__("r8") = 0;
+
+	long ret;
+
+	__asm__ volatile(
+		"syscall\n\t"
+		"test %%rax, %%rax\n\t"
+		"jnz 1f\n\t"
+		"xor %%ebp, %%ebp\n\t"
+		"pop %%rax\n\t"
+		"pop %%rdi\n\t"
+		"call *%%rax\n\t"
+		"mov %[exitNr], %%eax\n\t"
+		"xor %%edi, %%edi\n\t"
+		"syscall\n\t"
+		"hlt\n\t"
+		"1:\n\t"
+		: "=a"(ret)
+		: "a"((long)SYS_clone), "D"(flags), "S"(sp), "d"(0L), "r"(r10), "r"(r8), [exitNr] "i"(SYS_exit)
+		: "rcx", "r11", "memory");
+
+	return ret > 0;
+}
+
+// Without libc nothing else defines these, but LLVM lowers big
+// 'llvm.memset' / 'llvm.memcpy' (array initializers) to calls to them.
+// Built with -ffreestanding, so the loops aren't turned back into calls.
+extern "C" __attribute__((weak)) void* memset(void* dst, int c, unsigned long n) {
+
+	unsigned char* d = (unsigned char*)dst;
+
+	for(unsigned long i = 0; i < n; i++) d[i] = (unsigned char)c;
+
+	return dst;
+}
+
+extern "C" __attribute__((weak)) void* memcpy(void* dst, const void* src, unsigned long n) {
+
+	unsigned char* d = (unsigned char*)dst;
+	const unsigned char* s = (const unsigned char*)src;
+
+	for(unsigned long i = 0; i < n; i++) d[i] = s[i];
+
+	return dst;
+}
+
+#else
+
+static pthread_mutex_t waitLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t waitCond = PTHREAD_COND_INITIALIZER;
+
+// Same contract as a futex: returns once '*addr' isn't 'expected' anymore (or spuriously).
+static void Wait(uint32_t* addr, uint32_t expected) {
+
+	pthread_mutex_lock(&waitLock);
+
+	while(__atomic_load_n(addr, __ATOMIC_ACQUIRE) == expected) {
+		pthread_cond_wait(&waitCond, &waitLock);
+	}
+
+	pthread_mutex_unlock(&waitLock);
+}
+
+static void WakeAll(uint32_t*) {
+
+	pthread_mutex_lock(&waitLock);
+	pthread_cond_broadcast(&waitCond);
+	pthread_mutex_unlock(&waitLock);
+}
+
+static int64_t CPUCount() {
+
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+
+	return info.dwNumberOfProcessors;
+#else
+	return sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+struct SpawnArgs {
+
+	void (*fn)(void*);
+	void* arg;
+};
+
+static SpawnArgs spawnArgs[MASCALRT_MAX_WORKERS];
+
+static void* ThreadMain(void* p) {
+
+	SpawnArgs* args = (SpawnArgs*)p;
+	args->fn(args->arg);
+
+	return nullptr;
+}
+
+static bool Spawn(void (*fn)(void*), void* arg) {
+
+	SpawnArgs* args = &spawnArgs[(int64_t)arg];
+	args->fn = fn;
+	args->arg = arg;
+
+	pthread_t thread;
+
+	if(pthread_create(&thread, nullptr, ThreadMain, args) != 0) {
+		return false;
+	}
+
+	pthread_detach(thread);
+
+	return true;
+}
+
+#endif
+
+static void Lock(uint32_t* l) {
+
+	while(__atomic_exchange_n(l, 1, __ATOMIC_ACQUIRE) != 0) {
+
+		while(__atomic_load_n(l, __ATOMIC_RELAXED) != 0) {
+#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#endif
+		}
+	}
+}
+
+static void Unlock(uint32_t* l) {
+
+	__atomic_store_n(l, 0, __ATOMIC_RELEASE);
+}
+
+static bool TakeChunk(int64_t w, int64_t* lo, int64_t* hi) {
+
+	WorkRange* r = &ranges[w];
+
+	Lock(&r->lock);
+
+	bool found = r->begin < r->end;
+
+	if(found) {
+
+		*lo = r->begin;
+		*hi = r->end - r->begin > job.grain ? r->begin + job.grain : r->end;
+
+		r->begin = *hi;
+	}
+
+	Unlock(&r->lock);
+
+	return found;
+}
+
+// Moves half of the range of the first busy worker into the range of 'w'.
+static bool Steal(int64_t w) {
+
+	for(int64_t i = 1; i < workerCount; i++) {
+
+		WorkRange* victim = &ranges[(w + i) % workerCount];
+
+		Lock(&victim->lock);
+
+		int64_t remaining = victim->end - victim->begin;
+
+		if(remaining <= 0) {
+			Unlock(&victim->lock);
+			continue;
+		}
+
+		int64_t taken = remaining > job.grain ? remaining / 2 : remaining;
+
+		int64_t lo = victim->end - taken;
+		int64_t hi = victim->end;
+
+		victim->end = lo;
+
+		Unlock(&victim->lock);
+
+		Lock(&ranges[w].lock);
+		ranges[w].begin = lo;
+		ranges[w].end = hi;
+		Unlock(&ranges[w].lock);
+
+		return true;
+	}
+
+	return false;
+}
+
+static void RunWorker(int64_t w) {
+
+	int64_t lo = 0;
+	int64_t hi = 0;
+
+	do {
+
+		while(TakeChunk(w, &lo, &hi)) {
+			job.body(lo, hi, job.ctx, w);
+		}
+
+	} while(Steal(w));
+}
+
+static void WorkerMain(void* arg) {
+
+	int64_t w = (int64_t)arg;
+
+	uint32_t seen = 0;
+
+	for(;;) {
+
+		uint32_t g;
+
+		while((g = __atomic_load_n(&generation, __ATOMIC_ACQUIRE)) == seen) {
+			Wait(&generation, seen);
+		}
+
+		seen = g;
+
+		RunWorker(w);
+
+		if(__atomic_sub_fetch(&pending, 1, __ATOMIC_ACQ_REL) == 0) {
+			WakeAll(&pending);
+		}
+	}
+}
+
+static void StartPool() {
+
+	int64_t cpus = CPUCount();
+
+	if(cpus < 1) cpus = 1;
+	if(cpus > MASCALRT_MAX_WORKERS) cpus = MASCALRT_MAX_WORKERS;
+
+	workerCount = 1;
+
+	for(int64_t i = 1; i < cpus; i++) {
+
+		if(!Spawn(WorkerMain, (void*)i)) {
+			break;
+		}
+
+		workerCount++;
+	}
+}
+
+extern "C" int64_t __mascal_parfor(int64_t lo, int64_t hi, MascalParforBody body, void* ctx) {
+
+	if(isRunning) {
+
+		if(lo < hi) {
+			body(lo, hi, ctx, 0);
+		}
+
+		return 1;
+	}
+
+	if(workerCount == 0) {
+		StartPool();
+	}
+
+	if(hi <= lo) {
+		return 1;
+	}
+
+	int64_t n = hi - lo;
+
+	isRunning = true;
+
+	if(workerCount == 1 || n == 1) {
+
+		body(lo, hi, ctx, 0);
+
+		isRunning = false;
+		return 1;
+	}
+
+	job.body = body;
+	job.ctx = ctx;
+
+	// Small enough chunks for stealing to balance the load, big enough to keep the locks cold.
+	job.grain = n / (workerCount * 16);
+
+	if(job.grain < 1) job.grain = 1;
+
+	int64_t perWorker = n / workerCount;
+	int64_t extra = n % workerCount;
+
+	int64_t begin = lo;
+
+	for(int64_t w = 0; w < workerCount; w++) {
+
+		int64_t size = perWorker + (w < extra ? 1 : 0);
+
+		ranges[w].begin = begin;
+		ranges[w].end = begin + size;
+
+		begin += size;
+	}
+
+	__atomic_store_n(&pending, (uint32_t)(workerCount - 1), __ATOMIC_RELEASE);
+	__atomic_add_fetch(&generation, 1, __ATOMIC_RELEASE);
+
+	WakeAll(&generation);
+
+	RunWorker(0);
+
+	uint32_t p;
+
+	while((p = __atomic_load_n(&pending, __ATOMIC_ACQUIRE)) != 0) {
+		Wait(&pending, p);
+	}
+
+	isRunning = false;
+
+	return workerCount;
+}
@@ -0,0 +1,29 @@
+#ifndef MASCALRT_HPP
+#define MASCALRT_HPP
+
+// libmascalrt: runtime support linked into programs that use 'parfor'.
+//
+// Built twice by compile.sh:
+//  - libmascalrt.a, on top of pthreads, for '[CStdLib]' programs.
+//  - libmascalrt_nostdlib.a (MASCALRT_NOSTDLIB), on top of raw clone/futex
+//    syscalls, for programs linked with '-nostdlib' (Linux x86-64 only).
+
+#include <stdint.h>
+
+// Reduction partials are kept in one slot per worker, each on its own cache line.
+#define MASCALRT_MAX_WORKERS 64
+#define MASCALRT_SLOT_SIZE 64
+
+extern "C" {
+
+// Outlined body of a 'parfor'. Runs the iterations [lo, hi) on worker 'worker'.
+typedef void (*MascalParforBody)(int64_t lo, int64_t hi, void* ctx, int64_t worker);
+
+// Splits [lo, hi) in chunks and runs them on the thread pool, the calling thread
+// included. Idle workers steal half of the remaining range of a busy one.
+// Returns the number of workers that may have written a reduction slot.
+int64_t __mascal_parfor(int64_t lo, int64_t hi, MascalParforBody body, void* ctx);
+
+}
+
+#endif
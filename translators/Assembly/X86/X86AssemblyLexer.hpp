@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include "../../../language/PerfectHash.hpp"
 
 enum X86AssemblyToken {
 
@@ -40,6 +41,68 @@ enum X86AssemblyToken {
 	X86SEHSetFrame = -26,
 };
 
+// Mnemonics that also accept an operand size suffix ('addb', 'movl', 'pushq', ...).
+constexpr PerfectHash::Entry X86SizedMnemonics[] = {
+	{ "add", X86AssemblyToken::X86Add },
+	{ "sub", X86AssemblyToken::X86Sub },
+	{ "xor", X86AssemblyToken::X86Xor },
+	{ "inc", X86AssemblyToken::X86Inc },
+	{ "lea", X86AssemblyToken::X86Lea },
+	{ "call", X86AssemblyToken::X86Call },
+	{ "pop", X86AssemblyToken::X86Pop },
+	{ "push", X86AssemblyToken::X86Push },
+	{ "ret", X86AssemblyToken::X86Return },
+
+	{ "mov", X86AssemblyToken::X86Mov },
+	{ "cmp", X86AssemblyToken::X86Cmp },
+	{ "test", X86AssemblyToken::X86Test }
+};
+
+constexpr char X86SizeSuffixes[] = { 'b', 'w', 'l', 's', 'q', 't' };
+
+constexpr PerfectHash::Entry X86Keywords[] = {
+	{ "jmp", X86AssemblyToken::X86Jmp },
+
+	{ ".text", X86AssemblyToken::X86Text },
+	{ ".def", X86AssemblyToken::X86Def },
+	{ ".globl", X86AssemblyToken::X86Globl },
+	{ ".set", X86AssemblyToken::X86Set },
+	{ ".file", X86AssemblyToken::X86File },
+	{ ".p2align", X86AssemblyToken::X86P2Align },
+
+	{ ".seh_setframe", X86AssemblyToken::X86SEHSetFrame },
+
+	{ ".seh_proc", X86AssemblyToken::X86SEH },
+	{ ".seh_pushreg", X86AssemblyToken::X86SEH },
+	{ ".seh_stackalloc", X86AssemblyToken::X86SEH },
+
+	{ ".seh_endprologue", X86AssemblyToken::X86SEHEnd },
+	{ ".seh_endproc", X86AssemblyToken::X86SEHEnd }
+};
+
+// Every spelling the lexer recognizes, with the suffixed mnemonics expanded.
+constexpr auto BuildX86KeywordEntries() {
+
+	std::array<PerfectHash::Entry, std::size(X86SizedMnemonics) * (std::size(X86SizeSuffixes) + 1) + std::size(X86Keywords)> entries = {};
+	size_t i = 0;
+
+	for(const PerfectHash::Entry& m : X86SizedMnemonics) {
+
+		entries[i++] = m;
+
+		for(char suffix : X86SizeSuffixes) {
+			entries[i++] = { PerfectHash::Key(m.key.View(), suffix), m.token };
+		}
+	}
+
+	for(const PerfectHash::Entry& k : X86Keywords) entries[i++] = k;
+
+	return entries;
+}
+
+constexpr PerfectHash::Table<1024> X86KeywordTable(BuildX86KeywordEntries());
+static_assert(X86KeywordTable.found, "No perfect hash seed found for the X86 keywords.");
+
 struct X86AssemblyLexer {
 
 	static std::string Content;
@@ -158,24 +221,6 @@ struct X86AssemblyLexer {
 		return isalnum(c) || c == '_' || c == '.';
 	}
 
-	static bool IsMultipleBitIdentifier(std::string s) {
-
-		std::string bit8version = s + "b";
-		std::string bit16version = s + "w";
-		std::string bitlong32version = s + "l";
-		std::string bit32version = s + "s";
-		std::string bit64version = s + "q";
-		std::string bit80version = s + "t";
-
-		return IsIdentifier(s) || 
-		IsIdentifier(bit8version) ||
-		IsIdentifier(bit16version) ||
-		IsIdentifier(bitlong32version) ||
-		IsIdentifier(bit32version) ||
-		IsIdentifier(bit64version) ||
-		IsIdentifier(bit80version);
-	}
-
 	static bool IsIdentifierMetadata() {
 
 		return CurrentToken == X86AssemblyToken::X86Text ||
@@ -198,42 +243,12 @@ struct X86AssemblyLexer {
 			IdentifierStr += LastChar;
 		}
 
-		if(IsMultipleBitIdentifier("add")) return X86AssemblyToken::X86Add;
-		else if(IsMultipleBitIdentifier("sub")) return X86AssemblyToken::X86Sub;
-		else if(IsMultipleBitIdentifier("xor")) return X86AssemblyToken::X86Xor;
-		else if(IsMultipleBitIdentifier("inc")) return X86AssemblyToken::X86Inc;
-		else if(IsMultipleBitIdentifier("lea")) return X86AssemblyToken::X86Lea;
-		else if(IsMultipleBitIdentifier("call")) return X86AssemblyToken::X86Call;
-		else if(IsMultipleBitIdentifier("pop")) return X86AssemblyToken::X86Pop;
-		else if(IsMultipleBitIdentifier("push")) return X86AssemblyToken::X86Push;
-		else if(IsMultipleBitIdentifier("ret")) return X86AssemblyToken::X86Return;
-
-		else if(IsMultipleBitIdentifier("mov")) return X86AssemblyToken::X86Mov;
-		else if(IsMultipleBitIdentifier("cmp")) return X86AssemblyToken::X86Cmp;
-		else if(IsMultipleBitIdentifier("test")) return X86AssemblyToken::X86Test;
-
-		else if(IsIdentifier("jmp")) return X86AssemblyToken::X86Jmp;
-
-		else if(IsIdentifier(".text")) return X86AssemblyToken::X86Text;
-		else if(IsIdentifier(".def")) return X86AssemblyToken::X86Def;
-		else if(IsIdentifier(".globl")) return X86AssemblyToken::X86Globl;
-		else if(IsIdentifier(".set")) return X86AssemblyToken::X86Set;
-		else if(IsIdentifier(".file")) return X86AssemblyToken::X86File;
-		else if(IsIdentifier(".p2align")) return X86AssemblyToken::X86P2Align;
-
-		else if(IsIdentifier(".seh_setframe")) { 
-			return X86AssemblyToken::X86SEHSetFrame; 
-		}
+		int token = X86KeywordTable.Lookup(IdentifierStr, X86AssemblyToken::X86Identifier);
 
-		else if(IsIdentifier(".seh_proc") || 
-			IsIdentifier(".seh_pushreg") ||
-			IsIdentifier(".seh_stackalloc")) { 
-			return X86AssemblyToken::X86SEH; 
-		}
+		if(token != X86AssemblyToken::X86Identifier) return token;
 
-		else if(IdentifierContains(".seh_endprologue") || IsIdentifier(".seh_endproc")) { 
-			return X86AssemblyToken::X86SEHEnd; 
-		}
+		// Some assemblers append to this directive, so it's only matched by prefix.
+		if(IdentifierContains(".seh_endprologue")) return X86AssemblyToken::X86SEHEnd;
 
 		return X86AssemblyToken::X86Identifier;
 	}